@@ -1439,29 +1439,38 @@ MirrorBuffer (BufferType *Buffer)
   Buffer->Y = SWAP_Y (Buffer->Y);
   VIA_LOOP (Buffer->Data);
   {
+    r_delete_entry (Buffer->Data->via_tree, (BoxType *)via);
     via->X = SWAP_X (via->X);
     via->Y = SWAP_Y (via->Y);
+    SetPinBoundingBox (via);
+    r_insert_entry (Buffer->Data->via_tree, (BoxType *)via, 0);
   }
   END_LOOP;
   ALLLINE_LOOP (Buffer->Data);
   {
+    r_delete_entry (layer->line_tree, (BoxType *)line);
     line->Point1.X = SWAP_X (line->Point1.X);
     line->Point1.Y = SWAP_Y (line->Point1.Y);
     line->Point2.X = SWAP_X (line->Point2.X);
     line->Point2.Y = SWAP_Y (line->Point2.Y);
+    SetLineBoundingBox (line);
+    r_insert_entry (layer->line_tree, (BoxType *)line, 0);
   }
   ENDALL_LOOP;
   ALLARC_LOOP (Buffer->Data);
   {
+    r_delete_entry (layer->arc_tree, (BoxType *)arc);
     arc->X = SWAP_X (arc->X);
     arc->Y = SWAP_Y (arc->Y);
     arc->StartAngle = SWAP_ANGLE (arc->StartAngle);
     arc->Delta = SWAP_DELTA (arc->Delta);
     SetArcBoundingBox (arc);
+    r_insert_entry (layer->arc_tree, (BoxType *)arc, 0);
   }
   ENDALL_LOOP;
   ALLPOLYGON_LOOP (Buffer->Data);
   {
+    r_delete_entry (layer->polygon_tree, (BoxType *)polygon);
     POLYGONPOINT_LOOP (polygon);
     {
       point->X = SWAP_X (point->X);
@@ -1469,6 +1478,7 @@ MirrorBuffer (BufferType *Buffer)
     }
     END_LOOP;
     SetPolygonBoundingBox (polygon);
+    r_insert_entry (layer->polygon_tree, (BoxType *)polygon, 0);
   }
   ENDALL_LOOP;
   SetBufferBoundingBox (Buffer);
@@ -675,6 +675,7 @@ typedef struct			/* some resources... */
     SaveLastCommand,		/* save the last command entered by user */
     SaveInTMP,			/* always save data in /tmp */
     SaveMetricOnly,		/* save with mm suffix only, not mil/mm hybrid */
+    SnapshotCache,		/* keep polygon clip snapshots next to boards */
     DrawGrid,			/* draw grid points */
     RatWarn,			/* rats nest has set warnings */
     StipplePolygons,		/* draw polygons with stipple */
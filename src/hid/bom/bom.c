@@ -80,9 +80,20 @@ typedef struct _BomList
   char *value;
   int num;
   StringList *refdes;
+  StringList *refdes_tail;
   struct _BomList *next;
 } BomList;
 
+/* The parts in the order they were first seen, and an index to find the
+ * entry for a description and value without walking the list.
+ */
+typedef struct
+{
+  BomList *head;
+  BomList *tail;
+  GHashTable *index;
+} Bom;
+
 static HID_Attribute *
 bom_get_export_options (int *n)
 {
@@ -194,89 +205,82 @@ xyToAngle (double x, double y, bool morethan2pins)
     }
 }
 
-static StringList *
-string_insert (char *str, StringList * list)
+static void
+string_append (char *str, BomList * entry)
 {
-  StringList *newlist, *cur;
+  StringList *newlist;
 
   if ((newlist = (StringList *) malloc (sizeof (StringList))) == NULL)
     {
-      fprintf (stderr, "malloc() failed in string_insert()\n");
+      fprintf (stderr, "malloc() failed in string_append()\n");
       exit (1);
     }
 
   newlist->next = NULL;
   newlist->str = strdup (str);
 
-  if (list == NULL)
-    return (newlist);
-
-  cur = list;
-  while (cur->next != NULL)
-    cur = cur->next;
+  if (entry->refdes_tail == NULL)
+    entry->refdes = newlist;
+  else
+    entry->refdes_tail->next = newlist;
+  entry->refdes_tail = newlist;
+}
 
-  cur->next = newlist;
+static guint
+bom_entry_hash (gconstpointer key)
+{
+  const BomList *entry = (const BomList *) key;
 
-  return (list);
+  return g_str_hash (entry->descr) * 31 + g_str_hash (entry->value);
 }
 
-static BomList *
-bom_insert (char *refdes, char *descr, char *value, BomList * bom)
+static gboolean
+bom_entry_equal (gconstpointer a, gconstpointer b)
 {
-  BomList *newlist, *cur, *prev = NULL;
+  const BomList *ea = (const BomList *) a;
+  const BomList *eb = (const BomList *) b;
 
-  if (bom == NULL)
-    {
-      /* this is the first element so automatically create an entry */
-      if ((newlist = (BomList *) malloc (sizeof (BomList))) == NULL)
-	{
-	  fprintf (stderr, "malloc() failed in bom_insert()\n");
-	  exit (1);
-	}
+  return (NSTRCMP (ea->descr, eb->descr) == 0 &&
+	  NSTRCMP (ea->value, eb->value) == 0);
+}
 
-      newlist->next = NULL;
-      newlist->descr = strdup (descr);
-      newlist->value = strdup (value);
-      newlist->num = 1;
-      newlist->refdes = string_insert (refdes, NULL);
-      return (newlist);
-    }
+static void
+bom_insert (char *refdes, char *descr, char *value, Bom * bom)
+{
+  BomList key, *entry;
 
-  /* search and see if we already have used one of these
-     components */
-  cur = bom;
-  while (cur != NULL)
-    {
-      if ((NSTRCMP (descr, cur->descr) == 0) &&
-	  (NSTRCMP (value, cur->value) == 0))
-	{
-	  cur->num++;
-	  cur->refdes = string_insert (refdes, cur->refdes);
-	  break;
-	}
-      prev = cur;
-      cur = cur->next;
-    }
+  if (bom->index == NULL)
+    bom->index = g_hash_table_new (bom_entry_hash, bom_entry_equal);
+
+  /* see if we already have used one of these components */
+  key.descr = descr;
+  key.value = value;
+  entry = (BomList *) g_hash_table_lookup (bom->index, &key);
 
-  if (cur == NULL)
+  if (entry == NULL)
     {
-      if ((newlist = (BomList *) malloc (sizeof (BomList))) == NULL)
+      if ((entry = (BomList *) malloc (sizeof (BomList))) == NULL)
 	{
 	  fprintf (stderr, "malloc() failed in bom_insert()\n");
 	  exit (1);
 	}
 
-      prev->next = newlist;
+      entry->next = NULL;
+      entry->descr = strdup (descr);
+      entry->value = strdup (value);
+      entry->num = 0;
+      entry->refdes = entry->refdes_tail = NULL;
 
-      newlist->next = NULL;
-      newlist->descr = strdup (descr);
-      newlist->value = strdup (value);
-      newlist->num = 1;
-      newlist->refdes = string_insert (refdes, NULL);
+      if (bom->tail == NULL)
+	bom->head = entry;
+      else
+	bom->tail->next = entry;
+      bom->tail = entry;
+      g_hash_table_insert (bom->index, entry, entry);
     }
 
-  return (bom);
-
+  entry->num++;
+  string_append (refdes, entry);
 }
 
 /* 
@@ -284,12 +288,16 @@ bom_insert (char *refdes, char *descr, char *value, BomList * bom)
  * bom.  Either way, free all memory which has been allocated for bom.
  */
 static void
-print_and_free (FILE *fp, BomList *bom)
+print_and_free (FILE *fp, Bom *bom_list)
 {
+  BomList *bom = bom_list->head;
   BomList *lastb;
   StringList *lasts;
   char *descr, *value;
 
+  if (bom_list->index)
+    g_hash_table_destroy (bom_list->index);
+
   while (bom != NULL)
     {
       if (fp)
@@ -318,6 +326,8 @@ print_and_free (FILE *fp, BomList *bom)
 	}
       lastb = bom;
       bom = bom->next;
+      free (lastb->descr);
+      free (lastb->value);
       free (lastb);
     }
 }
@@ -349,7 +359,7 @@ PrintBOM (void)
   int found_any;
   time_t currenttime;
   FILE *fp;
-  BomList *bom = NULL;
+  Bom bom = { NULL, NULL, NULL };
   char *name, *descr, *value,*fixed_rotation;
   int rpindex;
 
@@ -394,9 +404,9 @@ PrintBOM (void)
       pinfound[rpindex] = 0;
 
     /* Insert this component into the bill of materials list. */
-    bom = bom_insert ((char *)UNKNOWN (NAMEONPCB_NAME (element)),
-                      (char *)UNKNOWN (DESCRIPTION_NAME (element)),
-                      (char *)UNKNOWN (VALUE_NAME (element)), bom);
+    bom_insert ((char *)UNKNOWN (NAMEONPCB_NAME (element)),
+                (char *)UNKNOWN (DESCRIPTION_NAME (element)),
+                (char *)UNKNOWN (VALUE_NAME (element)), &bom);
 
 
     /*
@@ -554,7 +564,7 @@ PrintBOM (void)
   if (!fp)
     {
       gui->log ("Cannot open file %s for writing\n", bom_filename);
-      print_and_free (NULL, bom);
+      print_and_free (NULL, &bom);
       return 1;
     }
 
@@ -565,7 +575,7 @@ PrintBOM (void)
   fprintf (fp, "# Quantity, Description, Value, RefDes\n");
   fprintf (fp, "# --------------------------------------------\n");
 
-  print_and_free (fp, bom);
+  print_and_free (fp, &bom);
 
   fclose (fp);
 
@@ -0,0 +1,361 @@
+/*
+ *                            COPYRIGHT
+ *
+ *  PCB, interactive printed circuit board design
+ *  Copyright (C) 2026 PCB Contributors (See ChangeLog for details).
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/* Content digests for exporters which write one file per layer.
+ *
+ * An exporter digests everything that can show up in a file (the
+ * objects on the layers it draws, polygons as clipped, the settings
+ * it was given) and writes the digest into the file's header.  On the
+ * next export, a file whose recorded digest matches the new one is
+ * already up to date and need not be written again.
+ *
+ * The digest is 64 bit FNV-1a, fed field by field so that padding in
+ * the structures doesn't leak into it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "global.h"
+#include "data.h"
+#include "hid/common/digest.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+#define FNV_OFFSET G_GUINT64_CONSTANT (14695981039346656037)
+#define FNV_PRIME G_GUINT64_CONSTANT (1099511628211)
+
+guint64
+export_digest_start (void)
+{
+  return FNV_OFFSET;
+}
+
+guint64
+export_digest_bytes (guint64 d, const void *data, size_t n)
+{
+  const unsigned char *p = (const unsigned char *) data;
+
+  while (n--)
+    {
+      d ^= *p++;
+      d *= FNV_PRIME;
+    }
+  return d;
+}
+
+guint64
+export_digest_int (guint64 d, gint64 v)
+{
+  return export_digest_bytes (d, &v, sizeof (v));
+}
+
+/* The terminating NUL goes in too, so that "ab","c" and "a","bc" differ */
+guint64
+export_digest_string (guint64 d, const char *s)
+{
+  if (s == NULL)
+    return export_digest_int (d, -1);
+  return export_digest_bytes (d, s, strlen (s) + 1);
+}
+
+/* Selection, connection and DRC highlighting, and the search markers,
+ * change how the GUI draws an object but never what is exported, so
+ * finding connections or selecting doesn't force a layer to be rewritten.
+ */
+#define DISPLAY_ONLY_FLAGS \
+  (FOUNDFLAG | CONNECTEDFLAG | SELECTEDFLAG | WARNFLAG | DRCFLAG | VISITFLAG)
+
+static guint64
+digest_flags (guint64 d, FlagType *flags)
+{
+  d = export_digest_int (d, flags->f & ~DISPLAY_ONLY_FLAGS);
+  return export_digest_bytes (d, flags->t, sizeof (flags->t));
+}
+
+static guint64
+digest_line (guint64 d, LineType *line)
+{
+  d = digest_flags (d, &line->Flags);
+  d = export_digest_int (d, line->Point1.X);
+  d = export_digest_int (d, line->Point1.Y);
+  d = export_digest_int (d, line->Point2.X);
+  d = export_digest_int (d, line->Point2.Y);
+  d = export_digest_int (d, line->Thickness);
+  return export_digest_int (d, line->Clearance);
+}
+
+static guint64
+digest_arc (guint64 d, ArcType *arc)
+{
+  d = digest_flags (d, &arc->Flags);
+  d = export_digest_int (d, arc->X);
+  d = export_digest_int (d, arc->Y);
+  d = export_digest_int (d, arc->Width);
+  d = export_digest_int (d, arc->Height);
+  d = export_digest_bytes (d, &arc->StartAngle, sizeof (arc->StartAngle));
+  d = export_digest_bytes (d, &arc->Delta, sizeof (arc->Delta));
+  d = export_digest_int (d, arc->Thickness);
+  return export_digest_int (d, arc->Clearance);
+}
+
+static guint64
+digest_text (guint64 d, TextType *text)
+{
+  d = digest_flags (d, &text->Flags);
+  d = export_digest_int (d, text->X);
+  d = export_digest_int (d, text->Y);
+  d = export_digest_int (d, text->Direction);
+  d = export_digest_int (d, text->Scale);
+  return export_digest_string (d, text->TextString);
+}
+
+static guint64
+digest_pin (guint64 d, PinType *pin)
+{
+  d = digest_flags (d, &pin->Flags);
+  d = export_digest_int (d, pin->X);
+  d = export_digest_int (d, pin->Y);
+  d = export_digest_int (d, pin->Thickness);
+  d = export_digest_int (d, pin->Clearance);
+  d = export_digest_int (d, pin->Mask);
+  d = export_digest_int (d, pin->DrillingHole);
+  return export_digest_string (d, pin->Number);
+}
+
+/* Polygons are exported as clipped by the objects around them, so the
+ * clipped contours are what is digested, not just the outline points.
+ */
+static guint64
+digest_polygon (guint64 d, PolygonType *polygon)
+{
+  POLYAREA *pa;
+  PLINE *pl;
+  VNODE *v;
+
+  d = digest_flags (d, &polygon->Flags);
+  if ((pa = polygon->Clipped) == NULL)
+    return export_digest_int (d, 0);
+  do
+    {
+      for (pl = pa->contours; pl != NULL; pl = pl->next)
+        {
+          d = export_digest_int (d, pl->Count);
+          v = &pl->head;
+          do
+            {
+              d = export_digest_int (d, v->point[0]);
+              d = export_digest_int (d, v->point[1]);
+            }
+          while ((v = v->next) != &pl->head);
+        }
+      d = export_digest_int (d, -1);
+    }
+  while ((pa = pa->f) != polygon->Clipped);
+  return d;
+}
+
+guint64
+export_digest_font (guint64 d, FontType *font)
+{
+  int i;
+
+  for (i = 0; i <= MAX_FONTPOSITION; i++)
+    {
+      SymbolType *symbol = &font->Symbol[i];
+      Cardinal n;
+
+      if (!symbol->Valid)
+        continue;
+      d = export_digest_int (d, i);
+      d = export_digest_int (d, symbol->Width);
+      d = export_digest_int (d, symbol->Delta);
+      for (n = 0; n < symbol->LineN; n++)
+        d = digest_line (d, &symbol->Line[n]);
+    }
+  return d;
+}
+
+guint64
+export_digest_layer (guint64 d, LayerType *layer)
+{
+  d = export_digest_string (d, layer->Name);
+  LINE_LOOP (layer);
+  {
+    d = digest_line (d, line);
+  }
+  END_LOOP;
+  ARC_LOOP (layer);
+  {
+    d = digest_arc (d, arc);
+  }
+  END_LOOP;
+  TEXT_LOOP (layer);
+  {
+    d = digest_text (d, text);
+  }
+  END_LOOP;
+  POLYGON_LOOP (layer);
+  {
+    d = digest_polygon (d, polygon);
+  }
+  END_LOOP;
+  return d;
+}
+
+/* every layer in the group */
+guint64
+export_digest_group (guint64 d, int group)
+{
+  Cardinal i;
+
+  d = export_digest_int (d, group);
+  for (i = 0; i < PCB->LayerGroups.Number[group]; i++)
+    {
+      Cardinal number = PCB->LayerGroups.Entries[group][i];
+
+      d = export_digest_int (d, number);
+      if (number < max_copper_layer + EXTRA_LAYERS)
+        d = export_digest_layer (d, &PCB->Data->Layer[number]);
+    }
+  return d;
+}
+
+/* everything an element draws on any layer */
+guint64
+export_digest_elements (guint64 d, DataType *data)
+{
+  ELEMENT_LOOP (data);
+  {
+    int i;
+
+    d = digest_flags (d, &element->Flags);
+    for (i = 0; i < MAX_ELEMENTNAMES; i++)
+      d = digest_text (d, &element->Name[i]);
+    PIN_LOOP (element);
+    {
+      d = digest_pin (d, pin);
+    }
+    END_LOOP;
+    PAD_LOOP (element);
+    {
+      d = digest_flags (d, &pad->Flags);
+      d = export_digest_int (d, pad->Point1.X);
+      d = export_digest_int (d, pad->Point1.Y);
+      d = export_digest_int (d, pad->Point2.X);
+      d = export_digest_int (d, pad->Point2.Y);
+      d = export_digest_int (d, pad->Thickness);
+      d = export_digest_int (d, pad->Clearance);
+      d = export_digest_int (d, pad->Mask);
+      d = export_digest_string (d, pad->Number);
+    }
+    END_LOOP;
+    ELEMENTLINE_LOOP (element);
+    {
+      d = digest_line (d, line);
+    }
+    END_LOOP;
+    ELEMENTARC_LOOP (element);
+    {
+      d = digest_arc (d, arc);
+    }
+    END_LOOP;
+  }
+  END_LOOP;
+  return d;
+}
+
+guint64
+export_digest_vias (guint64 d, DataType *data)
+{
+  VIA_LOOP (data);
+  {
+    d = digest_pin (d, via);
+  }
+  END_LOOP;
+  return d;
+}
+
+/* only what a drill file shows: where the holes are and how big */
+guint64
+export_digest_holes (guint64 d, DataType *data)
+{
+  ELEMENT_LOOP (data);
+  {
+    PIN_LOOP (element);
+    {
+      d = export_digest_int (d, pin->X);
+      d = export_digest_int (d, pin->Y);
+      d = export_digest_int (d, pin->DrillingHole);
+      d = export_digest_int (d, TEST_FLAG (HOLEFLAG, pin));
+    }
+    END_LOOP;
+  }
+  END_LOOP;
+  VIA_LOOP (data);
+  {
+    d = export_digest_int (d, via->X);
+    d = export_digest_int (d, via->Y);
+    d = export_digest_int (d, via->DrillingHole);
+    d = export_digest_int (d, TEST_FLAG (HOLEFLAG, via));
+  }
+  END_LOOP;
+  return d;
+}
+
+/* ---------------------------------------------------------------------------
+ * Looks for the digest recorded in the header of an existing file.
+ * Returns false if the file can't be read or doesn't carry one.
+ */
+bool
+export_digest_read (const char *filename, guint64 *digest)
+{
+  char line[256];
+  FILE *fp;
+  int n;
+  bool found = false;
+
+  if ((fp = fopen (filename, "rb")) == NULL)
+    return false;
+  /* the digest is written near the top, don't read the whole file */
+  for (n = 0; n < 40 && fgets (line, sizeof (line), fp); n++)
+    {
+      char *tag = strstr (line, EXPORT_DIGEST_TAG);
+
+      if (tag)
+        {
+          *digest = g_ascii_strtoull (tag + strlen (EXPORT_DIGEST_TAG),
+                                      NULL, 16);
+          found = true;
+          break;
+        }
+    }
+  fclose (fp);
+  return found;
+}
@@ -0,0 +1,19 @@
+#ifndef PCB_HID_COMMON_DIGEST_H
+#define PCB_HID_COMMON_DIGEST_H
+
+/* Written into an exported file's header, followed by the digest in hex */
+#define EXPORT_DIGEST_TAG "PCB-Digest:"
+
+guint64 export_digest_start (void);
+guint64 export_digest_bytes (guint64 d, const void *data, size_t n);
+guint64 export_digest_int (guint64 d, gint64 v);
+guint64 export_digest_string (guint64 d, const char *s);
+guint64 export_digest_font (guint64 d, FontType *font);
+guint64 export_digest_layer (guint64 d, LayerType *layer);
+guint64 export_digest_group (guint64 d, int group);
+guint64 export_digest_elements (guint64 d, DataType *data);
+guint64 export_digest_vias (guint64 d, DataType *data);
+guint64 export_digest_holes (guint64 d, DataType *data);
+bool export_digest_read (const char *filename, guint64 *digest);
+
+#endif
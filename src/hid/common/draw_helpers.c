@@ -36,15 +36,101 @@ common_draw_pcb_arc (hidGC gc, ArcType *arc)
 }
 
 /* ---------------------------------------------------------------------------
- * drawing routine for text objects
+ * text stroke cache
+ *
+ * Building a text's strokes means copying, scaling, rotating and swapping
+ * every line of every glyph. The resulting strokes only depend upon the
+ * string and how it is scaled and oriented, so they are cached relative
+ * to the text's origin, and shared between all texts drawn the same way.
+ * The cache is flushed wholesale if it grows too large, or whenever a
+ * font is changed or freed.
  */
+#define TEXT_CACHE_BUCKETS      1024
+#define TEXT_CACHE_MAX_ENTRIES  8192
+
+typedef struct
+{
+  Coord X1, Y1, X2, Y2;
+  Coord Thickness;
+  bool is_box;  /* Default symbol, filled rather than stroked */
+} text_stroke;
+
+typedef struct text_cache_entry
+{
+  struct text_cache_entry *next;
+  FontType *font;
+  char *string;
+  int scale;
+  unsigned direction;
+  bool on_solder;
+  Coord min_line_width;
+  int n_strokes;
+  text_stroke *strokes;
+} text_cache_entry;
+
+static text_cache_entry *text_cache[TEXT_CACHE_BUCKETS];
+static int text_cache_entries = 0;
+
+void
+common_draw_pcb_text_flush_cache (void)
+{
+  text_cache_entry *entry, *next;
+  int i;
+
+  for (i = 0; i < TEXT_CACHE_BUCKETS; i++)
+    {
+      for (entry = text_cache[i]; entry != NULL; entry = next)
+        {
+          next = entry->next;
+          free (entry->string);
+          free (entry->strokes);
+          free (entry);
+        }
+      text_cache[i] = NULL;
+    }
+
+  text_cache_entries = 0;
+}
+
+static unsigned int
+text_cache_hash (FontType *font, const char *string, int scale,
+                 unsigned direction, bool on_solder, Coord min_line_width)
+{
+  unsigned int hash = 5381;
+
+  while (*string)
+    hash = hash * 33 + (unsigned char) *string++;
+
+  hash ^= (unsigned int) scale * 2654435761u;
+  hash ^= (unsigned int) min_line_width * 40503u;
+  hash ^= (direction << 1) | on_solder;
+  hash ^= (unsigned int) ((size_t) font >> 4);
+
+  return hash % TEXT_CACHE_BUCKETS;
+}
+
+static text_stroke *
+add_text_stroke (text_cache_entry *entry, int *space)
+{
+  if (entry->n_strokes == *space)
+    {
+      *space = MAX (16, 2 * *space);
+      entry->strokes = (text_stroke *)realloc (entry->strokes, *space * sizeof (text_stroke));
+    }
+
+  return &entry->strokes[entry->n_strokes++];
+}
+
+/* Transforms the glyph strokes of the text, relative to its origin */
 static void
-common_draw_pcb_text (hidGC gc, TextType *Text, Coord min_line_width)
+build_text_strokes (text_cache_entry *entry, TextType *Text, Coord min_line_width)
 {
   Coord x = 0;
   unsigned char *string = (unsigned char *) Text->TextString;
   Cardinal n;
-  FontType *font = &PCB->Font;
+  FontType *font = entry->font;
+  text_stroke *stroke;
+  int space = 0;
 
   while (string && *string)
     {
@@ -78,12 +164,14 @@ common_draw_pcb_text (hidGC gc, TextType *Text, Coord min_line_width)
                   newline.Point2.X = SWAP_SIGN_X (newline.Point2.X);
                   newline.Point2.Y = SWAP_SIGN_Y (newline.Point2.Y);
                 }
-              /* add offset and draw line */
-              newline.Point1.X += Text->X;
-              newline.Point1.Y += Text->Y;
-              newline.Point2.X += Text->X;
-              newline.Point2.Y += Text->Y;
-              hid_draw_pcb_line (gc, &newline);
+
+              stroke = add_text_stroke (entry, &space);
+              stroke->X1 = newline.Point1.X;
+              stroke->Y1 = newline.Point1.Y;
+              stroke->X2 = newline.Point2.X;
+              stroke->Y2 = newline.Point2.Y;
+              stroke->Thickness = newline.Thickness;
+              stroke->is_box = false;
             }
 
           /* move on to next cursor position */
@@ -92,7 +180,7 @@ common_draw_pcb_text (hidGC gc, TextType *Text, Coord min_line_width)
       else
         {
           /* the default symbol is a filled box */
-          BoxType defaultsymbol = PCB->Font.DefaultSymbol;
+          BoxType defaultsymbol = font->DefaultSymbol;
           Coord size = (defaultsymbol.X2 - defaultsymbol.X1) * 6 / 5;
 
           defaultsymbol.X1 = SCALE_TEXT (defaultsymbol.X1 + x, Text->Scale);
@@ -102,13 +190,13 @@ common_draw_pcb_text (hidGC gc, TextType *Text, Coord min_line_width)
 
           RotateBoxLowLevel (&defaultsymbol, 0, 0, Text->Direction);
 
-          /* add offset and draw box */
-          defaultsymbol.X1 += Text->X;
-          defaultsymbol.Y1 += Text->Y;
-          defaultsymbol.X2 += Text->X;
-          defaultsymbol.Y2 += Text->Y;
-          hid_draw_fill_rect (gc, defaultsymbol.X1, defaultsymbol.Y1,
-                                  defaultsymbol.X2, defaultsymbol.Y2);
+          stroke = add_text_stroke (entry, &space);
+          stroke->X1 = defaultsymbol.X1;
+          stroke->Y1 = defaultsymbol.Y1;
+          stroke->X2 = defaultsymbol.X2;
+          stroke->Y2 = defaultsymbol.Y2;
+          stroke->Thickness = 0;
+          stroke->is_box = true;
 
           /* move on to next cursor position */
           x += size;
@@ -117,6 +205,78 @@ common_draw_pcb_text (hidGC gc, TextType *Text, Coord min_line_width)
     }
 }
 
+static text_cache_entry *
+lookup_text_strokes (TextType *Text, Coord min_line_width)
+{
+  FontType *font = &PCB->Font;
+  const char *string = Text->TextString ? Text->TextString : "";
+  bool on_solder = TEST_FLAG (ONSOLDERFLAG, Text) ? true : false;
+  unsigned int bucket;
+  text_cache_entry *entry;
+
+  bucket = text_cache_hash (font, string, Text->Scale, Text->Direction,
+                            on_solder, min_line_width);
+
+  for (entry = text_cache[bucket]; entry != NULL; entry = entry->next)
+    if (entry->font == font &&
+        entry->scale == Text->Scale &&
+        entry->direction == Text->Direction &&
+        entry->on_solder == on_solder &&
+        entry->min_line_width == min_line_width &&
+        strcmp (entry->string, string) == 0)
+      return entry;
+
+  if (text_cache_entries >= TEXT_CACHE_MAX_ENTRIES)
+    common_draw_pcb_text_flush_cache ();
+
+  entry = (text_cache_entry *)calloc (1, sizeof (text_cache_entry));
+  entry->font = font;
+  entry->string = strdup (string);
+  entry->scale = Text->Scale;
+  entry->direction = Text->Direction;
+  entry->on_solder = on_solder;
+  entry->min_line_width = min_line_width;
+  build_text_strokes (entry, Text, min_line_width);
+
+  entry->next = text_cache[bucket];
+  text_cache[bucket] = entry;
+  text_cache_entries++;
+
+  return entry;
+}
+
+/* ---------------------------------------------------------------------------
+ * drawing routine for text objects
+ */
+static void
+common_draw_pcb_text (hidGC gc, TextType *Text, Coord min_line_width)
+{
+  text_cache_entry *entry = lookup_text_strokes (Text, min_line_width);
+  text_stroke *stroke = entry->strokes;
+  LineType newline;
+  int n;
+
+  memset (&newline, 0, sizeof (newline));
+
+  for (n = entry->n_strokes; n; n--, stroke++)
+    {
+      /* add offset and draw */
+      if (stroke->is_box)
+        {
+          hid_draw_fill_rect (gc, stroke->X1 + Text->X, stroke->Y1 + Text->Y,
+                                  stroke->X2 + Text->X, stroke->Y2 + Text->Y);
+          continue;
+        }
+
+      newline.Point1.X = stroke->X1 + Text->X;
+      newline.Point1.Y = stroke->Y1 + Text->Y;
+      newline.Point2.X = stroke->X2 + Text->X;
+      newline.Point2.Y = stroke->Y2 + Text->Y;
+      newline.Thickness = stroke->Thickness;
+      hid_draw_pcb_line (gc, &newline);
+    }
+}
+
 static void
 fill_contour (hidGC gc, PLINE *pl)
 {
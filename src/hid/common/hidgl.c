@@ -88,6 +88,14 @@ PFNGLMULTITEXCOORD3FPROC    glMultiTexCoord3f    = NULL;
 PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation = NULL;
 PFNGLUNIFORM1IPROC          glUniform1i          = NULL;
 PFNGLACTIVETEXTUREARBPROC   glActiveTextureARB   = NULL;
+
+PFNGLBINDATTRIBLOCATIONPROC       glBindAttribLocation       = NULL;
+PFNGLGETATTRIBLOCATIONPROC        glGetAttribLocation        = NULL;
+PFNGLVERTEXATTRIBPOINTERPROC      glVertexAttribPointer      = NULL;
+PFNGLENABLEVERTEXATTRIBARRAYPROC  glEnableVertexAttribArray  = NULL;
+PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArray = NULL;
+PFNGLVERTEXATTRIBDIVISORPROC      glVertexAttribDivisor      = NULL;
+PFNGLDRAWARRAYSINSTANCEDPROC      glDrawArraysInstanced      = NULL;
 #endif
 
 #include "action.h"
@@ -113,6 +121,26 @@ PFNGLACTIVETEXTUREARBPROC   glActiveTextureARB   = NULL;
 hidgl_shader *circular_program = NULL;
 hidgl_shader *resistor_program = NULL;
 
+/* Instanced variant of circular_program, see hidgl_flush_instances() */
+static hidgl_shader *circular_instanced_program = NULL;
+static bool have_instancing = false;
+static GLint circle_attr;
+static GLint hole_attr;
+static GLint color_attr;
+
+/* Arcs drawn as single quads, see hidgl_draw_arc() */
+static hidgl_shader *arc_instanced_program = NULL;
+static GLint arc_bounds_attr;
+static GLint arc_attr;
+static GLint arc_sweep_attr;
+static GLint arc_color_attr;
+
+/* Drill channels drawn from unit cylinder meshes, see hidgl_queue_cylinder() */
+static hidgl_shader *cylinder_instanced_program = NULL;
+static GLint cylinder_attr;
+static GLint cylinder_span_attr;
+static GLint cylinder_color_attr;
+
 static bool in_context = false;
 
 #define CHECK_IS_IN_CONTEXT(retcode) \
@@ -124,10 +152,40 @@ static bool in_context = false;
     } \
   } while (0)
 
+/* Recorders never touch GL state, so may also be used from worker threads
+ * whilst the GL thread is outside its rendering context.
+ */
+#define CHECK_CAN_RECORD(hidgl) \
+  do { \
+    if (!(hidgl)->priv->recorder) \
+      CHECK_IS_IN_CONTEXT (); \
+  } while (0)
+
 
 #define BUFFER_STRIDE (5 * sizeof (GLfloat))
 #define BUFFER_SIZE (BUFFER_STRIDE * 3 * TRIANGLE_ARRAY_SIZE)
 
+/* Accounts for a draw call of a tri-strip with the given number of vertices */
+static void
+count_strip (hidgl_priv *priv, int vertices)
+{
+  priv->stats.draw_calls++;
+  priv->stats.vertices += vertices;
+  priv->stats.triangles += MAX (vertices - 2, 0);
+}
+
+/* Accounts for an instanced draw call of a tri-strip with the given
+ * number of vertices per instance
+ */
+static void
+count_instances (hidgl_priv *priv, int instances, int vertices)
+{
+  priv->stats.draw_calls++;
+  priv->stats.instances += instances;
+  priv->stats.vertices += vertices * instances;
+  priv->stats.triangles += (vertices - 2) * instances;
+}
+
 /* NB: If using VBOs, the caller must ensure the VBO is bound to the GL_ARRAY_BUFFER */
 static void
 hidgl_reset_triangle_array (hidgl_instance *hidgl)
@@ -150,7 +208,8 @@ hidgl_reset_triangle_array (hidgl_instance *hidgl)
   }
 
   /* Don't want this bound for now */
-  glBindBuffer (GL_ARRAY_BUFFER, 0);
+  if (!priv->recorder)
+    glBindBuffer (GL_ARRAY_BUFFER, 0);
 
   priv->buffer.triangle_count = 0;
   priv->buffer.coord_comp_count = 0;
@@ -192,6 +251,169 @@ hidgl_init_triangle_array (hidgl_instance *hidgl)
   hidgl_reset_triangle_array (hidgl);
 }
 
+/* Number of vertices in the tri-strip of a cylinder's sides */
+#define CYLINDER_VERTICES(slices) (2 * (slices) + 2)
+
+/* Uploads a unit cylinder's sides as a tri-strip. Each vertex is the x and
+ * y of a point on the unit circle, and 0 or 1 for the bottom or top end.
+ */
+static void
+upload_cylinder_mesh (GLuint vbo_id, int slices)
+{
+  GLfloat *mesh = malloc (sizeof (GLfloat) * 3 * CYLINDER_VERTICES (slices));
+  GLfloat *vertex = mesh;
+  int i;
+
+  for (i = 0; i <= slices; i++)
+    {
+      float angle = (float)i * 2. * M_PI / (float)slices;
+
+      *vertex++ = cosf (angle);
+      *vertex++ = sinf (angle);
+      *vertex++ = 0.0;
+      *vertex++ = cosf (angle);
+      *vertex++ = sinf (angle);
+      *vertex++ = 1.0;
+    }
+
+  glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+  glBufferData (GL_ARRAY_BUFFER,
+                sizeof (GLfloat) * 3 * CYLINDER_VERTICES (slices),
+                mesh, GL_STATIC_DRAW);
+  free (mesh);
+}
+
+/* Creates the quad, unit cylinder meshes and instance VBOs. These are only
+ * built once, when the GL context is first made current.
+ */
+static void
+hidgl_init_instance_batches (hidgl_instance *hidgl)
+{
+  hidgl_priv *priv = hidgl->priv;
+  static const GLfloat corners[] = {-1.0, -1.0,
+                                    -1.0,  1.0,
+                                     1.0, -1.0,
+                                     1.0,  1.0};
+  int i;
+
+  if (!have_instancing)
+    return;
+
+  glGenBuffers (1, &priv->quad_vbo_id);
+  glGenBuffers (1, &priv->circles.instance_vbo_id);
+  glGenBuffers (1, &priv->arcs.instance_vbo_id);
+
+  glBindBuffer (GL_ARRAY_BUFFER, priv->quad_vbo_id);
+  glBufferData (GL_ARRAY_BUFFER, sizeof (corners), corners, GL_STATIC_DRAW);
+
+  for (i = 0; i < CYLINDER_MESHES; i++)
+    {
+      glGenBuffers (1, &priv->cylinder_vbo_ids[i]);
+      glGenBuffers (1, &priv->cylinders[i].instance_vbo_id);
+      upload_cylinder_mesh (priv->cylinder_vbo_ids[i], MIN_CYLINDER_SLICES << i);
+    }
+
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+}
+
+static void
+hidgl_reset_instance_batches (hidgl_instance *hidgl)
+{
+  hidgl_priv *priv = hidgl->priv;
+  int i;
+
+  priv->circles.instance_count = 0;
+  priv->arcs.instance_count = 0;
+  for (i = 0; i < CYLINDER_MESHES; i++)
+    priv->cylinders[i].instance_count = 0;
+}
+
+static void
+hidgl_finish_instance_batches (hidgl_instance *hidgl)
+{
+  hidgl_priv *priv = hidgl->priv;
+  int i;
+
+  free (priv->circles.instance_data);
+  free (priv->arcs.instance_data);
+  for (i = 0; i < CYLINDER_MESHES; i++)
+    free (priv->cylinders[i].instance_data);
+
+  /* Otherwise the buffers go with the GL context */
+  if (priv->recorder || !have_instancing || !in_context)
+    return;
+
+  glDeleteBuffers (1, &priv->quad_vbo_id);
+  glDeleteBuffers (1, &priv->circles.instance_vbo_id);
+  glDeleteBuffers (1, &priv->arcs.instance_vbo_id);
+  glDeleteBuffers (CYLINDER_MESHES, priv->cylinder_vbo_ids);
+  for (i = 0; i < CYLINDER_MESHES; i++)
+    glDeleteBuffers (1, &priv->cylinders[i].instance_vbo_id);
+}
+
+/* Returns space for one more instance of the given size in the batch */
+static GLfloat *
+batch_add_instance (instance_batch *batch, int size)
+{
+  if (batch->instance_count == batch->instance_space)
+    {
+      batch->instance_space = MAX (1024, 2 * batch->instance_space);
+      batch->instance_data = realloc (batch->instance_data,
+                                      sizeof (GLfloat) * size * batch->instance_space);
+    }
+
+  return batch->instance_data + size * batch->instance_count++;
+}
+
+/* Draws count arc instances, already uploaded into the given VBO, from the
+ * first onwards.
+ */
+static void
+draw_arc_instances (hidgl_priv *priv, GLuint vbo_id, int first, int count)
+{
+  GLsizei stride = sizeof (GLfloat) * ARC_INSTANCE_SIZE;
+  GLfloat *base = (GLfloat *)NULL + ARC_INSTANCE_SIZE * first;
+  GLint program;
+
+  glGetIntegerv (GL_CURRENT_PROGRAM, &program);
+  hidgl_shader_activate (arc_instanced_program);
+
+  /* Per-vertex corners of the quad, shared by every instance */
+  glBindBuffer (GL_ARRAY_BUFFER, priv->quad_vbo_id);
+  glVertexAttribPointer (0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+  glEnableVertexAttribArray (0);
+
+  glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+  glVertexAttribPointer (arc_bounds_attr, 4, GL_FLOAT, GL_FALSE, stride, base + 0);
+  glVertexAttribPointer (arc_attr,        4, GL_FLOAT, GL_FALSE, stride, base + 4);
+  glVertexAttribPointer (arc_sweep_attr,  4, GL_FLOAT, GL_FALSE, stride, base + 8);
+  glVertexAttribPointer (arc_color_attr,  4, GL_FLOAT, GL_FALSE, stride, base + 12);
+  glEnableVertexAttribArray (arc_bounds_attr);
+  glEnableVertexAttribArray (arc_attr);
+  glEnableVertexAttribArray (arc_sweep_attr);
+  glEnableVertexAttribArray (arc_color_attr);
+  glVertexAttribDivisor (arc_bounds_attr, 1);
+  glVertexAttribDivisor (arc_attr, 1);
+  glVertexAttribDivisor (arc_sweep_attr, 1);
+  glVertexAttribDivisor (arc_color_attr, 1);
+
+  glDrawArraysInstanced (GL_TRIANGLE_STRIP, 0, 4, count);
+  count_instances (priv, count, 4);
+
+  glVertexAttribDivisor (arc_bounds_attr, 0);
+  glVertexAttribDivisor (arc_attr, 0);
+  glVertexAttribDivisor (arc_sweep_attr, 0);
+  glVertexAttribDivisor (arc_color_attr, 0);
+  glDisableVertexAttribArray (arc_color_attr);
+  glDisableVertexAttribArray (arc_sweep_attr);
+  glDisableVertexAttribArray (arc_attr);
+  glDisableVertexAttribArray (arc_bounds_attr);
+  glDisableVertexAttribArray (0);
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+  glUseProgram (program);
+}
+
 static void
 hidgl_finish_triangle_array (hidgl_instance *hidgl)
 {
@@ -211,17 +433,132 @@ hidgl_finish_triangle_array (hidgl_instance *hidgl)
   }
 }
 
+/* Retained geometry
+ *
+ * Geometry which doesn't change from frame to frame can be recorded into a
+ * hidgl_retained object rather than being streamed through the triangle
+ * buffer each time. The object is split into chunks which the caller may
+ * invalidate and re-record independently. When drawn, the chunks are
+ * concatenated into a static VBO, which is rendered with one glDrawArrays
+ * call per run of identically coloured vertices. Arcs recorded whilst
+ * instancing is available are kept as instances, and replayed afterwards
+ * in a single instanced call. The caller may pick which chunks to draw,
+ * such as only those in view, without the VBO being uploaded again.
+ *
+ * Chunks may be recorded from worker threads, each using its own recorder
+ * (see hidgl_new_recorder()), so long as no two threads record into the
+ * same chunk at once. Only the GL thread may draw the retained object.
+ *
+ * Each chunk is double-buffered. A chunk may be recorded into its back
+ * buffer with hidgl_retained_begin_pending_chunk(), whilst the GL thread
+ * carries on drawing its previous contents, until the GL thread swaps the
+ * finished recording in with hidgl_retained_swap_pending().
+ */
+
+typedef struct {
+  GLfloat color[4];
+  GLint first;
+  GLsizei count;
+} retained_run;
+
+typedef struct hidgl_retained_chunk {
+  GLfloat *vertices;
+  int vertex_count;
+  int vertex_space;
+  retained_run *runs;
+  int run_count;
+  int run_space;
+  instance_batch arcs;
+  int first_vertex;  /* Offsets into the concatenated geometry */
+  int first_arc;
+  bool dirty;
+  bool changed;  /* Re-recorded since the last upload */
+  struct hidgl_retained_chunk *pending;  /* Back buffer, see above */
+} retained_chunk;
+
+struct hidgl_retained {
+  int num_chunks;
+  retained_chunk *chunks;
+
+  /* Concatenated geometry of all chunks */
+  GLuint vbo_id;
+  GLfloat *vertices;  /* Only kept if we have no VBO to upload into */
+  int vertex_count;
+  retained_run *runs;  /* Of the chunks last drawn */
+  int run_count;
+  int run_space;
+  GLuint arc_vbo_id;
+  int arc_count;
+};
+
+static void
+add_run (retained_run **runs, int *run_count, int *run_space,
+         const GLfloat color[4], GLint first, GLsizei count)
+{
+  retained_run *last = (*run_count > 0) ? &(*runs)[*run_count - 1] : NULL;
+
+  /* Extend the previous run if it is the same colour and adjoins this one */
+  if (last != NULL &&
+      last->first + last->count == first &&
+      memcmp (last->color, color, sizeof (last->color)) == 0)
+    {
+      last->count += count;
+      return;
+    }
+
+  if (*run_count == *run_space)
+    {
+      *run_space = MAX (16, 2 * *run_space);
+      *runs = realloc (*runs, *run_space * sizeof (retained_run));
+    }
+
+  last = &(*runs)[(*run_count)++];
+  memcpy (last->color, color, sizeof (last->color));
+  last->first = first;
+  last->count = count;
+}
+
+static void
+record_triangles (hidgl_priv *priv)
+{
+  retained_chunk *chunk = priv->recording;
+  int new_count = chunk->vertex_count + priv->buffer.vertex_count;
+
+  if (new_count > chunk->vertex_space)
+    {
+      chunk->vertex_space = MAX (new_count, 2 * chunk->vertex_space);
+      chunk->vertices = realloc (chunk->vertices, BUFFER_STRIDE * chunk->vertex_space);
+    }
+
+  memcpy (chunk->vertices + 5 * chunk->vertex_count,
+          priv->buffer.triangle_array,
+          BUFFER_STRIDE * priv->buffer.vertex_count);
+
+  add_run (&chunk->runs, &chunk->run_count, &chunk->run_space,
+           priv->color, chunk->vertex_count, priv->buffer.vertex_count);
+
+  chunk->vertex_count = new_count;
+}
+
 void
 hidgl_flush_triangles (hidgl_instance *hidgl)
 {
   hidgl_priv *priv = hidgl->priv;
   GLfloat *data_pointer = NULL;
 
-  CHECK_IS_IN_CONTEXT ();
+  CHECK_CAN_RECORD (hidgl);
 
   if (priv->buffer.vertex_count == 0)
     return;
 
+  /* When recording, the geometry is stashed for later rather than drawn */
+  if (priv->recording != NULL)
+    {
+      record_triangles (priv);
+      hidgl_reset_triangle_array (hidgl);
+      return;
+    }
+
   if (priv->buffer.use_vbo) {
     glBindBuffer (GL_ARRAY_BUFFER, priv->buffer.vbo_id);
 
@@ -244,6 +581,8 @@ hidgl_flush_triangles (hidgl_instance *hidgl)
   glEnableClientState (GL_TEXTURE_COORD_ARRAY);
   glEnableClientState (GL_VERTEX_ARRAY);
   glDrawArrays (GL_TRIANGLE_STRIP, 0, priv->buffer.vertex_count);
+  count_strip (priv, priv->buffer.vertex_count);
+  priv->stats.flushes++;
 #if 0
   glPushAttrib (GL_CURRENT_BIT);
   glColor4f (1., 1., 1., 1.);
@@ -256,6 +595,378 @@ hidgl_flush_triangles (hidgl_instance *hidgl)
   hidgl_reset_triangle_array (hidgl);
 }
 
+hidgl_retained *
+hidgl_retained_new (int num_chunks)
+{
+  hidgl_retained *retained;
+  int i;
+
+  retained = calloc (1, sizeof (hidgl_retained));
+  retained->num_chunks = num_chunks;
+  retained->chunks = calloc (num_chunks, sizeof (retained_chunk));
+
+  for (i = 0; i < num_chunks; i++)
+    retained->chunks[i].dirty = true;
+
+  return retained;
+}
+
+void
+hidgl_retained_free (hidgl_retained *retained)
+{
+  int i;
+
+  if (retained == NULL)
+    return;
+
+  for (i = 0; i < retained->num_chunks; i++)
+    {
+      retained_chunk *pending = retained->chunks[i].pending;
+
+      free (retained->chunks[i].vertices);
+      free (retained->chunks[i].runs);
+      free (retained->chunks[i].arcs.instance_data);
+
+      if (pending != NULL)
+        {
+          free (pending->vertices);
+          free (pending->runs);
+          free (pending->arcs.instance_data);
+          free (pending);
+        }
+    }
+
+  /* NB: We can only release the VBO whilst we have a GL context, otherwise
+   *     it goes away along with the context itself.
+   */
+  if (retained->vbo_id != 0 && in_context)
+    glDeleteBuffers (1, &retained->vbo_id);
+  if (retained->arc_vbo_id != 0 && in_context)
+    glDeleteBuffers (1, &retained->arc_vbo_id);
+
+  free (retained->chunks);
+  free (retained->vertices);
+  free (retained->runs);
+  free (retained);
+}
+
+void
+hidgl_retained_invalidate (hidgl_retained *retained, int chunk)
+{
+  retained->chunks[chunk].dirty = true;
+}
+
+void
+hidgl_retained_invalidate_all (hidgl_retained *retained)
+{
+  int i;
+
+  for (i = 0; i < retained->num_chunks; i++)
+    retained->chunks[i].dirty = true;
+}
+
+bool
+hidgl_retained_chunk_is_dirty (hidgl_retained *retained, int chunk)
+{
+  return retained->chunks[chunk].dirty;
+}
+
+/* Marks a chunk as up to date, for callers recording it asynchronously,
+ * which need any invalidation after this point to be noticed.
+ */
+void
+hidgl_retained_mark_clean (hidgl_retained *retained, int chunk)
+{
+  retained->chunks[chunk].dirty = false;
+}
+
+static void
+begin_recording (hidgl_instance *hidgl, retained_chunk *c)
+{
+  hidgl_priv *priv = hidgl->priv;
+
+  /* Draw anything already queued, it isn't part of the recording */
+  hidgl_flush_instances (hidgl);
+  hidgl_flush_triangles (hidgl);
+
+  c->vertex_count = 0;
+  c->run_count = 0;
+  c->arcs.instance_count = 0;
+
+  priv->recording = c;
+}
+
+/* Start recording into the given chunk, replacing its previous contents.
+ * Anything drawn until hidgl_retained_end_chunk() is stored in the chunk
+ * rather than being rendered.
+ */
+void
+hidgl_retained_begin_chunk (hidgl_instance *hidgl, hidgl_retained *retained, int chunk)
+{
+  retained_chunk *c = &retained->chunks[chunk];
+
+  CHECK_CAN_RECORD (hidgl);
+
+  begin_recording (hidgl, c);
+  c->dirty = false;
+  c->changed = true;
+}
+
+/* Start recording into the back buffer of the given chunk, leaving what is
+ * drawn untouched until hidgl_retained_swap_pending() is called. The chunk
+ * must not be swapped, drawn from another recording, or freed until the
+ * recording has ended.
+ */
+void
+hidgl_retained_begin_pending_chunk (hidgl_instance *hidgl, hidgl_retained *retained, int chunk)
+{
+  retained_chunk *c = &retained->chunks[chunk];
+
+  CHECK_CAN_RECORD (hidgl);
+
+  if (c->pending == NULL)
+    c->pending = calloc (1, sizeof (retained_chunk));
+
+  begin_recording (hidgl, c->pending);
+}
+
+/* Replaces the contents of a chunk with the recording finished in its back
+ * buffer. The chunk's dirty state is left alone, so any invalidation since
+ * the recording started still holds.
+ */
+void
+hidgl_retained_swap_pending (hidgl_retained *retained, int chunk)
+{
+  retained_chunk *c = &retained->chunks[chunk];
+  retained_chunk *back = c->pending;
+  retained_chunk front = *c;
+
+  if (back == NULL)
+    return;
+
+  *c = *back;
+  c->dirty = front.dirty;
+  c->changed = true;
+  c->pending = back;
+
+  *back = front;
+  back->pending = NULL;
+}
+
+void
+hidgl_retained_end_chunk (hidgl_instance *hidgl)
+{
+  hidgl_priv *priv = hidgl->priv;
+
+  CHECK_CAN_RECORD (hidgl);
+
+  hidgl_flush_triangles (hidgl);
+  priv->recording = NULL;
+}
+
+static void
+retained_upload_arcs (hidgl_retained *retained)
+{
+  GLsizeiptr stride = sizeof (GLfloat) * ARC_INSTANCE_SIZE;
+  GLintptr offset = 0;
+  int i;
+
+  retained->arc_count = 0;
+  for (i = 0; i < retained->num_chunks; i++)
+    retained->arc_count += retained->chunks[i].arcs.instance_count;
+
+  if (retained->arc_count == 0)
+    return;
+
+  if (retained->arc_vbo_id == 0)
+    glGenBuffers (1, &retained->arc_vbo_id);
+
+  glBindBuffer (GL_ARRAY_BUFFER, retained->arc_vbo_id);
+  glBufferData (GL_ARRAY_BUFFER, stride * retained->arc_count, NULL, GL_STATIC_DRAW);
+
+  for (i = 0; i < retained->num_chunks; i++)
+    {
+      instance_batch *arcs = &retained->chunks[i].arcs;
+
+      retained->chunks[i].first_arc = offset / stride;
+      glBufferSubData (GL_ARRAY_BUFFER, offset, stride * arcs->instance_count,
+                       arcs->instance_data);
+      offset += stride * arcs->instance_count;
+    }
+
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+}
+
+static bool
+retained_changed (hidgl_retained *retained)
+{
+  int i;
+
+  for (i = 0; i < retained->num_chunks; i++)
+    if (retained->chunks[i].changed)
+      return true;
+
+  return false;
+}
+
+static void
+retained_upload (hidgl_retained *retained)
+{
+  int total = 0;
+  int i;
+
+  for (i = 0; i < retained->num_chunks; i++)
+    total += retained->chunks[i].vertex_count;
+
+  retained->vertices = realloc (retained->vertices, BUFFER_STRIDE * MAX (total, 1));
+
+  total = 0;
+  for (i = 0; i < retained->num_chunks; i++)
+    {
+      retained_chunk *chunk = &retained->chunks[i];
+
+      chunk->changed = false;
+      chunk->first_vertex = total;
+      memcpy (retained->vertices + 5 * total, chunk->vertices,
+              BUFFER_STRIDE * chunk->vertex_count);
+      total += chunk->vertex_count;
+    }
+
+  retained->vertex_count = total;
+
+  retained_upload_arcs (retained);
+
+  if (retained->vbo_id == 0)
+    glGenBuffers (1, &retained->vbo_id);
+
+  if (retained->vbo_id == 0)
+    return;
+
+  glBindBuffer (GL_ARRAY_BUFFER, retained->vbo_id);
+  glBufferData (GL_ARRAY_BUFFER, BUFFER_STRIDE * total, retained->vertices, GL_STATIC_DRAW);
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+  /* The GL keeps its own copy now */
+  free (retained->vertices);
+  retained->vertices = NULL;
+}
+
+/* Gathers the runs of the chunks to be drawn */
+static void
+retained_gather_runs (hidgl_retained *retained, const bool *visible)
+{
+  int i, j;
+
+  retained->run_count = 0;
+  for (i = 0; i < retained->num_chunks; i++)
+    {
+      retained_chunk *chunk = &retained->chunks[i];
+
+      if (visible != NULL && !visible[i])
+        continue;
+
+      /* NB: Runs of the same colour merge across chunk boundaries */
+      for (j = 0; j < chunk->run_count; j++)
+        add_run (&retained->runs, &retained->run_count, &retained->run_space,
+                 chunk->runs[j].color, chunk->first_vertex + chunk->runs[j].first,
+                 chunk->runs[j].count);
+    }
+}
+
+/* Draws the arcs of the chunks to be drawn, one call per consecutive run
+ * of them.
+ */
+static void
+retained_draw_arcs (hidgl_priv *priv, hidgl_retained *retained, const bool *visible)
+{
+  int first = 0;
+  int count = 0;
+  int i;
+
+  for (i = 0; i < retained->num_chunks; i++)
+    {
+      retained_chunk *chunk = &retained->chunks[i];
+
+      if (visible != NULL && !visible[i])
+        continue;
+
+      if (count > 0 && first + count != chunk->first_arc)
+        {
+          draw_arc_instances (priv, retained->arc_vbo_id, first, count);
+          count = 0;
+        }
+
+      if (count == 0)
+        first = chunk->first_arc;
+      count += chunk->arcs.instance_count;
+    }
+
+  if (count > 0)
+    draw_arc_instances (priv, retained->arc_vbo_id, first, count);
+}
+
+static void
+retained_draw_runs (hidgl_priv *priv, hidgl_retained *retained)
+{
+  GLfloat *data_pointer = NULL;
+  int i;
+
+  if (retained->vbo_id != 0)
+    glBindBuffer (GL_ARRAY_BUFFER, retained->vbo_id);
+  else
+    data_pointer = retained->vertices;
+
+  glTexCoordPointer (2, GL_FLOAT, BUFFER_STRIDE, data_pointer + 3);
+  glVertexPointer   (3, GL_FLOAT, BUFFER_STRIDE, data_pointer + 0);
+
+  glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+  glEnableClientState (GL_VERTEX_ARRAY);
+
+  for (i = 0; i < retained->run_count; i++)
+    {
+      glColor4fv (retained->runs[i].color);
+      glDrawArrays (GL_TRIANGLE_STRIP, retained->runs[i].first, retained->runs[i].count);
+      count_strip (priv, retained->runs[i].count);
+    }
+
+  glDisableClientState (GL_VERTEX_ARRAY);
+  glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+  /* Leave the GL colour as our caller last set it */
+  glColor4fv (priv->color);
+}
+
+/* Draws the retained geometry. If visible isn't NULL, only the chunks it
+ * flags are drawn.
+ */
+void
+hidgl_retained_draw (hidgl_instance *hidgl, hidgl_retained *retained, const bool *visible)
+{
+  hidgl_priv *priv = hidgl->priv;
+
+  CHECK_IS_IN_CONTEXT ();
+
+  /* Keep the ordering with respect to anything queued before us */
+  hidgl_flush_instances (hidgl);
+  hidgl_flush_triangles (hidgl);
+
+  if (retained_changed (retained))
+    {
+      retained_upload (retained);
+      priv->stats.retained_uploads++;
+    }
+
+  retained_gather_runs (retained, visible);
+  if (retained->run_count > 0)
+    retained_draw_runs (priv, retained);
+
+  /* NB: Instanced arcs carry their own colours */
+  if (retained->arc_count > 0)
+    retained_draw_arcs (priv, retained, visible);
+}
+
 void
 hidgl_ensure_vertex_space (hidGC gc, int count)
 {
@@ -263,7 +974,7 @@ hidgl_ensure_vertex_space (hidGC gc, int count)
   hidgl_instance *hidgl = hidgl_gc->hidgl;
   hidgl_priv *priv = hidgl->priv;
 
-  CHECK_IS_IN_CONTEXT ();
+  CHECK_CAN_RECORD (hidgl);
 
   if (count > 3 * TRIANGLE_ARRAY_SIZE)
     {
@@ -279,7 +990,7 @@ hidgl_ensure_vertex_space (hidGC gc, int count)
 void
 hidgl_ensure_triangle_space (hidGC gc, int count)
 {
-  CHECK_IS_IN_CONTEXT ();
+  CHECK_CAN_RECORD (((hidglGC)gc)->hidgl);
 
   /* NB: 5 = 3 + 2 extra vertices to separate from other triangle strips */
   hidgl_ensure_vertex_space (gc, count * 5);
@@ -369,7 +1080,7 @@ static void draw_cap (hidGC gc, Coord width, Coord x, Coord y, Angle angle)
 {
   float radius = width / 2.;
 
-  CHECK_IS_IN_CONTEXT ();
+  CHECK_CAN_RECORD (((hidglGC)gc)->hidgl);
 
   hidgl_ensure_vertex_space (gc, 6);
 
@@ -396,7 +1107,7 @@ hidgl_draw_line (hidGC gc, int cap, Coord width, Coord x1, Coord y1, Coord x2, C
   int circular_caps = 0;
   int hairline = 0;
 
-  CHECK_IS_IN_CONTEXT ();
+  CHECK_CAN_RECORD (((hidglGC)gc)->hidgl);
   if (width == 0.0)
     hairline = 1;
 
@@ -483,8 +1194,8 @@ hidgl_draw_line (hidGC gc, int cap, Coord width, Coord x1, Coord y1, Coord x2, C
 
 #define MIN_SLICES_PER_ARC 6
 #define MAX_SLICES_PER_ARC 360
-void
-hidgl_draw_arc (hidGC gc, Coord width, Coord x, Coord y, Coord rx, Coord ry,
+static void
+tessellate_arc (hidGC gc, Coord width, Coord x, Coord y, Coord rx, Coord ry,
                 Angle start_angle, Angle delta_angle, double scale)
 {
   float last_inner_x, last_inner_y;
@@ -501,98 +1212,461 @@ hidgl_draw_arc (hidGC gc, Coord width, Coord x, Coord y, Coord rx, Coord ry,
   int i;
   int hairline = 0;
 
-  CHECK_IS_IN_CONTEXT ();
+  CHECK_CAN_RECORD (((hidglGC)gc)->hidgl);
   if (width == 0.0)
     hairline = 1;
 
-  if (width < scale)
-    width = scale;
+  if (width < scale)
+    width = scale;
+
+  inner_r = rx - width / 2.;
+  outer_r = rx + width / 2.;
+
+  if (delta_angle < 0) {
+    start_angle += delta_angle;
+    delta_angle = - delta_angle;
+  }
+
+  start_angle_rad = start_angle * M_PI / 180.;
+  delta_angle_rad = delta_angle * M_PI / 180.;
+
+  slices = calc_slices ((rx + width / 2.) / scale, delta_angle_rad);
+
+  if (slices < MIN_SLICES_PER_ARC)
+    slices = MIN_SLICES_PER_ARC;
+
+  if (slices > MAX_SLICES_PER_ARC)
+    slices = MAX_SLICES_PER_ARC;
+
+  hidgl_ensure_triangle_space (gc, 2 * slices);
+
+  angle_incr_rad = delta_angle_rad / (float)slices;
+
+  cos_ang = cosf (start_angle_rad);
+  sin_ang = sinf (start_angle_rad);
+  last_inner_x = -inner_r * cos_ang + x;  last_inner_y = inner_r * sin_ang + y;
+  last_outer_x = -outer_r * cos_ang + x;  last_outer_y = outer_r * sin_ang + y;
+  for (i = 1; i <= slices; i++) {
+    cos_ang = cosf (start_angle_rad + ((float)(i)) * angle_incr_rad);
+    sin_ang = sinf (start_angle_rad + ((float)(i)) * angle_incr_rad);
+    inner_x = -inner_r * cos_ang + x;  inner_y = inner_r * sin_ang + y;
+    outer_x = -outer_r * cos_ang + x;  outer_y = outer_r * sin_ang + y;
+    hidgl_add_triangle (gc, last_inner_x, last_inner_y,
+                            last_outer_x, last_outer_y,
+                            outer_x, outer_y);
+    hidgl_add_triangle (gc, last_inner_x, last_inner_y,
+                            inner_x, inner_y,
+                            outer_x, outer_y);
+    last_inner_x = inner_x;  last_inner_y = inner_y;
+    last_outer_x = outer_x;  last_outer_y = outer_y;
+  }
+
+  /* Don't bother capping hairlines */
+  if (hairline)
+    return;
+
+  draw_cap (gc, width, x + rx * -cosf (start_angle_rad),
+                       y + rx *  sinf (start_angle_rad),
+                       start_angle);
+  draw_cap (gc, width, x + rx * -cosf (start_angle_rad + delta_angle_rad),
+                       y + rx *  sinf (start_angle_rad + delta_angle_rad),
+                       start_angle + delta_angle + 180.);
+}
+
+/* Grows the box in bounds[] (x1, y1, x2, y2) to include the point */
+static void
+bounds_add_point (GLfloat *bounds, float x, float y)
+{
+  bounds[0] = MIN (bounds[0], x);
+  bounds[1] = MIN (bounds[1], y);
+  bounds[2] = MAX (bounds[2], x);
+  bounds[3] = MAX (bounds[3], y);
+}
+
+/* Computes the bounding box of an arc's centre-line, including its end
+ * points and any of the four axis extremes the arc sweeps through.
+ */
+static void
+arc_bounds (GLfloat *bounds, float x, float y, float radius,
+            float start_rad, float delta_rad)
+{
+  float end_rad = start_rad + delta_rad;
+  int i;
+
+  bounds[0] = bounds[2] = x - radius * cosf (start_rad);
+  bounds[1] = bounds[3] = y + radius * sinf (start_rad);
+  bounds_add_point (bounds, x - radius * cosf (end_rad),
+                            y + radius * sinf (end_rad));
+
+  for (i = 0; i < 4; i++)
+    {
+      float extreme_rad = i * M_PI / 2.;
+
+      if (fmodf (extreme_rad - start_rad + 2. * M_PI, 2. * M_PI) <= delta_rad)
+        bounds_add_point (bounds, x - radius * cosf (extreme_rad),
+                                  y + radius * sinf (extreme_rad));
+    }
+}
+
+/* Draws an arc as a single quad over its bounding box, leaving the
+ * arc_instanced_program fragment shader to discard anything outside of
+ * the annulus sector and its round end caps.
+ *
+ * NB: Like circles, arcs are queued and drawn in one instanced call by
+ *     hidgl_flush_instances(). Arcs drawn whilst recording retained
+ *     geometry are stashed as instances along with the recording.
+ */
+void
+hidgl_draw_arc (hidGC gc, Coord width, Coord x, Coord y, Coord rx, Coord ry,
+                Angle start_angle, Angle delta_angle, double scale)
+{
+  hidglGC hidgl_gc = (hidglGC)gc;
+  hidgl_priv *priv = hidgl_gc->hidgl->priv;
+  float start_angle_rad;
+  float delta_angle_rad;
+  float half_width;
+  float cap_radius;
+  GLfloat *instance;
+
+  CHECK_CAN_RECORD (((hidglGC)gc)->hidgl);
+
+  if (!have_instancing || rx <= 0)
+    {
+      tessellate_arc (gc, width, x, y, rx, ry, start_angle, delta_angle, scale);
+      return;
+    }
+
+  /* Don't bother capping hairlines */
+  cap_radius = (width == 0) ? 0. : width / 2.;
+
+  if (width < scale)
+    width = scale;
+
+  half_width = width / 2.;
+
+  if (delta_angle < 0) {
+    start_angle += delta_angle;
+    delta_angle = - delta_angle;
+  }
+
+  start_angle_rad = fmod (start_angle, 360.) * M_PI / 180.;
+  if (start_angle_rad < 0)
+    start_angle_rad += 2. * M_PI;
+  delta_angle_rad = MIN (delta_angle, 360.) * M_PI / 180.;
+
+  if (priv->recording != NULL)
+    instance = batch_add_instance (&priv->recording->arcs, ARC_INSTANCE_SIZE);
+  else
+    instance = batch_add_instance (&priv->arcs, ARC_INSTANCE_SIZE);
+
+  arc_bounds (&instance[0], x, y, rx, start_angle_rad, delta_angle_rad);
+  instance[0] -= half_width;
+  instance[1] -= half_width;
+  instance[2] += half_width;
+  instance[3] += half_width;
+
+  instance[4] = x;
+  instance[5] = y;
+  instance[6] = hidgl_gc->depth;
+  instance[7] = rx;
+
+  instance[8] = half_width;
+  instance[9] = start_angle_rad;
+  instance[10] = delta_angle_rad;
+  instance[11] = cap_radius;
+
+  memcpy (&instance[12], priv->color, sizeof (priv->color));
+}
+
+void
+hidgl_draw_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
+{
+  hidglGC hidgl_gc = (hidglGC)gc;
+
+  CHECK_IS_IN_CONTEXT ();
+
+  glBegin (GL_LINE_LOOP);
+  glVertex3f (x1, y1, hidgl_gc->depth);
+  glVertex3f (x1, y2, hidgl_gc->depth);
+  glVertex3f (x2, y2, hidgl_gc->depth);
+  glVertex3f (x2, y1, hidgl_gc->depth);
+  glEnd ();
+}
+
+
+void
+hidgl_fill_circle (hidGC gc, Coord x, Coord y, Coord radius)
+{
+  CHECK_CAN_RECORD (((hidglGC)gc)->hidgl);
+
+  hidgl_ensure_vertex_space (gc, 6);
+
+  /* NB: Repeated first virtex to separate from other tri-strip */
+  hidgl_add_vertex_tex (gc, x - radius, y - radius, -1.0, -1.0);
+  hidgl_add_vertex_tex (gc, x - radius, y - radius, -1.0, -1.0);
+  hidgl_add_vertex_tex (gc, x - radius, y + radius, -1.0,  1.0);
+  hidgl_add_vertex_tex (gc, x + radius, y - radius,  1.0, -1.0);
+  hidgl_add_vertex_tex (gc, x + radius, y + radius,  1.0,  1.0);
+  hidgl_add_vertex_tex (gc, x + radius, y + radius,  1.0,  1.0);
+  /* NB: Repeated last virtex to separate from other tri-strip */
+}
+
+/* Queues a filled circle, optionally with a hole through its middle, to be
+ * drawn along with all the others in a single instanced call from
+ * hidgl_flush_instances(). The circle takes the current colour.
+ *
+ * NB: Queued circles are drawn after any triangles queued before the next
+ *     flush. Callers needing a particular stacking order should flush.
+ */
+void
+hidgl_queue_circle (hidGC gc, Coord x, Coord y, Coord radius, Coord hole_radius)
+{
+  hidglGC hidgl_gc = (hidglGC)gc;
+  hidgl_instance *hidgl = hidgl_gc->hidgl;
+  hidgl_priv *priv = hidgl->priv;
+  GLfloat *instance;
+
+  CHECK_CAN_RECORD (hidgl);
+
+  /* Recorded geometry is replayed without any instanced draws */
+  if (!have_instancing || priv->recording != NULL || radius <= 0)
+    {
+      hidgl_fill_circle (gc, x, y, radius);
+      return;
+    }
+
+  instance = batch_add_instance (&priv->circles, CIRCLE_INSTANCE_SIZE);
+  instance[0] = x;
+  instance[1] = y;
+  instance[2] = hidgl_gc->depth;
+  instance[3] = radius;
+  instance[4] = (float)hole_radius * hole_radius / ((float)radius * radius);
+  memcpy (&instance[5], priv->color, sizeof (priv->color));
+}
+
+static void
+flush_circles (hidgl_priv *priv)
+{
+  instance_batch *circles = &priv->circles;
+  GLsizei stride = sizeof (GLfloat) * CIRCLE_INSTANCE_SIZE;
+  GLint program;
+
+  if (circles->instance_count == 0)
+    return;
+
+  glGetIntegerv (GL_CURRENT_PROGRAM, &program);
+  hidgl_shader_activate (circular_instanced_program);
+
+  /* Per-vertex corners of the quad, shared by every instance */
+  glBindBuffer (GL_ARRAY_BUFFER, priv->quad_vbo_id);
+  glVertexAttribPointer (0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+  glEnableVertexAttribArray (0);
+
+  glBindBuffer (GL_ARRAY_BUFFER, circles->instance_vbo_id);
+  glBufferData (GL_ARRAY_BUFFER, stride * circles->instance_count,
+                circles->instance_data, GL_STREAM_DRAW);
+
+  glVertexAttribPointer (circle_attr, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid *)0);
+  glVertexAttribPointer (hole_attr,   1, GL_FLOAT, GL_FALSE, stride, (GLvoid *)(4 * sizeof (GLfloat)));
+  glVertexAttribPointer (color_attr,  4, GL_FLOAT, GL_FALSE, stride, (GLvoid *)(5 * sizeof (GLfloat)));
+  glEnableVertexAttribArray (circle_attr);
+  glEnableVertexAttribArray (hole_attr);
+  glEnableVertexAttribArray (color_attr);
+  glVertexAttribDivisor (circle_attr, 1);
+  glVertexAttribDivisor (hole_attr, 1);
+  glVertexAttribDivisor (color_attr, 1);
+
+  glDrawArraysInstanced (GL_TRIANGLE_STRIP, 0, 4, circles->instance_count);
+  count_instances (priv, circles->instance_count, 4);
+
+  glVertexAttribDivisor (circle_attr, 0);
+  glVertexAttribDivisor (hole_attr, 0);
+  glVertexAttribDivisor (color_attr, 0);
+  glDisableVertexAttribArray (color_attr);
+  glDisableVertexAttribArray (hole_attr);
+  glDisableVertexAttribArray (circle_attr);
+  glDisableVertexAttribArray (0);
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+  glUseProgram (program);
+
+  circles->instance_count = 0;
+}
+
+static void
+flush_arcs (hidgl_priv *priv)
+{
+  instance_batch *arcs = &priv->arcs;
+
+  if (arcs->instance_count == 0)
+    return;
+
+  glBindBuffer (GL_ARRAY_BUFFER, arcs->instance_vbo_id);
+  glBufferData (GL_ARRAY_BUFFER,
+                sizeof (GLfloat) * ARC_INSTANCE_SIZE * arcs->instance_count,
+                arcs->instance_data, GL_STREAM_DRAW);
+
+  draw_arc_instances (priv, arcs->instance_vbo_id, 0, arcs->instance_count);
+
+  arcs->instance_count = 0;
+}
+
+#define PIXELS_PER_CIRCLINE 5.
+#define MAX_FACES_PER_CYL 360
+
+/* Adds the sides of a cylinder to the triangle buffer as a tri-strip */
+static void
+draw_cylinder_strip (hidGC gc, Coord vx, Coord vy, Coord vr, float z1, float z2, int slices)
+{
+  float radius = vr;
+  float x, y;
+  int i;
+
+  x = vx + vr;
+  y = vy;
+
+  hidgl_ensure_vertex_space (gc, CYLINDER_VERTICES (slices) + 2);
+
+  /* NB: Repeated first virtex to separate from other tri-strip */
+  hidgl_add_vertex_3D_tex (gc, x, y, z1, 0.0, 0.0);
+  hidgl_add_vertex_3D_tex (gc, x, y, z1, 0.0, 0.0);
+  hidgl_add_vertex_3D_tex (gc, x, y, z2, 0.0, 0.0);
+
+  for (i = 0; i < slices; i++)
+    {
+      x = radius * cosf (((float)(i + 1)) * 2. * M_PI / (float)slices) + vx;
+      y = radius * sinf (((float)(i + 1)) * 2. * M_PI / (float)slices) + vy;
+
+      hidgl_add_vertex_3D_tex (gc, x, y, z1, 0.0, 0.0);
+      hidgl_add_vertex_3D_tex (gc, x, y, z2, 0.0, 0.0);
+    }
+
+  /* NB: Repeated last virtex to separate from other tri-strip */
+  hidgl_add_vertex_3D_tex (gc, x, y, z2, 0.0, 0.0);
+}
+
+/* Queues the sides of a cylinder between depths z1 and z2, such as a drill
+ * channel in the 3D view, to be drawn from a shared unit cylinder mesh in
+ * a single instanced call from hidgl_flush_instances(). The number of
+ * sides depends on the cylinder's size on screen, rounded up to the
+ * nearest of the prebuilt meshes. The cylinder takes the current colour.
+ */
+void
+hidgl_queue_cylinder (hidGC gc, Coord vx, Coord vy, Coord vr, float z1, float z2, double scale)
+{
+  hidglGC hidgl_gc = (hidglGC)gc;
+  hidgl_instance *hidgl = hidgl_gc->hidgl;
+  hidgl_priv *priv = hidgl->priv;
+  GLfloat *instance;
+  int slices;
+  int mesh;
+
+  CHECK_IS_IN_CONTEXT ();
+
+  slices = M_PI * 2 * vr / scale / PIXELS_PER_CIRCLINE;
+  slices = MAX (slices, MIN_CYLINDER_SLICES);
+
+  if (!have_instancing || priv->recording != NULL)
+    {
+      draw_cylinder_strip (gc, vx, vy, vr, z1, z2, MIN (slices, MAX_FACES_PER_CYL));
+      return;
+    }
+
+  for (mesh = 0; mesh < CYLINDER_MESHES - 1; mesh++)
+    if ((MIN_CYLINDER_SLICES << mesh) >= slices)
+      break;
+
+  instance = batch_add_instance (&priv->cylinders[mesh], CYLINDER_INSTANCE_SIZE);
+  instance[0] = vx;
+  instance[1] = vy;
+  instance[2] = vr;
+  instance[3] = z1;
+  instance[4] = z2;
+  memcpy (&instance[5], priv->color, sizeof (priv->color));
+}
+
+static void
+flush_cylinders (hidgl_priv *priv)
+{
+  GLsizei stride = sizeof (GLfloat) * CYLINDER_INSTANCE_SIZE;
+  GLint program;
+  int i;
 
-  inner_r = rx - width / 2.;
-  outer_r = rx + width / 2.;
+  glGetIntegerv (GL_CURRENT_PROGRAM, &program);
+  hidgl_shader_activate (cylinder_instanced_program);
 
-  if (delta_angle < 0) {
-    start_angle += delta_angle;
-    delta_angle = - delta_angle;
-  }
+  glEnableVertexAttribArray (0);
+  glEnableVertexAttribArray (cylinder_attr);
+  glEnableVertexAttribArray (cylinder_span_attr);
+  glEnableVertexAttribArray (cylinder_color_attr);
+  glVertexAttribDivisor (cylinder_attr, 1);
+  glVertexAttribDivisor (cylinder_span_attr, 1);
+  glVertexAttribDivisor (cylinder_color_attr, 1);
 
-  start_angle_rad = start_angle * M_PI / 180.;
-  delta_angle_rad = delta_angle * M_PI / 180.;
+  for (i = 0; i < CYLINDER_MESHES; i++)
+    {
+      instance_batch *cylinders = &priv->cylinders[i];
+      int vertices = CYLINDER_VERTICES (MIN_CYLINDER_SLICES << i);
 
-  slices = calc_slices ((rx + width / 2.) / scale, delta_angle_rad);
+      if (cylinders->instance_count == 0)
+        continue;
 
-  if (slices < MIN_SLICES_PER_ARC)
-    slices = MIN_SLICES_PER_ARC;
+      /* Per-vertex unit cylinder, shared by every instance */
+      glBindBuffer (GL_ARRAY_BUFFER, priv->cylinder_vbo_ids[i]);
+      glVertexAttribPointer (0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
 
-  if (slices > MAX_SLICES_PER_ARC)
-    slices = MAX_SLICES_PER_ARC;
+      glBindBuffer (GL_ARRAY_BUFFER, cylinders->instance_vbo_id);
+      glBufferData (GL_ARRAY_BUFFER, stride * cylinders->instance_count,
+                    cylinders->instance_data, GL_STREAM_DRAW);
 
-  hidgl_ensure_triangle_space (gc, 2 * slices);
+      glVertexAttribPointer (cylinder_attr,       3, GL_FLOAT, GL_FALSE, stride, (GLvoid *)0);
+      glVertexAttribPointer (cylinder_span_attr,  2, GL_FLOAT, GL_FALSE, stride, (GLvoid *)(3 * sizeof (GLfloat)));
+      glVertexAttribPointer (cylinder_color_attr, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid *)(5 * sizeof (GLfloat)));
 
-  angle_incr_rad = delta_angle_rad / (float)slices;
+      glDrawArraysInstanced (GL_TRIANGLE_STRIP, 0, vertices, cylinders->instance_count);
+      count_instances (priv, cylinders->instance_count, vertices);
 
-  cos_ang = cosf (start_angle_rad);
-  sin_ang = sinf (start_angle_rad);
-  last_inner_x = -inner_r * cos_ang + x;  last_inner_y = inner_r * sin_ang + y;
-  last_outer_x = -outer_r * cos_ang + x;  last_outer_y = outer_r * sin_ang + y;
-  for (i = 1; i <= slices; i++) {
-    cos_ang = cosf (start_angle_rad + ((float)(i)) * angle_incr_rad);
-    sin_ang = sinf (start_angle_rad + ((float)(i)) * angle_incr_rad);
-    inner_x = -inner_r * cos_ang + x;  inner_y = inner_r * sin_ang + y;
-    outer_x = -outer_r * cos_ang + x;  outer_y = outer_r * sin_ang + y;
-    hidgl_add_triangle (gc, last_inner_x, last_inner_y,
-                            last_outer_x, last_outer_y,
-                            outer_x, outer_y);
-    hidgl_add_triangle (gc, last_inner_x, last_inner_y,
-                            inner_x, inner_y,
-                            outer_x, outer_y);
-    last_inner_x = inner_x;  last_inner_y = inner_y;
-    last_outer_x = outer_x;  last_outer_y = outer_y;
-  }
+      cylinders->instance_count = 0;
+    }
 
-  /* Don't bother capping hairlines */
-  if (hairline)
-    return;
+  glVertexAttribDivisor (cylinder_attr, 0);
+  glVertexAttribDivisor (cylinder_span_attr, 0);
+  glVertexAttribDivisor (cylinder_color_attr, 0);
+  glDisableVertexAttribArray (cylinder_color_attr);
+  glDisableVertexAttribArray (cylinder_span_attr);
+  glDisableVertexAttribArray (cylinder_attr);
+  glDisableVertexAttribArray (0);
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
 
-  draw_cap (gc, width, x + rx * -cosf (start_angle_rad),
-                       y + rx *  sinf (start_angle_rad),
-                       start_angle);
-  draw_cap (gc, width, x + rx * -cosf (start_angle_rad + delta_angle_rad),
-                       y + rx *  sinf (start_angle_rad + delta_angle_rad),
-                       start_angle + delta_angle + 180.);
+  glUseProgram (program);
 }
 
+/* Draws any queued circles, arcs and cylinders */
 void
-hidgl_draw_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
+hidgl_flush_instances (hidgl_instance *hidgl)
 {
-  hidglGC hidgl_gc = (hidglGC)gc;
-
-  CHECK_IS_IN_CONTEXT ();
+  hidgl_priv *priv = hidgl->priv;
+  bool have_cylinders = false;
+  int i;
 
-  glBegin (GL_LINE_LOOP);
-  glVertex3f (x1, y1, hidgl_gc->depth);
-  glVertex3f (x1, y2, hidgl_gc->depth);
-  glVertex3f (x2, y2, hidgl_gc->depth);
-  glVertex3f (x2, y1, hidgl_gc->depth);
-  glEnd ();
-}
+  CHECK_CAN_RECORD (hidgl);
 
+  for (i = 0; i < CYLINDER_MESHES; i++)
+    if (priv->cylinders[i].instance_count > 0)
+      have_cylinders = true;
 
-void
-hidgl_fill_circle (hidGC gc, Coord x, Coord y, Coord radius)
-{
-  CHECK_IS_IN_CONTEXT ();
+  if (priv->circles.instance_count == 0 &&
+      priv->arcs.instance_count == 0 &&
+      !have_cylinders)
+    return;
 
-  hidgl_ensure_vertex_space (gc, 6);
+  /* Keep the ordering with respect to anything queued before us */
+  hidgl_flush_triangles (hidgl);
 
-  /* NB: Repeated first virtex to separate from other tri-strip */
-  hidgl_add_vertex_tex (gc, x - radius, y - radius, -1.0, -1.0);
-  hidgl_add_vertex_tex (gc, x - radius, y - radius, -1.0, -1.0);
-  hidgl_add_vertex_tex (gc, x - radius, y + radius, -1.0,  1.0);
-  hidgl_add_vertex_tex (gc, x + radius, y - radius,  1.0, -1.0);
-  hidgl_add_vertex_tex (gc, x + radius, y + radius,  1.0,  1.0);
-  hidgl_add_vertex_tex (gc, x + radius, y + radius,  1.0,  1.0);
-  /* NB: Repeated last virtex to separate from other tri-strip */
+  if (have_cylinders)
+    flush_cylinders (priv);
+  flush_arcs (priv);
+  flush_circles (priv);
 }
 
 #define MAX_COMBINED_MALLOCS 2500
@@ -756,274 +1830,265 @@ hidgl_fill_polygon (hidGC gc, int n_coords, Coord *x, Coord *y)
 }
 
 static inline void
-stash_vertex (PLINE *contour, int *vertex_comp,
+stash_vertex (float *vertices, int *vertex_comp,
               float x, float y, float z, float r, float s)
 {
-  contour->tristrip_vertices[(*vertex_comp)++] = x;
-  contour->tristrip_vertices[(*vertex_comp)++] = y;
+  vertices[(*vertex_comp)++] = x;
+  vertices[(*vertex_comp)++] = y;
 #if MEMCPY_VERTEX_DATA
-  contour->tristrip_vertices[(*vertex_comp)++] = z;
-  contour->tristrip_vertices[(*vertex_comp)++] = r;
-  contour->tristrip_vertices[(*vertex_comp)++] = s;
+  vertices[(*vertex_comp)++] = z;
+  vertices[(*vertex_comp)++] = r;
+  vertices[(*vertex_comp)++] = s;
 #endif
-  contour->tristrip_num_vertices ++;
 }
 
-static void
-fill_contour (hidGC gc, PLINE *contour)
+/* Converts trapezoids from the borast tesselator into a cached set of
+ * tri-strips, returning the number of vertices stashed in *vertices.
+ */
+static int
+traps_to_tristrip (hidGC gc, borast_traps_t *traps, float **vertices)
 {
   hidglGC hidgl_gc = (hidglGC)gc;
-#if MEMCPY_VERTEX_DATA
-  hidgl_instance *hidgl = hidgl_gc->hidgl;
-  hidgl_priv *priv = hidgl->priv;
-#endif
   int i;
   int vertex_comp;
-  borast_traps_t traps;
+  int tristrip_space;
+  int x1, x2, x3, x4, y_top, y_bot;
 
-  /* If the contour is round, then call hidgl_fill_circle to draw it. */
-  if (contour->is_round) {
-    hidgl_fill_circle (gc, contour->cx, contour->cy, contour->radius);
-    return;
-  }
+  *vertices = NULL;
+  tristrip_space = 0;
 
-  /* If we don't have a cached set of tri-strips, compute them */
-  if (contour->tristrip_vertices == NULL) {
-    int tristrip_space;
-    int x1, x2, x3, x4, y_top, y_bot;
+  for (i = 0; i < traps->num_traps; i++) {
+    y_top = traps->traps[i].top;
+    y_bot = traps->traps[i].bottom;
 
-    _borast_traps_init (&traps);
-    bo_contour_to_traps_no_draw (contour, &traps);
+    x1 = _line_compute_intersection_x_for_y (&traps->traps[i].left,  y_top);
+    x2 = _line_compute_intersection_x_for_y (&traps->traps[i].right, y_top);
+    x3 = _line_compute_intersection_x_for_y (&traps->traps[i].right, y_bot);
+    x4 = _line_compute_intersection_x_for_y (&traps->traps[i].left,  y_bot);
 
-    tristrip_space = 0;
+    if ((x1 == x2) || (x3 == x4)) {
+      tristrip_space += 5; /* Three vertices + repeated start and end */
+    } else {
+      tristrip_space += 6; /* Four vertices + repeated start and end */
+    }
+  }
 
-    for (i = 0; i < traps.num_traps; i++) {
-      y_top = traps.traps[i].top;
-      y_bot = traps.traps[i].bottom;
+  if (tristrip_space == 0)
+    return 0;
 
-      x1 = _line_compute_intersection_x_for_y (&traps.traps[i].left,  y_top);
-      x2 = _line_compute_intersection_x_for_y (&traps.traps[i].right, y_top);
-      x3 = _line_compute_intersection_x_for_y (&traps.traps[i].right, y_bot);
-      x4 = _line_compute_intersection_x_for_y (&traps.traps[i].left,  y_bot);
+#if MEMCPY_VERTEX_DATA
+  /* NB: MEMCPY of vertex data causes a problem with depth being cached at the wrong level! */
+  *vertices = malloc (sizeof (float) * 5 * tristrip_space);
+#else
+  *vertices = malloc (sizeof (float) * 2 * tristrip_space);
+#endif
 
-      if ((x1 == x2) || (x3 == x4)) {
-        tristrip_space += 5; /* Three vertices + repeated start and end */
-      } else {
-        tristrip_space += 6; /* Four vertices + repeated start and end */
-      }
-    }
+  vertex_comp = 0;
+  for (i = 0; i < traps->num_traps; i++) {
+    y_top = traps->traps[i].top;
+    y_bot = traps->traps[i].bottom;
 
-    if (tristrip_space == 0) {
-      printf ("Strange, contour didn't tesselate\n");
-      return;
+    x1 = _line_compute_intersection_x_for_y (&traps->traps[i].left,  y_top);
+    x2 = _line_compute_intersection_x_for_y (&traps->traps[i].right, y_top);
+    x3 = _line_compute_intersection_x_for_y (&traps->traps[i].right, y_bot);
+    x4 = _line_compute_intersection_x_for_y (&traps->traps[i].left,  y_bot);
+
+    if (x1 == x2) {
+      /* NB: Repeated first virtex to separate from other tri-strip */
+      stash_vertex (*vertices, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x3, y_bot, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x4, y_bot, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x4, y_bot, hidgl_gc->depth, 0.0, 0.0);
+      /* NB: Repeated last virtex to separate from other tri-strip */
+    } else if (x3 == x4) {
+      /* NB: Repeated first virtex to separate from other tri-strip */
+      stash_vertex (*vertices, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x2, y_top, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x3, y_bot, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x3, y_bot, hidgl_gc->depth, 0.0, 0.0);
+      /* NB: Repeated last virtex to separate from other tri-strip */
+    } else {
+      /* NB: Repeated first virtex to separate from other tri-strip */
+      stash_vertex (*vertices, &vertex_comp, x2, y_top, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x2, y_top, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x3, y_bot, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x4, y_bot, hidgl_gc->depth, 0.0, 0.0);
+      stash_vertex (*vertices, &vertex_comp, x4, y_bot, hidgl_gc->depth, 0.0, 0.0);
+      /* NB: Repeated last virtex to separate from other tri-strip */
     }
+  }
 
+  return tristrip_space;
+}
+
+static void
+draw_tristrip (hidGC gc, float *vertices, int num_vertices)
+{
 #if MEMCPY_VERTEX_DATA
-    /* NB: MEMCPY of vertex data causes a problem with depth being cached at the wrong level! */
-    contour->tristrip_vertices = malloc (sizeof (float) * 5 * tristrip_space);
+  hidglGC hidgl_gc = (hidglGC)gc;
+  hidgl_instance *hidgl = hidgl_gc->hidgl;
+  hidgl_priv *priv = hidgl->priv;
 #else
-    contour->tristrip_vertices = malloc (sizeof (float) * 2 * tristrip_space);
+  int i;
+  int vertex_comp;
 #endif
-    contour->tristrip_num_vertices = 0;
-
-    vertex_comp = 0;
-    for (i = 0; i < traps.num_traps; i++) {
-      y_top = traps.traps[i].top;
-      y_bot = traps.traps[i].bottom;
-
-      x1 = _line_compute_intersection_x_for_y (&traps.traps[i].left,  y_top);
-      x2 = _line_compute_intersection_x_for_y (&traps.traps[i].right, y_top);
-      x3 = _line_compute_intersection_x_for_y (&traps.traps[i].right, y_bot);
-      x4 = _line_compute_intersection_x_for_y (&traps.traps[i].left,  y_bot);
-
-      if (x1 == x2) {
-        /* NB: Repeated first virtex to separate from other tri-strip */
-        stash_vertex (contour, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x3, y_bot, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x4, y_bot, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x4, y_bot, hidgl_gc->depth, 0.0, 0.0);
-        /* NB: Repeated last virtex to separate from other tri-strip */
-      } else if (x3 == x4) {
-        /* NB: Repeated first virtex to separate from other tri-strip */
-        stash_vertex (contour, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x2, y_top, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x3, y_bot, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x3, y_bot, hidgl_gc->depth, 0.0, 0.0);
-        /* NB: Repeated last virtex to separate from other tri-strip */
-      } else {
-        /* NB: Repeated first virtex to separate from other tri-strip */
-        stash_vertex (contour, &vertex_comp, x2, y_top, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x2, y_top, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x3, y_bot, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x1, y_top, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x4, y_bot, hidgl_gc->depth, 0.0, 0.0);
-        stash_vertex (contour, &vertex_comp, x4, y_bot, hidgl_gc->depth, 0.0, 0.0);
-        /* NB: Repeated last virtex to separate from other tri-strip */
-      }
-    }
-
-    _borast_traps_fini (&traps);
-  }
 
-  if (contour->tristrip_num_vertices == 0)
+  if (num_vertices == 0)
     return;
 
-  hidgl_ensure_vertex_space (gc, contour->tristrip_num_vertices);
+  hidgl_ensure_vertex_space (gc, num_vertices);
 
 #if MEMCPY_VERTEX_DATA
   memcpy (&priv->buffer.triangle_array[priv->buffer.coord_comp_count],
-          contour->tristrip_vertices,
-          sizeof (float) * 5 * contour->tristrip_num_vertices);
-  priv->buffer.coord_comp_count += 5 * contour->tristrip_num_vertices;
-  priv->buffer.vertex_count += contour->tristrip_num_vertices;
+          vertices,
+          sizeof (float) * 5 * num_vertices);
+  priv->buffer.coord_comp_count += 5 * num_vertices;
+  priv->buffer.vertex_count += num_vertices;
 
 #else
   vertex_comp = 0;
-  for (i = 0; i < contour->tristrip_num_vertices; i++) {
+  for (i = 0; i < num_vertices; i++) {
     int x, y;
-    x = contour->tristrip_vertices[vertex_comp++];
-    y = contour->tristrip_vertices[vertex_comp++];
+    x = vertices[vertex_comp++];
+    y = vertices[vertex_comp++];
     hidgl_add_vertex_tex (gc, x, y, 0.0, 0.0);
   }
 #endif
-
 }
 
-static int
-do_hole (const BoxType *b, void *cl)
+static void
+fill_contour (hidGC gc, PLINE *contour)
 {
-  PLINE *curc = (PLINE *) b;
-  hidGC gc = (hidGC)cl;
+  hidgl_priv *priv = ((hidglGC)gc)->hidgl->priv;
+  borast_traps_t traps;
 
-  /* Ignore the outer contour - we draw it first explicitly*/
-  if (curc->Flags.orient == PLF_DIR) {
-    return 0;
+  /* If the contour is round, then call hidgl_fill_circle to draw it. */
+  if (contour->is_round) {
+    hidgl_fill_circle (gc, contour->cx, contour->cy, contour->radius);
+    return;
+  }
+
+  /* If we don't have a cached set of tri-strips, compute them */
+  if (contour->tristrip_vertices != NULL) {
+    priv->stats.tess_cache_hits++;
+  } else {
+    priv->stats.tess_cache_misses++;
+    _borast_traps_init (&traps);
+    bo_contour_to_traps_no_draw (contour, &traps);
+    contour->tristrip_num_vertices =
+      traps_to_tristrip (gc, &traps, &contour->tristrip_vertices);
+    _borast_traps_fini (&traps);
+
+    if (contour->tristrip_num_vertices == 0) {
+      printf ("Strange, contour didn't tesselate\n");
+      return;
+    }
   }
 
-  fill_contour (gc, curc);
-  return 1;
+  draw_tristrip (gc, contour->tristrip_vertices, contour->tristrip_num_vertices);
 }
 
-static bool
-polygon_contains_user_holes (PolygonType *polygon)
+/* The contours of a POLYAREA are edited in place by the polygon clipping
+ * code, so rather than trying to catch every edit, the cached tri-strips
+ * are tagged with a key hashed from the vertices they were built from.
+ * Walking the vertices is linear, which is still far cheaper than
+ * tesselating them again, and unlike the contours' counts and bounding
+ * boxes it can't miss a re-clip that moves only inner vertices.
+ */
+static unsigned long
+polyarea_tristrip_key (POLYAREA *pa)
 {
-  return (polygon->HoleIndexN > 0);
+  unsigned long key = 5381;
+  PLINE *contour;
+  VNODE *v;
+
+  for (contour = pa->contours; contour != NULL; contour = contour->next)
+    {
+      key = key * 33 ^ contour->Count;
+      v = &contour->head;
+      do
+        {
+          key = key * 33 ^ (unsigned long)v->point[0];
+          key = key * 33 ^ (unsigned long)v->point[1];
+        }
+      while ((v = v->next) != &contour->head);
+    }
+
+  return key;
 }
 
 static void
-fill_polyarea (hidGC gc, POLYAREA *pa, const BoxType *clip_box, bool use_new_stencil)
+fill_polyarea (hidGC gc, POLYAREA *pa)
 {
-  hidglGC hidgl_gc = (hidglGC)gc;
-  hidgl_instance *hidgl = hidgl_gc->hidgl;
-  hidgl_priv *priv = hidgl->priv;
-  int stencil_bit;
+  hidgl_priv *priv = ((hidglGC)gc)->hidgl->priv;
+  unsigned long key;
+  borast_traps_t traps;
 
   CHECK_IS_IN_CONTEXT ();
 
-  /* Special case non-holed polygons which don't require a stencil bit */
+  /* Special case non-holed polygons, which can use the per-contour cache */
   if (pa->contour_tree->size == 1) {
     fill_contour (gc, pa->contours);
     return;
   }
 
-  /* Polygon has holes.. does it have any user-drawn holes? (caller tells us)
-   * If so, it must be masked with a _new_ stencil bit.
+  /* Polygon has holes. These are tesselated along with the outer contour,
+   * giving triangles which cover just the filled area of the polygon, so we
+   * don't need to mask the holes out in the stencil buffer.
    */
-  if (use_new_stencil)
-    {
-      stencil_bit = hidgl_assign_clear_stencil_bit (hidgl);
-      if (!stencil_bit)
-        {
-          printf ("hidgl_fill_pcb_polygon: No free stencil bits, aborting polygon\n");
-          /* XXX: Could use the GLU tesselator or the full BO polygon tesselator */
-          return;
-        }
-    }
-
-  /* Flush out any existing geoemtry to be rendered */
-  hidgl_flush_triangles (hidgl);
-
-  glPushAttrib (GL_STENCIL_BUFFER_BIT |                 /* Resave the stencil write-mask etc.., and */
-                GL_COLOR_BUFFER_BIT |                   /* the colour buffer write mask etc.. for part way restore */
-                GL_DEPTH_BUFFER_BIT);
-  glEnable (GL_STENCIL_TEST);                           /* Enable the stencil test, just in case it wasn't already on */
-//=======
-//<<<<<<< current
-//                GL_COLOR_BUFFER_BIT);                   /* the colour buffer write mask etc.. for part way restore */
-//  glEnable (GL_STENCIL_TEST);                           /* Enable the stencil test, just in case it wasn't already on */
-//=======
-//                GL_COLOR_BUFFER_BIT |                   /* the colour buffer write mask etc.. for part way restore */
-//                GL_DEPTH_BUFFER_BIT);
-//>>>>>>> patched
-  glColorMask (0, 0, 0, 0);                             /* Disable writting in color buffer */
-  glDepthFunc (GL_ALWAYS);
-  glDepthMask (GL_FALSE);
-
-  if (use_new_stencil)
-    {
-      glStencilMask (stencil_bit);                            /* Only write to our stencil bit */
-      glStencilFunc (GL_ALWAYS, stencil_bit, stencil_bit);    /* Always pass stencil test, ref value is our bit */
-      glStencilOp (GL_KEEP, GL_KEEP, GL_REPLACE);             /* Stencil pass => replace stencil value */
-    }
-
-  /* Drawing operations now set our reference bit in the stencil buffer */
-
-  r_search (pa->contour_tree, clip_box, NULL, do_hole, gc);
-  hidgl_flush_triangles (hidgl);
-
-  glPopAttrib ();                               /* Restore the colour and stencil buffer write-mask etc.. */
-  glPushAttrib (GL_STENCIL_BUFFER_BIT);         /* Save the stencil op and function */
-  glEnable (GL_STENCIL_TEST);                   /* Enable the stencil test, just in case it wasn't already on */
-
-  glStencilOp (GL_KEEP, GL_KEEP, GL_INVERT);    /* This allows us to toggle the bit on the subcompositing bitplane */
-                                                /* If the stencil test has passed, we know that bit is 0, so we're */
-                                                /* effectively just setting it to 1. */
+  key = polyarea_tristrip_key (pa);
 
-  glStencilFunc (GL_GEQUAL, 0, priv->assigned_bits);  /* Pass stencil test if all assigned bits clear, */
-                                                /* reference is all assigned bits so we set */
-                                                /* any bits permitted by the stencil writemask */
-
-  /* Drawing operations as masked to areas where the stencil buffer is '0' */
+  if (pa->tristrip_vertices != NULL && pa->tristrip_key != key) {
+    free (pa->tristrip_vertices);
+    pa->tristrip_vertices = NULL;
+    pa->tristrip_num_vertices = 0;
+  }
 
-  /* Draw the polygon outer */
-  fill_contour (gc, pa->contours);
-  hidgl_flush_triangles (hidgl);
+  /* If we don't have a cached set of tri-strips, compute them */
+  if (pa->tristrip_vertices != NULL) {
+    priv->stats.tess_cache_hits++;
+  } else {
+    priv->stats.tess_cache_misses++;
+    _borast_traps_init (&traps);
+    bo_poly_to_traps_no_draw (pa, &traps);
+    pa->tristrip_num_vertices =
+      traps_to_tristrip (gc, &traps, &pa->tristrip_vertices);
+    pa->tristrip_key = key;
+    _borast_traps_fini (&traps);
 
-  /* Unassign our stencil buffer bit */
-  if (use_new_stencil)
-    hidgl_return_stencil_bit (hidgl, stencil_bit);
+    if (pa->tristrip_num_vertices == 0) {
+      printf ("Strange, polygon didn't tesselate\n");
+      return;
+    }
+  }
 
-  glPopAttrib ();                               /* Restore the stencil buffer op and function */
+  draw_tristrip (gc, pa->tristrip_vertices, pa->tristrip_num_vertices);
 }
 
 void
 hidgl_fill_pcb_polygon (hidGC gc, PolygonType *poly, const BoxType *clip_box)
 {
-  bool use_new_stencil;
-
   if (poly->Clipped == NULL)
     return;
 
-  use_new_stencil = polygon_contains_user_holes (poly) ||
-                    TEST_FLAG (FULLPOLYFLAG, poly);
-
-  fill_polyarea (gc, poly->Clipped, clip_box, use_new_stencil);
+  fill_polyarea (gc, poly->Clipped);
 
   if (TEST_FLAG (FULLPOLYFLAG, poly))
     {
       POLYAREA *pa;
 
       for (pa = poly->Clipped->f; pa != poly->Clipped; pa = pa->f)
-        fill_polyarea (gc, pa, clip_box, use_new_stencil);
+        fill_polyarea (gc, pa);
     }
 }
 
 void
 hidgl_fill_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
 {
-  CHECK_IS_IN_CONTEXT ();
+  CHECK_CAN_RECORD (((hidglGC)gc)->hidgl);
 
   hidgl_ensure_vertex_space (gc, 6);
 
@@ -1045,10 +2110,92 @@ load_built_in_shaders (void)
           "{\n"
           "  float sqdist;\n"
           "  sqdist = dot (gl_TexCoord[0].st, gl_TexCoord[0].st);\n"
-          "  if (sqdist > 1.0)\n"
+          "  if (sqdist > 1.0 || sqdist < gl_TexCoord[0].p)\n"
+          "    discard;\n"
+          "  gl_FragColor = gl_Color;\n"
+          "}\n";
+
+  /* Draws one quad per circle instance, passing the squared hole radius
+   * to the fragment shader in the third texture coordinate.
+   */
+  char *circular_instanced_vs_source =
+          "attribute vec2 corner;\n"
+          "attribute vec4 circle;\n"
+          "attribute float hole;\n"
+          "attribute vec4 color;\n"
+          "\n"
+          "void main()\n"
+          "{\n"
+          "  vec4 position = vec4 (circle.xy + corner * circle.w, circle.z, 1.0);\n"
+          "  gl_Position = gl_ModelViewProjectionMatrix * position;\n"
+          "  gl_TexCoord[0] = vec4 (corner, hole, 1.0);\n"
+          "  gl_FrontColor = color;\n"
+          "}\n";
+  /* Draws one quad per arc instance, covering the arc's bounding box. The
+   * fragment shader works in coordinates relative to the arc's centre,
+   * keeping the annulus sector between the start and end angles, plus a
+   * round cap at each end.
+   */
+  char *arc_instanced_vs_source =
+          "attribute vec2 corner;\n"
+          "attribute vec4 bounds;\n"
+          "attribute vec4 arc;\n"
+          "attribute vec4 sweep;\n"
+          "attribute vec4 color;\n"
+          "\n"
+          "void main()\n"
+          "{\n"
+          "  vec2 position = mix (bounds.xy, bounds.zw, corner * 0.5 + 0.5);\n"
+          "  gl_Position = gl_ModelViewProjectionMatrix * vec4 (position, arc.z, 1.0);\n"
+          "  gl_TexCoord[0] = vec4 (position - arc.xy, arc.w, sweep.x);\n"
+          "  gl_TexCoord[1] = vec4 (sweep.yzw, 0.0);\n"
+          "  gl_FrontColor = color;\n"
+          "}\n";
+
+  char *arc_instanced_fs_source =
+          "void main()\n"
+          "{\n"
+          "  vec2 p = gl_TexCoord[0].xy;\n"
+          "  float radius = gl_TexCoord[0].z;\n"
+          "  float half_width = gl_TexCoord[0].w;\n"
+          "  float start = gl_TexCoord[1].x;\n"
+          "  float delta = gl_TexCoord[1].y;\n"
+          "  float cap_radius = gl_TexCoord[1].z;\n"
+          "  float angle = mod (atan (p.y, -p.x) - start, 6.2831853);\n"
+          "  vec2 start_cap = radius * vec2 (-cos (start), sin (start));\n"
+          "  vec2 end_cap = radius * vec2 (-cos (start + delta), sin (start + delta));\n"
+          "\n"
+          "  if ((angle > delta || abs (length (p) - radius) > half_width) &&\n"
+          "      distance (p, start_cap) > cap_radius &&\n"
+          "      distance (p, end_cap) > cap_radius)\n"
           "    discard;\n"
           "  gl_FragColor = gl_Color;\n"
           "}\n";
+  /* Draws one unit cylinder mesh per instance, scaled to the cylinder's
+   * radius, with its ends at the two depths given.
+   */
+  char *cylinder_instanced_vs_source =
+          "attribute vec3 unit;\n"
+          "attribute vec3 cylinder;\n"
+          "attribute vec2 span;\n"
+          "attribute vec4 color;\n"
+          "\n"
+          "void main()\n"
+          "{\n"
+          "  vec4 position = vec4 (cylinder.xy + unit.xy * cylinder.z,\n"
+          "                        mix (span.x, span.y, unit.z), 1.0);\n"
+          "  gl_Position = gl_ModelViewProjectionMatrix * position;\n"
+          "  gl_FrontColor = color;\n"
+          "}\n";
+
+  char *cylinder_instanced_fs_source =
+          "void main()\n"
+          "{\n"
+          "  gl_FragColor = gl_Color;\n"
+          "}\n";
+  const char *version;
+  int major = 0, minor = 0;
+  GLuint program;
 
   char *resistor_fs_source =
           "uniform sampler1D detail_tex;\n"
@@ -1078,6 +2225,59 @@ load_built_in_shaders (void)
 
   /*priv->*/circular_program = hidgl_shader_new ("circular_rendering", NULL, circular_fs_source);
   /*priv->*/resistor_program = hidgl_shader_new ("resistor_rendering", NULL, resistor_fs_source);
+
+  /* Instanced drawing needs OpenGL 3.3 */
+  version = (const char *)glGetString (GL_VERSION);
+  if (version == NULL || sscanf (version, "%d.%d", &major, &minor) != 2 ||
+      major * 10 + minor < 33)
+    {
+      printf ("OpenGL 3.3 not available, circles, arcs and drill channels won't be drawn instanced\n");
+      return;
+    }
+
+  circular_instanced_program = hidgl_shader_new ("circular_instanced_rendering",
+                                                 circular_instanced_vs_source,
+                                                 circular_fs_source);
+
+  /* Attribute 0 aliases the vertex position, so must be per-vertex */
+  program = hidgl_shader_get_program (circular_instanced_program);
+  glBindAttribLocation (program, 0, "corner");
+  glLinkProgram (program);
+
+  circle_attr = glGetAttribLocation (program, "circle");
+  hole_attr   = glGetAttribLocation (program, "hole");
+  color_attr  = glGetAttribLocation (program, "color");
+
+  arc_instanced_program = hidgl_shader_new ("arc_instanced_rendering",
+                                            arc_instanced_vs_source,
+                                            arc_instanced_fs_source);
+
+  program = hidgl_shader_get_program (arc_instanced_program);
+  glBindAttribLocation (program, 0, "corner");
+  glLinkProgram (program);
+
+  arc_bounds_attr = glGetAttribLocation (program, "bounds");
+  arc_attr        = glGetAttribLocation (program, "arc");
+  arc_sweep_attr  = glGetAttribLocation (program, "sweep");
+  arc_color_attr  = glGetAttribLocation (program, "color");
+
+  cylinder_instanced_program = hidgl_shader_new ("cylinder_instanced_rendering",
+                                                 cylinder_instanced_vs_source,
+                                                 cylinder_instanced_fs_source);
+
+  program = hidgl_shader_get_program (cylinder_instanced_program);
+  glBindAttribLocation (program, 0, "unit");
+  glLinkProgram (program);
+
+  cylinder_attr       = glGetAttribLocation (program, "cylinder");
+  cylinder_span_attr  = glGetAttribLocation (program, "span");
+  cylinder_color_attr = glGetAttribLocation (program, "color");
+
+  have_instancing = (circle_attr >= 0 && hole_attr >= 0 && color_attr >= 0 &&
+                     arc_bounds_attr >= 0 && arc_attr >= 0 &&
+                     arc_sweep_attr >= 0 && arc_color_attr >= 0 &&
+                     cylinder_attr >= 0 && cylinder_span_attr >= 0 &&
+                     cylinder_color_attr >= 0);
 }
 
 void
@@ -1124,6 +2324,14 @@ hidgl_init (void)
   glUniform1i          = (PFNGLUNIFORM1IPROC)          wglGetProcAddress ("glUniform1i");
   glActiveTextureARB   = (PFNGLACTIVETEXTUREARBPROC)   wglGetProcAddress ("glActiveTextureARB");
 
+  glBindAttribLocation       = (PFNGLBINDATTRIBLOCATIONPROC)       wglGetProcAddress ("glBindAttribLocation");
+  glGetAttribLocation        = (PFNGLGETATTRIBLOCATIONPROC)        wglGetProcAddress ("glGetAttribLocation");
+  glVertexAttribPointer      = (PFNGLVERTEXATTRIBPOINTERPROC)      wglGetProcAddress ("glVertexAttribPointer");
+  glEnableVertexAttribArray  = (PFNGLENABLEVERTEXATTRIBARRAYPROC)  wglGetProcAddress ("glEnableVertexAttribArray");
+  glDisableVertexAttribArray = (PFNGLDISABLEVERTEXATTRIBARRAYPROC) wglGetProcAddress ("glDisableVertexAttribArray");
+  glVertexAttribDivisor      = (PFNGLVERTEXATTRIBDIVISORPROC)      wglGetProcAddress ("glVertexAttribDivisor");
+  glDrawArraysInstanced      = (PFNGLDRAWARRAYSINSTANCEDPROC)      wglGetProcAddress ("glDrawArraysInstanced");
+
 #endif
 
 #if 0 /* Need to initialise shaders with a current GL context */
@@ -1172,10 +2380,39 @@ hidgl_new_instance (void)
 void
 hidgl_free_instance (hidgl_instance *hidgl)
 {
+  hidgl_finish_instance_batches (hidgl);
   free (hidgl->priv);
   free (hidgl);
 }
 
+/* Creates an instance which can only record retained geometry, without
+ * touching any GL state. Recorders may be used from threads other than
+ * the GL thread, whether or not it is in its rendering context, to build
+ * chunks of retained geometry in parallel.
+ */
+hidgl_instance *
+hidgl_new_recorder (void)
+{
+  hidgl_instance *hidgl;
+  hidgl_priv *priv;
+
+  hidgl = calloc (1, sizeof (hidgl_instance));
+  priv = calloc (1, sizeof (hidgl_priv));
+  hidgl->priv = priv;
+
+  priv->recorder = true;
+  priv->buffer.triangle_array = malloc (BUFFER_SIZE);
+
+  return hidgl;
+}
+
+void
+hidgl_free_recorder (hidgl_instance *hidgl)
+{
+  free (hidgl->priv->buffer.triangle_array);
+  hidgl_free_instance (hidgl);
+}
+
 void
 hidgl_init_gc (hidgl_instance *hidgl, hidGC gc)
 {
@@ -1226,11 +2463,13 @@ hidgl_start_render (hidgl_instance *hidgl)
         load_built_in_shaders ();
       else
         printf ("Failed to initialise shader support\n");
+      hidgl_init_instance_batches (hidgl);
       called = true;
     }
 #endif
 
   hidgl_init_triangle_array (hidgl);
+  hidgl_reset_instance_batches (hidgl);
   hidgl_shader_activate (/*priv->*/circular_program);
 }
 
@@ -1240,6 +2479,7 @@ hidgl_finish_render (hidgl_instance *hidgl)
   if (!in_context)
     fprintf (stderr, "hidgl: hidgl_finish_render() - Not currently in rendering context!\n");
 
+  hidgl_flush_instances (hidgl);
   hidgl_finish_triangle_array (hidgl);
   hidgl_shader_activate (NULL);
   in_context = false;
@@ -1314,6 +2554,32 @@ hidgl_return_stencil_bit (hidgl_instance *hidgl, int bit)
   priv->assigned_bits &= ~bit;
 }
 
+void
+hidgl_set_color (hidgl_instance *hidgl, GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+  hidgl_priv *priv = hidgl->priv;
+
+  priv->color[0] = r;
+  priv->color[1] = g;
+  priv->color[2] = b;
+  priv->color[3] = a;
+
+  if (!priv->recorder)
+    glColor4f (r, g, b, a);
+}
+
+void
+hidgl_get_stats (hidgl_instance *hidgl, hidgl_stats *stats)
+{
+  *stats = hidgl->priv->stats;
+}
+
+void
+hidgl_reset_stats (hidgl_instance *hidgl)
+{
+  memset (&hidgl->priv->stats, 0, sizeof (hidgl_stats));
+}
+
 void
 hidgl_reset_stencil_usage (hidgl_instance *hidgl)
 {
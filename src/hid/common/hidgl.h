@@ -37,11 +37,76 @@ typedef struct {
   bool use_map;
 } triangle_buffer;
 
+/* NB: instance_batch is a private type, holding per-instance data for
+ *     primitives drawn as quads in a single instanced call.
+ *
+ *     Circle instances are x, y, z, radius, (hole radius / radius)^2 and an
+ *     RGBA colour.
+ *
+ *     Arc instances are the quad's bounding box (x1, y1, x2, y2), the centre
+ *     x, y, z and radius, then the half width, start angle, sweep angle (both
+ *     in radians) and cap radius, followed by an RGBA colour.
+ *
+ *     Cylinder instances are the centre x, y and radius, the z of each end,
+ *     and an RGBA colour. They are drawn with one of CYLINDER_MESHES unit
+ *     cylinders, the nth having MIN_CYLINDER_SLICES << n sides.
+ */
+#define CIRCLE_INSTANCE_SIZE 9
+#define ARC_INSTANCE_SIZE 16
+#define CYLINDER_INSTANCE_SIZE 9
+#define CYLINDER_MESHES 7
+#define MIN_CYLINDER_SLICES 6
+typedef struct {
+  GLfloat *instance_data;
+  int instance_count;
+  int instance_space;
+  GLuint instance_vbo_id;
+} instance_batch;
+
+/* Drawing statistics, accumulated until reset with hidgl_reset_stats().
+ * Triangles include the degenerate ones joining separate tri-strips.
+ */
+typedef struct {
+  unsigned long draw_calls;
+  unsigned long flushes;            /* Of the streamed triangle buffer */
+  unsigned long vertices;
+  unsigned long triangles;
+  unsigned long instances;          /* Instanced circles, arcs and cylinders */
+  unsigned long retained_uploads;
+  unsigned long tess_cache_hits;    /* Polygons drawn from cached tri-strips */
+  unsigned long tess_cache_misses;  /* Polygons needing tessellation */
+} hidgl_stats;
+
+/* NB: hidgl_retained is an opaque type, holding geometry recorded once and
+ *     replayed from a static VBO on subsequent frames.
+ */
+typedef struct hidgl_retained hidgl_retained;
+
 /* NB: hidgl_priv is a private type, only defined here to enable inlining of geometry creation */
 typedef struct {
   /* Triangle management */
   triangle_buffer buffer;
 
+  /* Instanced circles and arcs */
+  GLuint quad_vbo_id;
+  instance_batch circles;
+  instance_batch arcs;
+
+  /* Instanced cylinders, batched by the unit cylinder mesh they use */
+  GLuint cylinder_vbo_ids[CYLINDER_MESHES];
+  instance_batch cylinders[CYLINDER_MESHES];
+
+  /* Current colour, used to tag any geometry being recorded */
+  GLfloat color[4];
+
+  /* Retained geometry chunk being recorded, NULL when drawing directly */
+  struct hidgl_retained_chunk *recording;
+
+  /* Set for recorders, which only ever record, and never touch GL state */
+  bool recorder;
+
+  hidgl_stats stats;
+
   /* Stencil management */
   GLint stencil_bits;
   int dirty_bits;
@@ -161,6 +226,9 @@ void hidgl_draw_line (hidGC gc, int cap, Coord width, Coord x1, Coord y1, Coord
 void hidgl_draw_arc (hidGC gc, Coord width, Coord vx, Coord vy, Coord vrx, Coord vry, Angle start_angle, Angle delta_angle, double scale);
 void hidgl_draw_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2);
 void hidgl_fill_circle (hidGC gc, Coord vx, Coord vy, Coord vr);
+void hidgl_queue_circle (hidGC gc, Coord vx, Coord vy, Coord vr, Coord hole_r);
+void hidgl_queue_cylinder (hidGC gc, Coord vx, Coord vy, Coord vr, float z1, float z2, double scale);
+void hidgl_flush_instances (hidgl_instance *hidgl);
 void hidgl_fill_polygon (hidGC gc, int n_coords, Coord *x, Coord *y);
 void hidgl_fill_pcb_polygon (hidGC gc, PolygonType *poly, const BoxType *clip_box);
 void hidgl_fill_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2);
@@ -168,6 +236,8 @@ void hidgl_fill_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2);
 void hidgl_init (void);
 hidgl_instance *hidgl_new_instance (void);
 void hidgl_free_instance (hidgl_instance *hidgl);
+hidgl_instance *hidgl_new_recorder (void);
+void hidgl_free_recorder (hidgl_instance *hidgl);
 void hidgl_init_gc (hidgl_instance *hidgl, hidGC gc);
 void hidgl_finish_gc (hidGC gc);
 void hidgl_start_render (hidgl_instance *hidgl);
@@ -176,6 +246,21 @@ int hidgl_stencil_bits (hidgl_instance *hidgl);
 int hidgl_assign_clear_stencil_bit (hidgl_instance *hidgl);
 void hidgl_return_stencil_bit (hidgl_instance *hidgl, int bit);
 void hidgl_reset_stencil_usage (hidgl_instance *hidgl);
+void hidgl_set_color (hidgl_instance *hidgl, GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+void hidgl_get_stats (hidgl_instance *hidgl, hidgl_stats *stats);
+void hidgl_reset_stats (hidgl_instance *hidgl);
+
+hidgl_retained *hidgl_retained_new (int num_chunks);
+void hidgl_retained_free (hidgl_retained *retained);
+void hidgl_retained_invalidate (hidgl_retained *retained, int chunk);
+void hidgl_retained_invalidate_all (hidgl_retained *retained);
+bool hidgl_retained_chunk_is_dirty (hidgl_retained *retained, int chunk);
+void hidgl_retained_mark_clean (hidgl_retained *retained, int chunk);
+void hidgl_retained_begin_chunk (hidgl_instance *hidgl, hidgl_retained *retained, int chunk);
+void hidgl_retained_begin_pending_chunk (hidgl_instance *hidgl, hidgl_retained *retained, int chunk);
+void hidgl_retained_end_chunk (hidgl_instance *hidgl);
+void hidgl_retained_swap_pending (hidgl_retained *retained, int chunk);
+void hidgl_retained_draw (hidgl_instance *hidgl, hidgl_retained *retained, const bool *visible);
 
 /* hidgl_pacakge_acy_resistor.c */
 void hidgl_draw_acy_resistor (ElementType *element, float surface_depth, float board_thickness);
@@ -0,0 +1,624 @@
+/*
+ *                            COPYRIGHT
+ *
+ *  PCB, interactive printed circuit board design
+ *  Copyright (C) 2026 PCB Contributors (See ChangeLog for details).
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/* Orders the features a machine visits (drill holes, milled contours)
+ * to shorten the rapid travel between them.
+ *
+ * The tool starts at a given position, visits every point once and
+ * stays wherever the last one is, so the tour is an open path.  It is
+ * built by walking to the nearest unvisited point, which is looked up
+ * in a uniform grid, and then improved with 2-opt moves (reversing a
+ * stretch of the path) and Or-opt moves (moving a run of up to three
+ * points elsewhere).  Both kinds of move only consider each point's
+ * few nearest neighbours, so a pass costs O(n) lookups.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "global.h"
+#include "hid/common/toolpath.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+#define TP_NEIGHBOURS 8         /* candidates considered for each point */
+#define TP_MAX_SEGMENT 3        /* longest run moved by Or-opt */
+#define TP_MAX_PASSES 50        /* give up improving after this many */
+
+typedef struct
+{
+  /* point coordinates; index n is the start position */
+  double *x, *y;
+  int n;
+
+  /* uniform grid over the points, cells stored back to back */
+  double minx, miny, cell;
+  int gw, gh;
+  int *cell_start;              /* first slot of each cell, gw * gh + 1 */
+  int *cell_left;               /* points not yet taken from each cell */
+  int *slot_pt;                 /* point in each slot */
+  int *pt_slot;                 /* slot of each point */
+
+  int *nbr;                     /* TP_NEIGHBOURS nearest of each point */
+
+  /* the tour: t[0] is the start, pos[] is the inverse */
+  int *t, *pos;
+  double eps;
+} toolpath;
+
+static inline double
+tp_dist (toolpath *tp, int a, int b)
+{
+  double dx = tp->x[a] - tp->x[b];
+  double dy = tp->y[a] - tp->y[b];
+
+  return sqrt (dx * dx + dy * dy);
+}
+
+static int
+tp_cell_x (toolpath *tp, double x)
+{
+  int c = (x - tp->minx) / tp->cell;
+
+  return CLAMP (c, 0, tp->gw - 1);
+}
+
+static int
+tp_cell_y (toolpath *tp, double y)
+{
+  int c = (y - tp->miny) / tp->cell;
+
+  return CLAMP (c, 0, tp->gh - 1);
+}
+
+static bool
+tp_grid_init (toolpath *tp)
+{
+  double maxx, maxy, w, h;
+  int i, c;
+
+  tp->minx = maxx = tp->x[0];
+  tp->miny = maxy = tp->y[0];
+  for (i = 1; i < tp->n; i++)
+    {
+      tp->minx = MIN (tp->minx, tp->x[i]);
+      tp->miny = MIN (tp->miny, tp->y[i]);
+      maxx = MAX (maxx, tp->x[i]);
+      maxy = MAX (maxy, tp->y[i]);
+    }
+  w = maxx - tp->minx;
+  h = maxy - tp->miny;
+
+  /* about two points per cell */
+  if (w > 0 && h > 0)
+    tp->cell = sqrt (2 * w * h / tp->n);
+  else if (w > 0 || h > 0)
+    tp->cell = 2 * MAX (w, h) / tp->n;
+  else
+    tp->cell = 1;
+  tp->gw = MIN ((int) (w / tp->cell) + 1, tp->n);
+  tp->gh = MIN ((int) (h / tp->cell) + 1, tp->n);
+  tp->cell = MAX (tp->cell, MAX (w / tp->gw, h / tp->gh) * (1 + 1e-9));
+  tp->eps = 1e-9 * MAX (MAX (w, h), tp->cell);
+
+  tp->cell_start = (int *) calloc (tp->gw * tp->gh + 1, sizeof (int));
+  tp->cell_left = (int *) calloc (tp->gw * tp->gh, sizeof (int));
+  tp->slot_pt = (int *) malloc (tp->n * sizeof (int));
+  tp->pt_slot = (int *) malloc (tp->n * sizeof (int));
+  if (!tp->cell_start || !tp->cell_left || !tp->slot_pt || !tp->pt_slot)
+    return false;
+
+  for (i = 0; i < tp->n; i++)
+    {
+      c = tp_cell_y (tp, tp->y[i]) * tp->gw + tp_cell_x (tp, tp->x[i]);
+      tp->cell_left[c]++;
+    }
+  for (c = 0; c < tp->gw * tp->gh; c++)
+    tp->cell_start[c + 1] = tp->cell_start[c] + tp->cell_left[c];
+  memset (tp->cell_left, 0, tp->gw * tp->gh * sizeof (int));
+  for (i = 0; i < tp->n; i++)
+    {
+      c = tp_cell_y (tp, tp->y[i]) * tp->gw + tp_cell_x (tp, tp->x[i]);
+      tp->pt_slot[i] = tp->cell_start[c] + tp->cell_left[c]++;
+      tp->slot_pt[tp->pt_slot[i]] = i;
+    }
+  return true;
+}
+
+/* Takes point p out of the grid, so that it is no longer found */
+static void
+tp_grid_take (toolpath *tp, int p)
+{
+  int c = tp_cell_y (tp, tp->y[p]) * tp->gw + tp_cell_x (tp, tp->x[p]);
+  int last = tp->cell_start[c] + --tp->cell_left[c];
+  int q = tp->slot_pt[last];
+
+  tp->slot_pt[tp->pt_slot[p]] = q;
+  tp->pt_slot[q] = tp->pt_slot[p];
+  tp->slot_pt[last] = p;
+  tp->pt_slot[p] = last;
+}
+
+/* Collects up to k points nearest to point q which are still in the grid,
+ * closest first, leaving out q itself.  Returns the number found.
+ */
+static int
+tp_grid_nearest (toolpath *tp, int q, int k, int *found)
+{
+  double best[TP_NEIGHBOURS];
+  double qx = tp->x[q], qy = tp->y[q];
+  int cx = tp_cell_x (tp, qx), cy = tp_cell_y (tp, qy);
+  int n_found = 0;
+  int r, i, j, s;
+
+  for (r = 0; r < MAX (tp->gw, tp->gh); r++)
+    {
+      double margin;
+
+      for (j = cy - r; j <= cy + r; j++)
+        {
+          if (j < 0 || j >= tp->gh)
+            continue;
+          for (i = cx - r; i <= cx + r; i++)
+            {
+              int c;
+
+              /* only the outer ring of the (2r+1)^2 block is new */
+              if (i < 0 || i >= tp->gw
+                  || (j != cy - r && j != cy + r && i != cx - r && i != cx + r))
+                continue;
+              c = j * tp->gw + i;
+              for (s = tp->cell_start[c];
+                   s < tp->cell_start[c] + tp->cell_left[c]; s++)
+                {
+                  int p = tp->slot_pt[s];
+                  double d = tp_dist (tp, p, q);
+                  int m;
+
+                  if (p == q || (n_found == k && d >= best[k - 1]))
+                    continue;
+                  /* insertion into the short sorted list */
+                  m = MIN (n_found, k - 1);
+                  while (m > 0 && best[m - 1] > d)
+                    {
+                      best[m] = best[m - 1];
+                      found[m] = found[m - 1];
+                      m--;
+                    }
+                  best[m] = d;
+                  found[m] = p;
+                  if (n_found < k)
+                    n_found++;
+                }
+            }
+        }
+
+      /* anything outside the block is at least this far away */
+      margin = MIN (MIN (qx - (tp->minx + (cx - r) * tp->cell),
+                         tp->minx + (cx + r + 1) * tp->cell - qx),
+                    MIN (qy - (tp->miny + (cy - r) * tp->cell),
+                         tp->miny + (cy + r + 1) * tp->cell - qy));
+      if (n_found == k && best[k - 1] <= margin)
+        break;
+    }
+  return n_found;
+}
+
+/* Builds the tour by walking to the nearest point not yet visited */
+static void
+tp_nearest_neighbour (toolpath *tp)
+{
+  int i, next;
+
+  tp->t[0] = tp->n;
+  for (i = 0; i < tp->n; i++)
+    {
+      if (tp_grid_nearest (tp, tp->t[i], 1, &next) != 1)
+        break;
+      tp_grid_take (tp, next);
+      tp->t[i + 1] = next;
+      tp->pos[next] = i + 1;
+    }
+  tp->pos[tp->n] = 0;
+}
+
+static void
+tp_reverse (toolpath *tp, int i, int j)
+{
+  for (; i < j; i++, j--)
+    {
+      int tmp = tp->t[i];
+      tp->t[i] = tp->t[j];
+      tp->t[j] = tmp;
+      tp->pos[tp->t[i]] = i;
+      tp->pos[tp->t[j]] = j;
+    }
+}
+
+/* Tries the 2-opt moves which put point a next to one of its neighbours.
+ * Positions run from 0 (the start) to n, and only the end of the path is
+ * free, so a reversed stretch reaching the end has one new edge.
+ */
+static bool
+tp_two_opt (toolpath *tp, int a)
+{
+  int n = tp->n;
+  int i = tp->pos[a];
+  int prev = tp->t[i - 1];
+  int succ = i < n ? tp->t[i + 1] : -1;
+  int k;
+
+  /* turning the tail around leaves a at the end of the path */
+  if (succ >= 0
+      && tp_dist (tp, a, succ) - tp_dist (tp, a, tp->t[n]) > tp->eps)
+    {
+      tp_reverse (tp, i + 1, n);
+      return true;
+    }
+
+  for (k = 0; k < TP_NEIGHBOURS; k++)
+    {
+      int c = tp->nbr[a * TP_NEIGHBOURS + k];
+      int j, cn, cp;
+      double gain;
+
+      if (c < 0)
+        break;
+      j = tp->pos[c];
+
+      /* a -> c replacing a -> succ */
+      if (succ >= 0 && j > i + 1)
+        {
+          cn = j < n ? tp->t[j + 1] : -1;
+          gain = tp_dist (tp, a, succ) - tp_dist (tp, a, c);
+          if (cn >= 0)
+            gain += tp_dist (tp, c, cn) - tp_dist (tp, succ, cn);
+          if (gain > tp->eps)
+            {
+              tp_reverse (tp, i + 1, j);
+              return true;
+            }
+        }
+      else if (j < i - 1)
+        {
+          cn = tp->t[j + 1];
+          gain = tp_dist (tp, c, cn) - tp_dist (tp, c, a);
+          if (succ >= 0)
+            gain += tp_dist (tp, a, succ) - tp_dist (tp, cn, succ);
+          if (gain > tp->eps)
+            {
+              tp_reverse (tp, j + 1, i);
+              return true;
+            }
+        }
+
+      /* c -> a replacing prev -> a */
+      if (j < i - 1)
+        {
+          cp = tp->t[j - 1];
+          gain = tp_dist (tp, cp, c) + tp_dist (tp, prev, a)
+            - tp_dist (tp, cp, prev) - tp_dist (tp, c, a);
+          if (gain > tp->eps)
+            {
+              tp_reverse (tp, j, i - 1);
+              return true;
+            }
+        }
+      else if (j > i + 1)
+        {
+          cp = tp->t[j - 1];
+          gain = tp_dist (tp, prev, a) + tp_dist (tp, cp, c)
+            - tp_dist (tp, prev, cp) - tp_dist (tp, a, c);
+          if (gain > tp->eps)
+            {
+              tp_reverse (tp, i, j - 1);
+              return true;
+            }
+        }
+    }
+  return false;
+}
+
+/* Moves the run t[s..s+len-1] so that it follows position k, reversed
+ * if asked.  k lies outside the run and its predecessor.
+ */
+static void
+tp_move_run (toolpath *tp, int s, int len, int k, bool reversed)
+{
+  int run[TP_MAX_SEGMENT];
+  int i, lo, hi;
+
+  for (i = 0; i < len; i++)
+    run[i] = tp->t[reversed ? s + len - 1 - i : s + i];
+  if (k > s)
+    {
+      memmove (&tp->t[s], &tp->t[s + len], (k - s - len + 1) * sizeof (int));
+      memcpy (&tp->t[k - len + 1], run, len * sizeof (int));
+      lo = s;
+      hi = k;
+    }
+  else
+    {
+      memmove (&tp->t[k + 1 + len], &tp->t[k + 1], (s - k - 1) * sizeof (int));
+      memcpy (&tp->t[k + 1], run, len * sizeof (int));
+      lo = k + 1;
+      hi = s + len - 1;
+    }
+  for (i = lo; i <= hi; i++)
+    tp->pos[tp->t[i]] = i;
+}
+
+/* Tries moving the run of points starting at position s next to one of
+ * the neighbours of its first or last point.
+ */
+static bool
+tp_or_opt (toolpath *tp, int s)
+{
+  int n = tp->n;
+  int len;
+
+  for (len = 1; len <= TP_MAX_SEGMENT && s + len - 1 <= n; len++)
+    {
+      int e = s + len - 1;
+      int f = tp->t[s], l = tp->t[e], p = tp->t[s - 1];
+      int nx = e < n ? tp->t[e + 1] : -1;
+      double removed = tp_dist (tp, p, f);
+      int end, k;
+
+      if (nx >= 0)
+        removed += tp_dist (tp, l, nx) - tp_dist (tp, p, nx);
+
+      for (end = 0; end < 2; end++)
+        for (k = 0; k < 2 * TP_NEIGHBOURS; k++)
+          {
+            int c = tp->nbr[(end ? l : f) * TP_NEIGHBOURS + k / 2];
+            int u, v, at;
+            double added_fwd, added_rev;
+
+            if (c < 0)
+              break;
+            /* insert after c, or before it */
+            at = tp->pos[c] - (k & 1);
+            if (at >= s - 1 && at <= e)
+              continue;
+            u = tp->t[at];
+            v = at < n ? tp->t[at + 1] : -1;
+            added_fwd = tp_dist (tp, u, f);
+            added_rev = tp_dist (tp, u, l);
+            if (v >= 0)
+              {
+                added_fwd += tp_dist (tp, l, v) - tp_dist (tp, u, v);
+                added_rev += tp_dist (tp, f, v) - tp_dist (tp, u, v);
+              }
+            if (removed - added_fwd > tp->eps
+                && added_fwd <= added_rev)
+              {
+                tp_move_run (tp, s, len, at, false);
+                return true;
+              }
+            if (removed - added_rev > tp->eps)
+              {
+                tp_move_run (tp, s, len, at, true);
+                return true;
+              }
+          }
+    }
+  return false;
+}
+
+static void
+tp_free (toolpath *tp)
+{
+  free (tp->x);
+  free (tp->y);
+  free (tp->cell_start);
+  free (tp->cell_left);
+  free (tp->slot_pt);
+  free (tp->pt_slot);
+  free (tp->nbr);
+  free (tp->t);
+  free (tp->pos);
+}
+
+/* ---------------------------------------------------------------------------
+ * Length of the path from (x0, y0) through the n points in the given
+ * order, or in index order if order is NULL.
+ */
+double
+toolpath_length (const double *x, const double *y, const int *order, int n,
+                 double x0, double y0)
+{
+  double len = 0;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      int p = order ? order[i] : i;
+
+      len += hypot (x[p] - x0, y[p] - y0);
+      x0 = x[p];
+      y0 = y[p];
+    }
+  return len;
+}
+
+/* ---------------------------------------------------------------------------
+ * Finds a short path from (x0, y0) through the n points and stores their
+ * indices in visiting order in order[].  Returns the length of the path,
+ * which is never longer than visiting the points in index order.
+ */
+double
+toolpath_order (const double *x, const double *y, int n,
+                double x0, double y0, int *order)
+{
+  toolpath tp;
+  double len, len_in;
+  int i, pass;
+  bool improved;
+
+  for (i = 0; i < n; i++)
+    order[i] = i;
+  len_in = toolpath_length (x, y, NULL, n, x0, y0);
+  if (n < 3)
+    {
+      if (n == 2 && hypot (x[1] - x0, y[1] - y0) < hypot (x[0] - x0, y[0] - y0))
+        {
+          order[0] = 1;
+          order[1] = 0;
+          return toolpath_length (x, y, order, n, x0, y0);
+        }
+      return len_in;
+    }
+
+  memset (&tp, 0, sizeof (tp));
+  tp.n = n;
+  tp.x = (double *) malloc ((n + 1) * sizeof (double));
+  tp.y = (double *) malloc ((n + 1) * sizeof (double));
+  tp.nbr = (int *) malloc (n * TP_NEIGHBOURS * sizeof (int));
+  tp.t = (int *) malloc ((n + 1) * sizeof (int));
+  tp.pos = (int *) malloc ((n + 1) * sizeof (int));
+  if (!tp.x || !tp.y || !tp.nbr || !tp.t || !tp.pos)
+    goto out;
+  memcpy (tp.x, x, n * sizeof (double));
+  memcpy (tp.y, y, n * sizeof (double));
+  tp.x[n] = x0;
+  tp.y[n] = y0;
+  if (!tp_grid_init (&tp))
+    goto out;
+
+  /* neighbour lists come from the full grid, before the walk empties it */
+  for (i = 0; i < n; i++)
+    {
+      int *nbr = &tp.nbr[i * TP_NEIGHBOURS];
+      int k = tp_grid_nearest (&tp, i, TP_NEIGHBOURS, nbr);
+
+      for (; k < TP_NEIGHBOURS; k++)
+        nbr[k] = -1;
+    }
+  tp_nearest_neighbour (&tp);
+
+  for (pass = 0, improved = true; improved && pass < TP_MAX_PASSES; pass++)
+    {
+      improved = false;
+      for (i = 0; i < n; i++)
+        while (tp_two_opt (&tp, i))
+          improved = true;
+      for (i = 1; i <= n; i++)
+        while (tp_or_opt (&tp, i))
+          improved = true;
+    }
+
+  len = toolpath_length (x, y, tp.t + 1, n, x0, y0);
+  if (len < len_in)
+    memcpy (order, tp.t + 1, n * sizeof (int));
+
+out:
+  tp_free (&tp);
+  return toolpath_length (x, y, order, n, x0, y0);
+}
+
+#ifdef PCB_UNIT_TEST
+
+static bool
+is_permutation (const int *order, int n)
+{
+  bool *seen = (bool *) calloc (n, sizeof (bool));
+  bool ok = true;
+  int i;
+
+  for (i = 0; i < n && ok; i++)
+    {
+      ok = order[i] >= 0 && order[i] < n && !seen[order[i]];
+      if (ok)
+        seen[order[i]] = true;
+    }
+  free (seen);
+  return ok;
+}
+
+static void
+toolpath_test_line ()
+{
+  /* points on a line, shuffled: the only good path sweeps along it */
+  double x[] = { 7, 2, 9, 0, 5, 1, 8, 3, 6, 4 };
+  double y[10] = { 0 };
+  int order[10];
+  int i;
+
+  g_assert_cmpfloat (toolpath_order (x, y, 10, 0, 0, order), ==, 9);
+  for (i = 0; i < 10; i++)
+    g_assert_cmpfloat (x[order[i]], ==, i);
+}
+
+static void
+toolpath_test_grid ()
+{
+  /* a jittered grid, with the points fed in a scrambled order */
+  enum { side = 30, n = side * side };
+  double x[n], y[n];
+  int order[n];
+  double len;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      int k = (i * 367) % n;
+      x[i] = (k % side) * 100 + (k * 7919) % 37;
+      y[i] = (k / side) * 100 + (k * 104729) % 41;
+    }
+
+  len = toolpath_order (x, y, n, 0, 0, order);
+  g_assert (is_permutation (order, n));
+  g_assert_cmpfloat (len, ==, toolpath_length (x, y, order, n, 0, 0));
+  g_assert_cmpfloat (len, <, toolpath_length (x, y, NULL, n, 0, 0));
+  /* a serpentine through the cells is about n * 100 long */
+  g_assert_cmpfloat (len, <, n * 100 * 1.25);
+}
+
+static void
+toolpath_test_degenerate ()
+{
+  double x[] = { 5, 5, 5, 5 };
+  double y[] = { 1, 1, 1, 1 };
+  int order[4];
+
+  g_assert_cmpfloat (toolpath_order (x, y, 0, 0, 0, order), ==, 0);
+  g_assert_cmpfloat (toolpath_order (x, y, 4, 5, 1, order), ==, 0);
+  g_assert (is_permutation (order, 4));
+}
+
+void
+toolpath_register_tests ()
+{
+  g_test_add_func ("/toolpath/test-line", toolpath_test_line);
+  g_test_add_func ("/toolpath/test-grid", toolpath_test_grid);
+  g_test_add_func ("/toolpath/test-degenerate", toolpath_test_degenerate);
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef PCB_HID_COMMON_TOOLPATH_H
+#define PCB_HID_COMMON_TOOLPATH_H
+
+double toolpath_length (const double *x, const double *y, const int *order,
+                        int n, double x0, double y0);
+double toolpath_order (const double *x, const double *y, int n,
+                       double x0, double y0, int *order);
+
+#ifdef PCB_UNIT_TEST
+void toolpath_register_tests ();
+#endif
+
+#endif
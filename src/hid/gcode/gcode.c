@@ -69,6 +69,7 @@
 #include "pcb-printf.h"
 
 #include "hid/common/hidinit.h"
+#include "hid/common/toolpath.h"
 
 #ifdef HAVE_LIBDMALLOC
 #include <dmalloc.h>
@@ -142,6 +143,9 @@ static double gcode_milltoolradius = 0; /* outline-mill tool radius (mm or in)*/
 static double gcode_millplunge = 0;     /* outline-milling plunge feedrate */
 static double gcode_millfeedrate = 0;   /* outline-milling feedrate */
 static char gcode_advanced = 0;
+static char gcode_optimize = 0;         /* wether to reorder the tool path */
+static double gcode_rapid_before = 0;   /* rapid travel in the file being */
+static double gcode_rapid_after = 0;    /* written, before and after (inch) */
 static int save_drill = 0;
 
 /* structure to represent a single hole */
@@ -248,6 +252,12 @@ HID_Attribute gcode_attribute_list[] = {
                      "better hand-editing of the resulting files.",
    HID_Boolean, 0, 0, {-1, 0, 0}, 0, 0},
 #define HA_advanced 16
+
+  {"optimize-toolpath", "Whether to reorder drill holes and isolation\n"
+                        "contours to shorten the rapid moves between them.\n"
+                        "The export log tells how much travel was saved.",
+   HID_Boolean, 0, 0, {0, 0, 0}, 0, 0},
+#define HA_optimize 17
 };
 
 #define NUM_OPTIONS (sizeof(gcode_attribute_list)/sizeof(gcode_attribute_list[0]))
@@ -287,8 +297,42 @@ gcode_get_filename (char *filename, const char *layername)
   // result is in char *filename
 }
 
-/* Sorts drills to produce a short tool path. I start with the hole nearest
- * (0,0) and for each subsequent one, find the hole nearest to the previous.
+/* Orders drills with toolpath_order when the tool path is being
+ * optimized; the rapid travel it saved is measured against the order the
+ * holes were found in */
+static bool
+optimize_drill (struct drill_hole *drill, int n_drill)
+{
+  double *x = (double *) malloc (n_drill * sizeof (double));
+  double *y = (double *) malloc (n_drill * sizeof (double));
+  int *order = (int *) malloc (n_drill * sizeof (int));
+  struct drill_hole *sorted = (struct drill_hole *)
+                              malloc (n_drill * sizeof (struct drill_hole));
+  bool ok = x && y && order && sorted;
+
+  if (ok)
+    {
+      for (int i = 0; i < n_drill; i++)
+        {
+          x[i] = drill[i].x;
+          y[i] = drill[i].y;
+        }
+      gcode_rapid_before += toolpath_length (x, y, NULL, n_drill, 0, 0);
+      gcode_rapid_after += toolpath_order (x, y, n_drill, 0, 0, order);
+      for (int i = 0; i < n_drill; i++)
+        sorted[i] = drill[order[i]];
+      memcpy (drill, sorted, n_drill * sizeof (struct drill_hole));
+    }
+  free (x);
+  free (y);
+  free (order);
+  free (sorted);
+  return ok;
+}
+
+/* Sorts drills to produce a short tool path. Unless the tool path is
+ * optimized, I start with the hole nearest (0,0) and for each subsequent
+ * one, find the hole nearest to the previous.
  * This isn't guaranteed to find the shortest path, but should be good enough.
  * Note that this is O(N^2). We can't use the O(N logN) sort, since our
  * shortest-distance origin changes with every point */
@@ -298,6 +342,9 @@ sort_drill (struct drill_hole *drill, int n_drill)
   /* I start out by looking for points closest to (0,0) */
   struct drill_hole nearest_target = { 0, 0 };
 
+  if (gcode_optimize && n_drill > 2 && optimize_drill (drill, n_drill))
+    return;
+
   /* I sort my list by finding the correct point to fill each slot. I don't need
      to look at the last one, since it'll be in the right place automatically */
   for (int j = 0; j < n_drill-1; j++)
@@ -331,6 +378,19 @@ sort_drill (struct drill_hole *drill, int n_drill)
     }
 }
 
+/* Tells how much rapid travel reordering saved in the file just written */
+static void
+gcode_report_rapid (const char *layername, bool metric)
+{
+  double factor = metric ? 25.4 : 1.0;
+
+  if (gcode_optimize && gcode_rapid_before > 0)
+    Message ("GCODE: %s rapid travel %.2f %s, was %.2f %s\n", layername,
+             gcode_rapid_after * factor, metric ? "mm" : "inch",
+             gcode_rapid_before * factor, metric ? "mm" : "inch");
+  gcode_rapid_before = gcode_rapid_after = 0;
+}
+
 /* *** Main export callback ************************************************ */
 
 static void
@@ -473,6 +533,70 @@ gcode_start_png_export ()
   hid_expose_callback (&gcode_graphics, &region, 0);
 }
 
+/* potrace uses a different kind of bitmap; for simplicity gcode_im is
+   copied to this format and flipped as needed along the way.  The copy
+   runs one scanline at a time, so both images are walked in memory
+   order and every bitmap word is written once.  Black pixels are the
+   copper to be isolated. */
+static potrace_bitmap_t *
+gcode_image_to_bitmap (gdImagePtr im, int flip_x)
+{
+  bool dark[gdMaxColors];
+  potrace_bitmap_t *bm;
+  int sx = gdImageSX (im);
+  int sy = gdImageSY (im);
+  int x, y;
+
+  for (x = 0; x < gdMaxColors; x++)
+    dark[x] = !(im->red[x] || im->green[x] || im->blue[x]);
+
+  bm = bm_new (sx, sy);
+  if (!bm)
+    return NULL;
+
+  for (y = 0; y < sy; y++)
+    {
+      /* potrace's y axis points up */
+      unsigned char *row = im->pixels[sy - 1 - y];
+      potrace_word *out = bm_scanline (bm, y);
+      potrace_word word = 0;
+
+      for (x = 0; x < sx; x++)
+        {
+          if (dark[row[flip_x ? sx - 1 - x : x]])
+            word |= bm_mask (x);
+          if ((x & (BM_WORDBITS - 1)) == BM_WORDBITS - 1)
+            {
+              *out++ = word;
+              word = 0;
+            }
+        }
+      if (sx & (BM_WORDBITS - 1))
+        *out = word;
+    }
+  return bm;
+}
+
+/* mirror the image left to right in place, one scanline at a time */
+static void
+gcode_mirror_image (gdImagePtr im)
+{
+  int sx = gdImageSX (im);
+  int x, y;
+
+  for (y = 0; y < gdImageSY (im); y++)
+    {
+      unsigned char *row = im->pixels[y];
+
+      for (x = 0; x < sx / 2; x++)
+        {
+          unsigned char t = row[x];
+          row[x] = row[sx - 1 - x];
+          row[sx - 1 - x] = t;
+        }
+    }
+}
+
 static FILE *
 gcode_start_gcode (const char *layername, bool metric)
 {
@@ -510,7 +634,8 @@ gcode_do_export (HID_Attr_Val * options)
   int i, idx;
   const Unit *unit;
   double scale = 0, d = 0;
-  int r, c, v, p, metric;
+  double rapid_before, rapid_after;
+  int r, metric;
   path_t *plist = NULL;
   potrace_bitmap_t *bm = NULL;
   potrace_param_t param_default = {
@@ -572,6 +697,8 @@ gcode_do_export (HID_Attr_Val * options)
   gcode_millplunge = options[HA_millplunge].real_value * scale;
   gcode_millfeedrate = options[HA_millfeedrate].real_value * scale;
   gcode_advanced = options[HA_advanced].int_value;
+  gcode_optimize = options[HA_optimize].int_value;
+  gcode_rapid_before = gcode_rapid_after = 0;
   gcode_choose_groups ();
   if (gcode_advanced)
     {
@@ -617,46 +744,14 @@ gcode_do_export (HID_Attr_Val * options)
           hid_restore_layer_ons (save_ons);
 
 /* ***************** gcode conversion *************************** */
-/* potrace uses a different kind of bitmap; for simplicity gcode_im is
-   copied to this format and flipped as needed along the way */
-          bm = bm_new (gdImageSX (gcode_im), gdImageSY (gcode_im));
-          for (r = 0; r < gdImageSX (gcode_im); r++)
+          bm = gcode_image_to_bitmap (gcode_im, is_bottom);
+          if (!bm)
             {
-              for (c = 0; c < gdImageSY (gcode_im); c++)
-                {
-                  if (is_bottom)
-                    v =  /* flip vertically and horizontally */
-                      gdImageGetPixel (gcode_im, gdImageSX (gcode_im) - 1 - r,
-                                       gdImageSY (gcode_im) - 1 - c);
-                  else
-                    v =  /* flip only vertically */
-                      gdImageGetPixel (gcode_im, r,
-                                       gdImageSY (gcode_im) - 1 - c);
-                  p = (gcode_im->red[v] || gcode_im->green[v]
-                       || gcode_im->blue[v]) ? 0 : 0xFFFFFF;
-                  BM_PUT (bm, r, c, p);
-                }
-            }
-          if (is_bottom)
-            { /* flip back layer, used only for PNG output */
-              gdImagePtr temp_im =
-                gdImageCreate (gdImageSX (gcode_im), gdImageSY (gcode_im));
-              gdImageColorAllocate (temp_im, white->r, white->g, white->b);
-              gdImageColorAllocate (temp_im, black->r, black->g, black->b);
-              gdImageCopy (temp_im, gcode_im, 0, 0, 0, 0,
-                           gdImageSX (gcode_im), gdImageSY (gcode_im));
-              for (r = 0; r < gdImageSX (gcode_im); r++)
-                {
-                  for (c = 0; c < gdImageSY (gcode_im); c++)
-                    {
-                      gdImageSetPixel (gcode_im, r, c,
-                                       gdImageGetPixel (temp_im,
-                                                        gdImageSX (gcode_im) -
-                                                        1 - r, c));
-                    }
-                }
-              gdImageDestroy (temp_im);
+              fprintf (stderr, "ERROR: cannot allocate the trace bitmap\n");
+              return;
             }
+          if (is_bottom) /* flip back layer, used only for PNG output */
+            gcode_mirror_image (gcode_im);
           gcode_finish_png (layer_type_to_file_name (idx, FNS_fixed));
           plist = NULL;
           gcode_f = gcode_start_gcode (layer_type_to_file_name (idx, FNS_fixed),
@@ -701,15 +796,18 @@ gcode_do_export (HID_Attr_Val * options)
               return;
             }
           /* generate best polygon and write vertices in g-code format */
-          d = process_path (plist, &param_default, bm, gcode_f,
+          d = process_path (&plist, &param_default, bm, gcode_f,
                             metric ? 25.4 / gcode_dpi : 1.0 / gcode_dpi,
                             variable_cutdepth, variable_safeZ,
-                            variable_isoplunge, variable_isofeedrate);
+                            variable_isoplunge, variable_isofeedrate,
+                            gcode_optimize, &rapid_before, &rapid_after);
           if (d < 0)
             {
               fprintf (stderr, "ERROR: path process function failed\n");
               return;
             }
+          gcode_rapid_before += metric ? rapid_before / 25.4 : rapid_before;
+          gcode_rapid_after += metric ? rapid_after / 25.4 : rapid_after;
           if (gcode_predrill && save_drill)
             {
               int n_all_drills = 0;
@@ -799,11 +897,13 @@ gcode_do_export (HID_Attr_Val * options)
           bm_free (bm);
           fclose (gcode_f);
           gcode_f = NULL;
+          gcode_report_rapid (layer_type_to_file_name (idx, FNS_fixed), metric);
           if (save_drill)
             {
               for (int i_drill_file=0; i_drill_file < n_drills; i_drill_file++)
                 {
                   struct single_size_drills* drill = &drills[i_drill_file];
+                  char layername[32];
 
                   /* don't drill drillmill holes */
                   if (gcode_drillmill) {
@@ -818,16 +918,13 @@ gcode_do_export (HID_Attr_Val * options)
                   d = 0;
                   sort_drill (drill->holes, drill->n_holes);
 
-                  {
-                    // get the filename with the drill size encoded in it
-                    char layername[32];
-                    pcb_snprintf(layername, sizeof(layername),
-                                 "%`.4f.drill",
-                                 metric ?
-                                 drill->diameter_inches * 25.4 :
-                                 drill->diameter_inches);
-                    gcode_f = gcode_start_gcode(layername, metric);
-                  }
+                  // get the filename with the drill size encoded in it
+                  pcb_snprintf(layername, sizeof(layername),
+                               "%`.4f.drill",
+                               metric ?
+                               drill->diameter_inches * 25.4 :
+                               drill->diameter_inches);
+                  gcode_f = gcode_start_gcode(layername, metric);
                   if (!gcode_f)
                     return;
                   fprintf (gcode_f, "(Drill file: %d drills)\n", drill->n_holes);
@@ -894,6 +991,7 @@ gcode_do_export (HID_Attr_Val * options)
                   pcb_fprintf (gcode_f,
                     "(end, total distance %`.2fmm = %`.2fin)\n", 25.4 * d, d);
                   fclose (gcode_f);
+                  gcode_report_rapid (layername, metric);
                 }
 
 /* ******************* handle drill-milling **************************** */
@@ -1016,6 +1114,7 @@ gcode_do_export (HID_Attr_Val * options)
                     else
                       fprintf (gcode_f, "M5\nM9\nM2\n");
                     fclose (gcode_f);
+                    gcode_report_rapid ("drillmill", metric);
 
                     free(drillmill_radiuss);
                     free(drillmill_drills);
@@ -19,6 +19,7 @@
 #include "auxiliary.h"
 #include "trace.h"
 #include "pcb-printf.h"
+#include "hid/common/toolpath.h"
 //#include "progress.h"
 
 #define INFTY 10000000		/* it suffices that this is longer than any
@@ -1449,23 +1450,190 @@ plotpolygon (privpath_t * pp, FILE * f, double scale,
 
 #define TRY(x) if (x) goto try_error
 
-/* return distance on success, -1 on error with errno set. */
+/* upper bound on the threads used to trace the paths of one bitmap */
+#define MAX_TRACE_WORKERS 8
+
+/* ---------------------------------------------------------------------- */
+/* Each path is traced independently of the others, so the polygons are
+   computed on a pool of threads first and written out in list order
+   afterwards, which keeps the output identical to a sequential run. */
+
+typedef struct
+{
+  path_t **paths;
+  int n;
+  gint next;			/* index of the next path to trace */
+  gint failed;
+} trace_queue_t;
+
+static int
+trace_one (path_t * p)
+{
+  TRY (calc_sums (p->priv));
+  TRY (calc_lon (p->priv));
+  TRY (bestpolygon (p->priv));
+  TRY (adjust_vertices (p->priv));
+  return 0;
+
+try_error:
+  return 1;
+}
+
+static void
+trace_worker (gpointer data, gpointer user_data)
+{
+  trace_queue_t *q = (trace_queue_t *) user_data;
+  int i;
+
+  while ((i = g_atomic_int_add (&q->next, 1)) < q->n)
+    if (trace_one (q->paths[i]))
+      g_atomic_int_set (&q->failed, 1);
+}
+
+static int
+trace_worker_count (void)
+{
+#if GLIB_CHECK_VERSION (2, 36, 0)
+  return CLAMP (g_get_num_processors (), 1, MAX_TRACE_WORKERS);
+#else
+  return 1;
+#endif
+}
+
+/* return 0 on success, 1 if any path could not be traced */
+static int
+trace_paths (path_t * plist)
+{
+  trace_queue_t q;
+  path_t *p;
+  int n_workers = trace_worker_count ();
+  int i;
+
+  q.n = 0;
+  list_forall (p, plist)
+    q.n++;
+  q.paths = (path_t **) malloc (MAX (q.n, 1) * sizeof (path_t *));
+  if (!q.paths)
+    return 1;
+  i = 0;
+  list_forall (p, plist)
+    q.paths[i++] = p;
+  q.next = 0;
+  q.failed = 0;
+
+  n_workers = MIN (n_workers, q.n);
+  if (n_workers > 1)
+    {
+      GThreadPool *pool;
+
+      pool = g_thread_pool_new (trace_worker, &q, n_workers - 1, TRUE, NULL);
+      for (i = 0; i < n_workers - 1; i++)
+	g_thread_pool_push (pool, GINT_TO_POINTER (1), NULL);
+      /* this thread takes its share of the queue, too */
+      trace_worker (NULL, &q);
+      g_thread_pool_free (pool, FALSE, TRUE);
+    }
+  else
+    trace_worker (NULL, &q);
+
+  free (q.paths);
+  return q.failed;
+}
+
+/* Orders the traced contours to shorten the rapid moves between them.
+   Every contour is milled from its first polygon vertex around and back
+   to it; paths which produced no polygon go last. */
+static int
+order_paths (path_t ** plistp, double scale, double *before, double *after)
+{
+  path_t *p, **paths, **link;
+  double *x, *y;
+  int *order;
+  int n = 0, n_drawn = 0;
+  int i;
+
+  list_forall (p, *plistp)
+    n++;
+  paths = (path_t **) malloc (MAX (n, 1) * sizeof (path_t *));
+  x = (double *) malloc (MAX (n, 1) * sizeof (double));
+  y = (double *) malloc (MAX (n, 1) * sizeof (double));
+  order = (int *) malloc (MAX (n, 1) * sizeof (int));
+  if (!paths || !x || !y || !order)
+    {
+      free (paths);
+      free (x);
+      free (y);
+      free (order);
+      return 1;
+    }
+
+  i = n;
+  list_forall (p, *plistp)
+  {
+    privpath_t *pp = p->priv;
+
+    if (pp->m)
+      {
+	x[n_drawn] = pp->pt[pp->po[0]].x * scale;
+	y[n_drawn] = pp->pt[pp->po[0]].y * scale;
+	paths[n_drawn++] = p;
+      }
+    else
+      paths[--i] = p;
+  }
+
+  *before = toolpath_length (x, y, NULL, n_drawn, 0, 0);
+  *after = toolpath_order (x, y, n_drawn, 0, 0, order);
+
+  link = plistp;
+  for (i = 0; i < n_drawn; i++)
+    {
+      *link = paths[order[i]];
+      link = &(*link)->next;
+    }
+  /* the undrawn ones were stored back to front */
+  for (i = n - 1; i >= n_drawn; i--)
+    {
+      *link = paths[i];
+      link = &(*link)->next;
+    }
+  *link = NULL;
+
+  free (paths);
+  free (x);
+  free (y);
+  free (order);
+  return 0;
+}
+
+/* return distance on success, -1 on error with errno set.  With reorder
+   set, the contours are milled in the order which shortens the rapid
+   moves; rapid_before and rapid_after, if not NULL, receive the length of
+   those moves in trace order and in the order used. */
 double
-process_path (path_t * plist, const potrace_param_t * param,
+process_path (path_t ** plistp, const potrace_param_t * param,
 	      const potrace_bitmap_t * bm, FILE * f, double scale,
 	      const char *var_cutdepth, const char *var_safeZ,
-	      const char *var_plunge, const char *var_feedrate)
+	      const char *var_plunge, const char *var_feedrate,
+	      int reorder, double *rapid_before, double *rapid_after)
 {
   path_t *p;
   double dm = 0;
+  double before = 0, after = 0;
   int n = 0;
+
+  if (trace_paths (*plistp))
+    return -1;
+  if (reorder && order_paths (plistp, scale, &before, &after))
+    return -1;
+  if (rapid_before)
+    *rapid_before = before;
+  if (rapid_after)
+    *rapid_after = after;
+
   /* call downstream function with each path */
-  list_forall (p, plist)
+  list_forall (p, *plistp)
   {
-    TRY (calc_sums (p->priv));
-    TRY (calc_lon (p->priv));
-    TRY (bestpolygon (p->priv));
-    TRY (adjust_vertices (p->priv));
     fprintf (f, "(polygon %d)\n", ++n);
     dm += plotpolygon (p->priv, f, scale, var_cutdepth, var_safeZ, var_plunge,
                        var_feedrate);
@@ -1481,7 +1649,4 @@ process_path (path_t * plist, const potrace_param_t * param,
   }
 /*      fprintf(f,"(end, total distance %.2fmm = %.2fin)\n",25.4*dm,dm); */
   return dm;
-
-try_error:
-  return -1;
 }
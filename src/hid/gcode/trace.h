@@ -9,9 +9,10 @@
 
 #include "potracelib.h"
 
-double process_path (path_t * plist, const potrace_param_t * param,
+double process_path (path_t ** plistp, const potrace_param_t * param,
 		     const potrace_bitmap_t * bm, FILE * f, double scale,
 		     const char *var_cutdepth, const char *var_safeZ,
-		     const char *var_plunge, const char *var_feedrate);
+		     const char *var_plunge, const char *var_feedrate,
+		     int reorder, double *rapid_before, double *rapid_after);
 
 #endif /* TRACE_H */
@@ -33,6 +33,8 @@
 #include "hid/common/hidnogui.h"
 #include "hid/common/draw_helpers.h"
 #include "hid/common/hidinit.h"
+#include "hid/common/toolpath.h"
+#include "hid/common/digest.h"
 
 #ifdef HAVE_LIBDMALLOC
 #include <dmalloc.h>
@@ -92,6 +94,12 @@ static enum mask_mode current_mask;
 static int flash_drills;
 static int copy_outline_mode;
 static int name_style;
+static int optimize_drills;
+static int reuse_unchanged;
+static guint64 page_digest;
+static bool skip_page;
+static int panel_columns, panel_rows;
+static Coord panel_spacing;
 static LayerType *outline_layer;
 
 #define print_xcoord(file, pcb, val)\
@@ -121,19 +129,26 @@ typedef struct aperture
   Coord width;		/* Size in pcb units */
   ApertureShape shape;		/* ROUND/SQUARE etc */
   struct aperture *next;
+  struct aperture *hash_next;	/* Next in the same hash bucket */
 }
 Aperture;
 
+/* Apertures are kept in a list, in the order they're written to the file,
+   and also hashed on width and shape, so the search made for every line,
+   arc and flash doesn't grow with the number of apertures.  */
 typedef struct 
 {
   Aperture *data;
   int count;
+  Aperture **buckets;
+  int n_buckets;		/* Always a power of two */
 } ApertureList;
 
-static ApertureList *layer_aptr_list;
-static ApertureList *curr_aptr_list;
-static int layer_list_max;
-static int layer_list_idx;
+#define MIN_APERTURE_BUCKETS 64
+
+/* Apertures of the layer being exported */
+static ApertureList layer_apertures;
+static ApertureList *curr_aptr_list = &layer_apertures;
 
 typedef struct
 {
@@ -159,6 +174,8 @@ initApertureList (ApertureList *list)
 {
   list->data = NULL;
   list->count = 0;
+  list->buckets = NULL;
+  list->n_buckets = 0;
 }
 
 static void
@@ -172,6 +189,7 @@ deinitApertureList (ApertureList *list)
       free(search);
       search = next;
     }
+  free (list->buckets);
   initApertureList (list);
 }
 
@@ -179,21 +197,41 @@ static int aperture_count;
 
 static void resetApertures()
 {
-  int i;
-  for (i = 0; i < layer_list_max; ++i)
-    deinitApertureList (&layer_aptr_list[i]);
-  free (layer_aptr_list);
-  layer_aptr_list = NULL;
-  curr_aptr_list  = NULL;
-  layer_list_max = 0;
-  layer_list_idx = 0;
+  deinitApertureList (&layer_apertures);
   aperture_count = 0;
 }
 
+static unsigned int
+hashAperture (ApertureList *list, Coord width, ApertureShape shape)
+{
+  unsigned int h = (unsigned int) width * 2654435761u + (unsigned int) shape;
+
+  return (h ^ (h >> 16)) & (list->n_buckets - 1);
+}
+
+/* Grow the hash table, keeping it at most two apertures per bucket */
+static void
+rehashApertures (ApertureList *list)
+{
+  Aperture *app;
+
+  list->n_buckets = MAX (MIN_APERTURE_BUCKETS, 2 * list->n_buckets);
+  free (list->buckets);
+  list->buckets = (Aperture **) calloc (list->n_buckets, sizeof (Aperture *));
+
+  for (app = list->data; app; app = app->next)
+    {
+      unsigned int h = hashAperture (list, app->width, app->shape);
+      app->hash_next = list->buckets[h];
+      list->buckets[h] = app;
+    }
+}
+
 /* Create and add a new aperture to the list */
 static Aperture *
 addAperture (ApertureList *list, Coord width, ApertureShape shape)
 {
+  unsigned int h;
 
   Aperture *app = (Aperture *) malloc (sizeof *app);
   if (app == NULL)
@@ -207,6 +245,15 @@ addAperture (ApertureList *list, Coord width, ApertureShape shape)
   list->data = app;
   ++list->count;
 
+  if (list->count > 2 * list->n_buckets)
+    rehashApertures (list);
+  else
+    {
+      h = hashAperture (list, width, shape);
+      app->hash_next = list->buckets[h];
+      list->buckets[h] = app;
+    }
+
   return app;
 }
 
@@ -222,9 +269,11 @@ findAperture (ApertureList *list, Coord width, ApertureShape shape)
     return NULL;
 
   /* Search for an appropriate aperture. */
-  for (search = list->data; search; search = search->next)
-    if (search->width == width && search->shape == shape)
-      return search;
+  if (list->n_buckets > 0)
+    for (search = list->buckets[hashAperture (list, width, shape)];
+	 search; search = search->hash_next)
+      if (search->width == width && search->shape == shape)
+	return search;
 
   /* Failing that, create a new one */
   return addAperture (list, width, shape);
@@ -271,24 +320,6 @@ fprintAperture (FILE *f, Aperture *aptr)
     }
 }
 
-/* Set the aperture list for the current layer,
- * expanding the list buffer if needed  */
-static ApertureList *
-setLayerApertureList (int layer_idx)
-{
-  if (layer_idx >= layer_list_max)
-    {
-      int i = layer_list_max;
-      layer_list_max  = 2 * (layer_idx + 1);
-      layer_aptr_list = (ApertureList *)
-                        realloc (layer_aptr_list, layer_list_max * sizeof (*layer_aptr_list));
-      for (; i < layer_list_max; ++i)
-        initApertureList (&layer_aptr_list[i]);
-    }
-  curr_aptr_list = &layer_aptr_list[layer_idx];
-  return curr_aptr_list;
-}
-
 /* --------------------------------------------------------------------------- */
 
 static HID gerber_hid;
@@ -312,7 +343,11 @@ static char *filesuff = NULL;
 static char *layername = NULL;
 static int lncount = 0;
 
-static int finding_apertures = 0;
+/* The layer being drawn, into a temporary file, f.  */
+static int page_group;
+static int page_idx;
+static char *page_name = NULL;
+
 static int pagecount = 0;
 static int linewidth = -1;
 static int lastgroup = -1;
@@ -397,6 +432,52 @@ generate metric Gerber and drill files
   {"name-style", "Naming style for individual gerber files",
    HID_Enum, 0, 0, {0, 0, 0}, name_style_names, 0},
 #define HA_name_style 5
+
+/* %start-doc options "90 Gerber Export"
+@ftable @code
+@item --optimize-drills
+Order the holes of each drill size to shorten the travel between them,
+instead of sorting them by position.
+@end ftable
+%end-doc
+*/
+  {"optimize-drills", "Order holes to shorten the drill travel",
+   HID_Boolean, 0, 0, {0, 0, 0}, 0, 0},
+#define HA_optimize_drills 6
+
+/* %start-doc options "90 Gerber Export"
+@ftable @code
+@item --reuse-unchanged
+Record a digest of each file's content in its header, and leave files
+alone whose content would not change on the next export.
+@end ftable
+%end-doc
+*/
+  {"reuse-unchanged", "Don't rewrite files whose content is unchanged",
+   HID_Boolean, 0, 0, {0, 0, 0}, 0, 0},
+#define HA_reuse_unchanged 7
+
+/* %start-doc options "90 Gerber Export"
+@ftable @code
+@item --panel-columns <num>
+@item --panel-rows <num>
+Export a panel of this many copies of the board, side by side.  The
+board is written once in each Gerber file, inside a step and repeat
+block, and the drill files repeat each hole at every copy's offset.
+@item --panel-spacing <measure>
+Gap between neighbouring boards of a panel.
+@end ftable
+%end-doc
+*/
+  {"panel-columns", "Number of board copies across a panel",
+   HID_Integer, 1, 100, {1, 0, 0}, 0, 0},
+#define HA_panel_columns 8
+  {"panel-rows", "Number of board copies down a panel",
+   HID_Integer, 1, 100, {1, 0, 0}, 0, 0},
+#define HA_panel_rows 9
+  {"panel-spacing", "Gap between the boards of a panel",
+   HID_Coord, 0, MIL_TO_COORD (1000), {0, 0, 0, 0}, 0, 0},
+#define HA_panel_spacing 10
 };
 
 #define NUM_OPTIONS (sizeof(gerber_options)/sizeof(gerber_options[0]))
@@ -428,19 +509,6 @@ layer_stack_sort (const void *va, const void *vb)
   return b_layer - a_layer;
 }
 
-static void
-maybe_close_f (FILE *f)
-{
-  if (f)
-    {
-      if (was_drill)
-	fprintf (f, "M30\r\n");
-      else
-	fprintf (f, "M02*\r\n");
-      fclose (f);
-    }
-}
-
 static BoxType region;
 
 /* Very similar to layer_type_to_file_name() but appends only a
@@ -585,6 +653,268 @@ assign_file_suffix (char *dest, int idx)
   strcat (dest, sext);
 }
 
+static int
+drill_sort (const void *va, const void *vb)
+{
+  PendingDrills *a = (PendingDrills *) va;
+  PendingDrills *b = (PendingDrills *) vb;
+  if (a->diam != b->diam)
+    return a->diam - b->diam;
+  if (a->x != b->x)
+    return a->x - b->x;
+  return a->y - b->y;
+}
+
+/* Reorders the pending drills of each size, already grouped by
+   drill_sort, to shorten the travel from one hole to the next.  */
+static void
+optimize_drill_order (void)
+{
+  double *x = (double *) malloc (n_pending_drills * sizeof (double));
+  double *y = (double *) malloc (n_pending_drills * sizeof (double));
+  int *order = (int *) malloc (n_pending_drills * sizeof (int));
+  PendingDrills *group = (PendingDrills *) malloc (n_pending_drills *
+						   sizeof (PendingDrills));
+  double before, after;
+  double x0 = 0, y0 = 0;
+  int start, end, i;
+
+  if (!x || !y || !order || !group)
+    goto out;
+
+  for (i = 0; i < n_pending_drills; i++)
+    {
+      x[i] = pending_drills[i].x;
+      y[i] = pending_drills[i].y;
+    }
+  before = toolpath_length (x, y, NULL, n_pending_drills, 0, 0);
+
+  for (start = 0; start < n_pending_drills; start = end)
+    {
+      for (end = start + 1; end < n_pending_drills; end++)
+	if (pending_drills[end].diam != pending_drills[start].diam)
+	  break;
+      /* each size starts where the previous one ended */
+      toolpath_order (x + start, y + start, end - start, x0, y0, order);
+      for (i = 0; i < end - start; i++)
+	group[i] = pending_drills[start + order[i]];
+      memcpy (pending_drills + start, group,
+	      (end - start) * sizeof (PendingDrills));
+      x0 = pending_drills[end - 1].x;
+      y0 = pending_drills[end - 1].y;
+    }
+
+  for (i = 0; i < n_pending_drills; i++)
+    {
+      x[i] = pending_drills[i].x;
+      y[i] = pending_drills[i].y;
+    }
+  after = toolpath_length (x, y, NULL, n_pending_drills, 0, 0);
+  if (verbose)
+    pcb_printf ("Gerber: drill travel %$mS, was %$mS\n",
+		(Coord) after, (Coord) before);
+
+out:
+  free (x);
+  free (y);
+  free (order);
+  free (group);
+}
+
+/* Print the header of a layer's file, which lists every aperture the
+   layer uses.  */
+static void
+print_layer_header (FILE *out, ApertureList *aptr_list)
+{
+  time_t currenttime;
+  char utcTime[64];
+#ifdef HAVE_GETPWUID
+  struct passwd *pwentry;
+#endif
+  Aperture *search;
+  char *cp;
+
+  if (was_drill)
+    {
+      /* We omit the ,TZ here because we are not omitting trailing zeros.  Our format is
+	 always six-digit 0.1 mil or µm resolution (i.e. 001100 = 0.11" or 1.1mm)*/
+      fprintf (out, "M48\r\n");
+      if (reuse_unchanged)
+	fprintf (out, ";" EXPORT_DIGEST_TAG " %016" G_GINT64_MODIFIER "x\r\n",
+		 page_digest);
+      fprintf (out, metric ? "METRIC,000.000\r\n" : "INCH\r\n");
+      for (search = aptr_list->data; search; search = search->next)
+	pcb_fprintf (out, metric ? "T%02dC%.3`mm\r\n" : "T%02dC%.3`mi\r\n", search->dCode, search->width);
+      fprintf (out, "%%\r\n");
+      /* FIXME */
+      return;
+    }
+
+  fprintf (out, "G04 start of page %d for group %d idx %d *\r\n",
+	   pagecount, page_group, page_idx);
+
+  /* Create a portable timestamp. */
+  currenttime = time (NULL);
+  {
+    /* avoid gcc complaints */
+    const char *fmt = "%c UTC";
+    strftime (utcTime, sizeof utcTime, fmt, gmtime (&currenttime));
+  }
+  /* Print a cute file header at the beginning of each file. */
+  fprintf (out, "G04 Title: %s, %s *\r\n", UNKNOWN (PCB->Name),
+	   UNKNOWN (page_name));
+  fprintf (out, "G04 Creator: %s " VERSION " *\r\n", Progname);
+  fprintf (out, "G04 CreationDate: %s *\r\n", utcTime);
+  if (reuse_unchanged)
+    fprintf (out, "G04 " EXPORT_DIGEST_TAG " %016" G_GINT64_MODIFIER "x *\r\n",
+	     page_digest);
+
+#ifdef HAVE_GETPWUID
+  /* ID the user. */
+  pwentry = getpwuid (getuid ());
+  fprintf (out, "G04 For: %s *\r\n", pwentry->pw_name);
+#endif
+
+  fprintf (out, "G04 Format: Gerber/RS-274X *\r\n");
+  pcb_fprintf (out, metric ? "G04 PCB-Dimensions (mm): %.2mm %.2mm *\r\n" :
+	   "G04 PCB-Dimensions (mil): %.2ml %.2ml *\r\n",
+	   PCB->MaxWidth, PCB->MaxHeight);
+  fprintf (out, "G04 PCB-Coordinate-Origin: lower left *\r\n");
+
+  /* Signal data in inches. */
+  fprintf (out, metric ? "%%MOMM*%%\r\n" : "%%MOIN*%%\r\n");
+
+  /* Signal Leading zero suppression, Absolute Data, 2.5 format in inch, 4.3 in mm */
+  fprintf (out, metric ? "%%FSLAX43Y43*%%\r\n" : "%%FSLAX25Y25*%%\r\n");
+
+  /* build a legal identifier. */
+  if (layername)
+    free (layername);
+  layername = strdup (filesuff);
+  if (strrchr (layername, '.'))
+    * strrchr (layername, '.') = 0;
+
+  for (cp=layername; *cp; cp++)
+    {
+      if (isalnum((int) *cp))
+	*cp = toupper((int) *cp);
+      else
+	*cp = '_';
+    }
+  fprintf (out, "%%LN%s*%%\r\n", layername);
+  lncount = 1;
+
+  for (search = aptr_list->data; search; search = search->next)
+    fprintAperture(out, search);
+  if (aptr_list->count == 0)
+    /* We need to put *something* in the file to make it be parsed
+       as RS-274X instead of RS-274D. */
+    fprintf (out, "%%ADD11C,0.0100*%%\r\n");
+}
+
+/* Finish the layer drawn so far.  Its drawing went into a temporary file,
+   so that it could be written out in a single pass, with the header only
+   written once every aperture it uses is known.  Layers which turned out
+   empty aren't written at all.  */
+static void
+finish_layer (void)
+{
+  ApertureList *aptr_list = curr_aptr_list;
+  FILE *out;
+  char buf[BUFSIZ];
+  size_t n;
+  bool panel;
+
+  if (f == NULL)
+    return;
+
+  if (was_drill && n_pending_drills)
+    {
+      int i, next;
+      /* dump pending drills in sequence */
+      qsort (pending_drills, n_pending_drills, sizeof (pending_drills[0]),
+	     drill_sort);
+      if (optimize_drills)
+	optimize_drill_order ();
+      for (i = 0; i < n_pending_drills; i = next)
+	{
+	  Aperture *ap = findAperture (aptr_list, pending_drills[i].diam, ROUND);
+	  int row, col, k;
+
+	  for (next = i + 1; next < n_pending_drills; next++)
+	    if (pending_drills[next].diam != pending_drills[i].diam)
+	      break;
+	  fprintf (f, "T%02d\r\n", ap->dCode);
+	  /* Every copy of a panel gets this size's holes before the tool
+	     changes, visiting the copies back and forth along each row.  */
+	  for (row = 0; row < panel_rows; row++)
+	    for (k = 0; k < panel_columns; k++)
+	      {
+		Coord dx, dy;
+		int j;
+
+		col = (row & 1) ? panel_columns - 1 - k : k;
+		dx = col * (PCB->MaxWidth + panel_spacing);
+		dy = row * (PCB->MaxHeight + panel_spacing);
+		for (j = i; j < next; j++)
+		  pcb_fprintf (f, metric ? "X%06.0muY%06.0mu\r\n" : "X%06.0mtY%06.0mt\r\n",
+			       gerberDrX (PCB, pending_drills[j].x) + dx,
+			       gerberDrY (PCB, pending_drills[j].y) + dy);
+	      }
+	}
+      free (pending_drills);
+      n_pending_drills = max_pending_drills = 0;
+      pending_drills = NULL;
+    }
+
+  if (aptr_list->count == 0 && !all_layers)
+    goto done;
+
+  pagecount++;
+  assign_file_suffix (filesuff, page_idx);
+  out = fopen (filename, "wb");   /* Binary needed to force CR-LF */
+  if (out == NULL)
+    {
+      Message ( "Error:  Could not open %s for writing.\n", filename);
+      goto done;
+    }
+
+  if (verbose)
+    {
+      int c = aptr_list->count;
+      printf ("Gerber: %d aperture%s in %s\n", c,
+	      c == 1 ? "" : "s", filename);
+    }
+
+  print_layer_header (out, aptr_list);
+
+  /* A panel repeats the board's image, which is written only once */
+  panel = !was_drill && (panel_columns > 1 || panel_rows > 1);
+  if (panel)
+    pcb_fprintf (out, metric ? "%%SRX%dY%dI%.4`mmJ%.4`mm*%%\r\n"
+		 : "%%SRX%dY%dI%.5`miJ%.5`mi*%%\r\n",
+		 panel_columns, panel_rows,
+		 PCB->MaxWidth + panel_spacing,
+		 PCB->MaxHeight + panel_spacing);
+
+  rewind (f);
+  while ((n = fread (buf, 1, sizeof (buf), f)) > 0)
+    fwrite (buf, 1, n, out);
+
+  if (panel)
+    fprintf (out, "%%SR*%%\r\n");
+  if (was_drill)
+    fprintf (out, "M30\r\n");
+  else
+    fprintf (out, "M02*\r\n");
+  fclose (out);
+
+ done:
+  fclose (f);
+  f = NULL;
+  deinitApertureList (aptr_list);
+}
+
 static void
 gerber_do_export (HID_Attr_Val * options)
 {
@@ -624,6 +954,11 @@ gerber_do_export (HID_Attr_Val * options)
 
   copy_outline_mode = options[HA_copy_outline].int_value;
   name_style = options[HA_name_style].int_value;
+  optimize_drills = options[HA_optimize_drills].int_value;
+  reuse_unchanged = options[HA_reuse_unchanged].int_value;
+  panel_columns = MAX (options[HA_panel_columns].int_value, 1);
+  panel_rows = MAX (options[HA_panel_rows].int_value, 1);
+  panel_spacing = options[HA_panel_spacing].coord_value;
 
   outline_layer = NULL;
 
@@ -679,21 +1014,20 @@ gerber_do_export (HID_Attr_Val * options)
   region.Y2 = PCB->MaxHeight;
 
   pagecount = 1;
+  skip_page = false;
   resetApertures ();
 
+  /* Every layer is drawn in this one pass, one after another.  The gcode
+     and nelma exporters only use worker threads for what they do with a
+     layer once it's drawn.  Here the drawing itself is the work, and it
+     goes through draw.c, whose drawing state is global and shared by
+     every layer, so it has to stay on one thread.  */
   lastgroup = -1;
-  layer_list_idx = 0;
-  finding_apertures = 1;
-  hid_expose_callback (&gerber_graphics, &region, 0);
-
-  layer_list_idx = 0;
-  finding_apertures = 0;
   hid_expose_callback (&gerber_graphics, &region, 0);
+  finish_layer ();
 
   memcpy (LayerStack, saved_layer_stack, sizeof (LayerStack));
 
-  maybe_close_f (f);
-  f = NULL;
   hid_restore_layer_ons (save_ons);
   PCB->Flags = save_thindraw;
 }
@@ -705,23 +1039,52 @@ gerber_parse_arguments (int *argc, char ***argv)
   hid_parse_command_line (argc, argv);
 }
 
-static int
-drill_sort (const void *va, const void *vb)
+/* Digests everything that can end up in the file of the page being
+   started: the objects drawn on it, and the settings it depends on.  */
+static guint64
+page_content_digest (const char *name, int group, int idx)
 {
-  PendingDrills *a = (PendingDrills *) va;
-  PendingDrills *b = (PendingDrills *) vb;
-  if (a->diam != b->diam)
-    return a->diam - b->diam;
-  if (a->x != b->x)
-    return a->x - b->x;
-  return a->y - b->y;
+  guint64 d = export_digest_start ();
+
+  d = export_digest_string (d, VERSION);
+  d = export_digest_string (d, UNKNOWN (PCB->Name));
+  d = export_digest_string (d, name);
+  d = export_digest_int (d, group);
+  d = export_digest_int (d, idx);
+  d = export_digest_int (d, metric);
+  d = export_digest_int (d, all_layers);
+  d = export_digest_int (d, PCB->MaxWidth);
+  d = export_digest_int (d, PCB->MaxHeight);
+  d = export_digest_int (d, panel_columns);
+  d = export_digest_int (d, panel_rows);
+  d = export_digest_int (d, panel_spacing);
+
+  if (is_drill)
+    return export_digest_holes (export_digest_int (d, optimize_drills),
+				PCB->Data);
+
+  d = export_digest_int (d, PCB->Flags.f);
+  d = export_digest_int (d, PCB->minWid);
+  d = export_digest_int (d, PCB->minSlk);
+  d = export_digest_int (d, copy_outline_mode);
+  if (group >= 0)
+    d = export_digest_group (d, group);
+  else
+    {
+      d = export_digest_layer (d, &PCB->Data->Layer[bottom_silk_layer]);
+      d = export_digest_layer (d, &PCB->Data->Layer[top_silk_layer]);
+    }
+  if (copy_outline_mode != COPY_OUTLINE_NONE && outline_layer)
+    d = export_digest_layer (d, outline_layer);
+  d = export_digest_elements (d, PCB->Data);
+  d = export_digest_vias (d, PCB->Data);
+  return export_digest_font (d, &PCB->Font);
 }
 
 static int
 gerber_set_layer (const char *name, int group, int empty)
 {
   int want_outline;
-  char *cp;
   int idx = (group >= 0
 	     && group <
 	     max_group) ? PCB->LayerGroups.Entries[group][0] : group;
@@ -742,27 +1105,11 @@ gerber_set_layer (const char *name, int group, int empty)
       strcmp (name, "route") == 0)
     flash_drills = 1;
 
-  if (is_drill && n_pending_drills)
-    {
-      int i;
-      /* dump pending drills in sequence */
-      qsort (pending_drills, n_pending_drills, sizeof (pending_drills[0]),
-	     drill_sort);
-      for (i = 0; i < n_pending_drills; i++)
-	{
-	  if (i == 0 || pending_drills[i].diam != pending_drills[i - 1].diam)
-	    {
-	      Aperture *ap = findAperture (curr_aptr_list, pending_drills[i].diam, ROUND);
-	      fprintf (f, "T%02d\r\n", ap->dCode);
-	    }
-	  pcb_fprintf (f, metric ? "X%06.0muY%06.0mu\r\n" : "X%06.0mtY%06.0mt\r\n",
-		   gerberDrX (PCB, pending_drills[i].x),
-		   gerberDrY (PCB, pending_drills[i].y));
-	}
-      free (pending_drills);
-      n_pending_drills = max_pending_drills = 0;
-      pending_drills = NULL;
-    }
+  /* Anything drawn since the last new group belongs to the last layer */
+  if (group < 0 || group != lastgroup)
+    finish_layer ();
+  else if (skip_page)
+    return 0;
 
   is_drill = (SL_TYPE (idx) == SL_PDRILL || SL_TYPE (idx) == SL_UDRILL);
   is_mask = (SL_TYPE (idx) == SL_MASK);
@@ -774,122 +1121,48 @@ gerber_set_layer (const char *name, int group, int empty)
 
   if (group < 0 || group != lastgroup)
     {
-      time_t currenttime;
-      char utcTime[64];
-#ifdef HAVE_GETPWUID
-      struct passwd *pwentry;
-#endif
-      ApertureList *aptr_list;
-      Aperture *search;
-
       lastgroup = group;
       lastX = -1;
       lastY = -1;
       linewidth = -1;
       lastcap = -1;
 
-      aptr_list = setLayerApertureList (layer_list_idx++);
-
-      if (finding_apertures)
-	goto emit_outline;
-
-      if (aptr_list->count == 0 && !all_layers)
-	return 0;
-
-      maybe_close_f (f);
-      f = NULL;
-
-      pagecount++;
-      assign_file_suffix (filesuff, idx);
-      f = fopen (filename, "wb");   /* Binary needed to force CR-LF */
-      if (f == NULL) 
+      /* An up to date file from an earlier export is left as it is */
+      skip_page = false;
+      if (reuse_unchanged)
 	{
-	  Message ( "Error:  Could not open %s for writing.\n", filename);
-	  return 1;
-	}
-
-      was_drill = is_drill;
+	  guint64 recorded;
 
-      if (verbose)
-	{
-	  int c = aptr_list->count;
-	  printf ("Gerber: %d aperture%s in %s\n", c,
-		  c == 1 ? "" : "s", filename);
+	  page_digest = page_content_digest (name, group, idx);
+	  assign_file_suffix (filesuff, idx);
+	  if (export_digest_read (filename, &recorded)
+	      && recorded == page_digest)
+	    {
+	      if (verbose)
+		printf ("Gerber: %s is unchanged\n", filename);
+	      pagecount++;
+	      skip_page = true;
+	      return 0;
+	    }
 	}
 
-      if (is_drill)
+      f = tmpfile ();
+      if (f == NULL)
 	{
-	  /* We omit the ,TZ here because we are not omitting trailing zeros.  Our format is
-	     always six-digit 0.1 mil or µm resolution (i.e. 001100 = 0.11" or 1.1mm)*/
-	  fprintf (f, "M48\r\n");
-	  fprintf (f, metric ? "METRIC,000.000\r\n" : "INCH\r\n");
-	  for (search = aptr_list->data; search; search = search->next)
-		  pcb_fprintf (f, metric ? "T%02dC%.3`mm\r\n" : "T%02dC%.3`mi\r\n", search->dCode, search->width);
-	  fprintf (f, "%%\r\n");
-	  /* FIXME */
-	  return 1;
+	  Message ( "Error:  Could not create a temporary file for %s.\n", name);
+	  return 0;
 	}
 
-      fprintf (f, "G04 start of page %d for group %d idx %d *\r\n",
-	       pagecount, group, idx);
-
-      /* Create a portable timestamp. */
-      currenttime = time (NULL);
-      {
-	/* avoid gcc complaints */
-	const char *fmt = "%c UTC";
-	strftime (utcTime, sizeof utcTime, fmt, gmtime (&currenttime));
-      }
-      /* Print a cute file header at the beginning of each file. */
-      fprintf (f, "G04 Title: %s, %s *\r\n", UNKNOWN (PCB->Name),
-	       UNKNOWN (name));
-      fprintf (f, "G04 Creator: %s " VERSION " *\r\n", Progname);
-      fprintf (f, "G04 CreationDate: %s *\r\n", utcTime);
-
-#ifdef HAVE_GETPWUID
-      /* ID the user. */
-      pwentry = getpwuid (getuid ());
-      fprintf (f, "G04 For: %s *\r\n", pwentry->pw_name);
-#endif
-
-      fprintf (f, "G04 Format: Gerber/RS-274X *\r\n");
-      pcb_fprintf (f, metric ? "G04 PCB-Dimensions (mm): %.2mm %.2mm *\r\n" :
-	       "G04 PCB-Dimensions (mil): %.2ml %.2ml *\r\n",
-	       PCB->MaxWidth, PCB->MaxHeight);
-      fprintf (f, "G04 PCB-Coordinate-Origin: lower left *\r\n");
-
-      /* Signal data in inches. */
-      fprintf (f, metric ? "%%MOMM*%%\r\n" : "%%MOIN*%%\r\n");
-
-      /* Signal Leading zero suppression, Absolute Data, 2.5 format in inch, 4.3 in mm */
-      fprintf (f, metric ? "%%FSLAX43Y43*%%\r\n" : "%%FSLAX25Y25*%%\r\n");
-
-      /* build a legal identifier. */
-      if (layername)
-	free (layername);
-      layername = strdup (filesuff);
-      if (strrchr (layername, '.'))
-	* strrchr (layername, '.') = 0;
-
-      for (cp=layername; *cp; cp++)
-	{
-	  if (isalnum((int) *cp))
-	    *cp = toupper((int) *cp);
-	  else
-	    *cp = '_';
-	}
-      fprintf (f, "%%LN%s*%%\r\n", layername);
-      lncount = 1;
+      page_group = group;
+      page_idx = idx;
+      free (page_name);
+      page_name = strdup (name);
+      was_drill = is_drill;
 
-      for (search = aptr_list->data; search; search = search->next)
-        fprintAperture(f, search);
-      if (aptr_list->count == 0)
-	/* We need to put *something* in the file to make it be parsed
-	   as RS-274X instead of RS-274D. */
-	fprintf (f, "%%ADD11C,0.0100*%%\r\n");
+      if (is_drill)
+	return 1;
     }
 
- emit_outline:
   /* If we're printing a copper layer other than the outline layer,
      and we want to "print outlines", and we have an outline layer,
      print the outline layer on this layer also.  */
@@ -0,0 +1,833 @@
+/*
+ *                            COPYRIGHT
+ *
+ *  PCB, interactive printed circuit board design
+ *  Copyright (C) 2026 PCB Contributors (See ChangeLog for details).
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+ *  Headless redraw benchmark.
+ *
+ *  Renders the board through the common GL code (hid/common/hidgl.c)
+ *  into an offscreen OSMesa context, replaying a scripted sequence of
+ *  pans and zooms, and reports frame time percentiles. OSMesa renders
+ *  in software, so this needs neither a display nor a GPU.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <glib.h>
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <GL/osmesa.h>
+#include <GL/gl.h>
+
+#include "global.h"
+#include "data.h"
+#include "error.h"
+#include "misc.h"
+#include "rtree.h"
+
+#include "hid.h"
+#include "hid_draw.h"
+#include "../hidint.h"
+#include "hid/common/hidnogui.h"
+#include "hid/common/draw_helpers.h"
+#include "hid/common/hidinit.h"
+#include "hid/common/hidgl.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+static HID glbench_hid;
+static HID_DRAW glbench_graphics;
+static HID_DRAW_CLASS glbench_graphics_class;
+
+typedef struct glbench_gc_struct
+{
+  struct hidgl_gc_struct hidgl_gc; /* Parent */
+
+  const char *colorname;
+  Coord width;
+  int cap;
+} *glbenchGC;
+
+/* One step of the script. The view is centred on (x, y), given as
+ * fractions of the board size, and magnified zoom times from the view
+ * fitting the whole board.
+ */
+typedef struct
+{
+  double zoom;
+  double x, y;
+} bench_view;
+
+/* The default script: the whole board, then zooming in on it in steps,
+ * panning across it at each magnification, and zooming back out.
+ */
+static bench_view default_script[] = {
+  {1., .5,    .5},
+  {2., .5,    .5},
+  {2., .25,   .25},   {2., .75,   .25},   {2., .75,   .75},   {2., .25,   .75},
+  {4., .5,    .5},
+  {4., .125,  .5},    {4., .375,  .5},    {4., .625,  .5},    {4., .875,  .5},
+  {8., .5,    .5},
+  {8., .0625, .0625}, {8., .1875, .1875}, {8., .3125, .3125}, {8., .4375, .4375},
+  {8., .5625, .5625}, {8., .6875, .6875}, {8., .8125, .8125}, {8., .9375, .9375},
+  {4., .5,    .5},
+  {2., .5,    .5},
+  {1., .5,    .5},
+};
+
+static hidgl_instance *hidgl = NULL;
+static hidGC current_gc = NULL;
+static char *current_colorname = NULL;
+static bool trans_lines = false;
+static int subcomposite_stencil_bit = 0;
+static enum mask_mode cur_mask = HID_MASK_OFF;
+static int width, height;
+static double coord_per_px;
+
+HID_Attribute glbench_attribute_list[] = {
+  /* other HIDs expect this to be first.  */
+
+/* %start-doc options "95 GL Benchmark"
+@ftable @code
+@item --width <num>
+Width of the offscreen view in pixels.
+@end ftable
+%end-doc
+*/
+  {"width", "Width of the view (pixels)",
+   HID_Integer, 16, 10000, {1024, 0, 0}, 0, 0},
+#define HA_width 0
+
+/* %start-doc options "95 GL Benchmark"
+@ftable @code
+@item --height <num>
+Height of the offscreen view in pixels.
+@end ftable
+%end-doc
+*/
+  {"height", "Height of the view (pixels)",
+   HID_Integer, 16, 10000, {768, 0, 0}, 0, 0},
+#define HA_height 1
+
+/* %start-doc options "95 GL Benchmark"
+@ftable @code
+@item --repeat <num>
+Number of times the script is replayed.
+@end ftable
+%end-doc
+*/
+  {"repeat", "Number of times the script is replayed",
+   HID_Integer, 1, 1000, {5, 0, 0}, 0, 0},
+#define HA_repeat 2
+
+/* %start-doc options "95 GL Benchmark"
+@ftable @code
+@item --script <string>
+File of views to render in place of the built in script, one per line,
+as a magnification followed by the x and y coordinates of the centre
+of the view, given as fractions of the board size.  Blank lines and
+lines starting with @samp{#} are ignored.
+@end ftable
+%end-doc
+*/
+  {"script", "File of views to render (zoom x y per line)",
+   HID_String, 0, 0, {0, 0, 0}, 0, 0},
+#define HA_script 3
+};
+
+#define NUM_OPTIONS (sizeof(glbench_attribute_list)/sizeof(glbench_attribute_list[0]))
+
+REGISTER_ATTRIBUTES (glbench_attribute_list)
+
+static HID_Attr_Val glbench_values[NUM_OPTIONS];
+
+static HID_Attribute *
+glbench_get_export_options (int *n)
+{
+  if (n)
+    *n = NUM_OPTIONS;
+  return glbench_attribute_list;
+}
+
+static void
+glbench_parse_arguments (int *argc, char ***argv)
+{
+  hid_register_attributes (glbench_attribute_list,
+                           sizeof (glbench_attribute_list) /
+                           sizeof (glbench_attribute_list[0]));
+  hid_parse_command_line (argc, argv);
+}
+
+static void
+start_subcomposite (void)
+{
+  /* Flush out any existing geoemtry to be rendered */
+  hidgl_flush_instances (hidgl);
+  hidgl_flush_triangles (hidgl);
+
+  glEnable (GL_STENCIL_TEST);
+  glStencilOp (GL_KEEP, GL_KEEP, GL_REPLACE);
+
+  subcomposite_stencil_bit = hidgl_assign_clear_stencil_bit (hidgl);
+  glStencilMask (subcomposite_stencil_bit);
+  glStencilFunc (GL_GREATER, subcomposite_stencil_bit, subcomposite_stencil_bit);
+}
+
+static void
+end_subcomposite (void)
+{
+  /* Flush out any existing geoemtry to be rendered */
+  hidgl_flush_instances (hidgl);
+  hidgl_flush_triangles (hidgl);
+
+  hidgl_return_stencil_bit (hidgl, subcomposite_stencil_bit);
+
+  glStencilMask (0);
+  glStencilFunc (GL_ALWAYS, 0, 0);
+  glDisable (GL_STENCIL_TEST);
+
+  subcomposite_stencil_bit = 0;
+}
+
+/* Compute group visibility based upon on copper layers only */
+static bool
+is_layer_group_visible (int group)
+{
+  int entry;
+  for (entry = 0; entry < PCB->LayerGroups.Number[group]; entry++)
+    {
+      int layer_idx = PCB->LayerGroups.Entries[group][entry];
+      if (layer_idx >= 0 && layer_idx < max_copper_layer &&
+          LAYER_PTR (layer_idx)->On)
+        return true;
+    }
+  return false;
+}
+
+/* Mirrors the layer choices of the GTK HID's GL renderer, so we draw
+ * what the user would see on screen.
+ */
+static int
+glbench_set_layer (const char *name, int group, int empty)
+{
+  bool group_visible = false;
+  bool subcomposite = true;
+
+  if (group >= 0 && group < max_group)
+    {
+      trans_lines = true;
+      group_visible = is_layer_group_visible (group);
+    }
+  else
+    {
+      switch (SL_TYPE (group))
+        {
+        case SL_INVISIBLE:
+          trans_lines = false;
+          subcomposite = false;
+          group_visible = PCB->InvisibleObjectsOn;
+          break;
+        case SL_MASK:
+          trans_lines = true;
+          subcomposite = false;
+          group_visible = TEST_FLAG (SHOWMASKFLAG, PCB);
+          break;
+        case SL_SILK:
+          trans_lines = true;
+          group_visible = PCB->ElementOn;
+          break;
+        case SL_PDRILL:
+        case SL_UDRILL:
+          trans_lines = true;
+          group_visible = true;
+          break;
+        case SL_RATS:
+          trans_lines = true;
+          subcomposite = false;
+          group_visible = PCB->RatOn;
+          break;
+        }
+    }
+
+  end_subcomposite ();
+
+  if (group_visible && subcomposite)
+    start_subcomposite ();
+
+  return group_visible;
+}
+
+static void
+glbench_end_layer (void)
+{
+  end_subcomposite ();
+}
+
+static hidGC
+glbench_make_gc (void)
+{
+  hidGC gc = (hidGC) calloc (1, sizeof (struct glbench_gc_struct));
+  glbenchGC bench_gc = (glbenchGC)gc;
+
+  gc->hid = &glbench_hid;
+  gc->hid_draw = &glbench_graphics;
+
+  hidgl_init_gc (hidgl, gc);
+
+  bench_gc->colorname = Settings.BackgroundColor;
+  bench_gc->cap = Trace_Cap;
+
+  return gc;
+}
+
+static void
+glbench_destroy_gc (hidGC gc)
+{
+  if (current_gc == gc)
+    current_gc = NULL;
+
+  hidgl_finish_gc (gc);
+  free (gc);
+}
+
+static void
+glbench_use_mask (enum mask_mode mode)
+{
+  static int stencil_bit = 0;
+
+  if (mode == cur_mask)
+    return;
+
+  /* Flush out any existing geoemtry to be rendered */
+  hidgl_flush_instances (hidgl);
+  hidgl_flush_triangles (hidgl);
+
+  switch (mode)
+    {
+    case HID_MASK_BEFORE:
+      /* We ask not to receive this mask type, so warn if we get it */
+      g_return_if_reached ();
+
+    case HID_MASK_CLEAR:
+      /* Write '1' to the stencil buffer where the solder-mask should not be drawn. */
+      glColorMask (0, 0, 0, 0);
+      glDepthMask (GL_FALSE);
+      glEnable (GL_STENCIL_TEST);
+      stencil_bit = hidgl_assign_clear_stencil_bit (hidgl);
+      glStencilFunc (GL_ALWAYS, stencil_bit, stencil_bit);
+      glStencilMask (stencil_bit);
+      glStencilOp (GL_KEEP, GL_KEEP, GL_REPLACE);
+      break;
+
+    case HID_MASK_AFTER:
+      /* Drawing operations as masked to areas where the stencil buffer is '0' */
+      glColorMask (1, 1, 1, 1);
+      glDepthMask (GL_TRUE);
+      glStencilFunc (GL_GEQUAL, 0, stencil_bit);
+      glStencilOp (GL_KEEP, GL_KEEP, GL_KEEP);
+      break;
+
+    case HID_MASK_OFF:
+      hidgl_return_stencil_bit (hidgl, stencil_bit);
+      glDisable (GL_STENCIL_TEST);
+      break;
+    }
+  cur_mask = mode;
+}
+
+/* Looks up the red, green and blue components of a "#rrggbb" colour */
+static void
+lookup_color (const char *colorname, GLfloat *rgb)
+{
+  static void *cache = NULL;
+  unsigned int r, g, b;
+  hidval cval;
+
+  if (hid_cache_color (0, colorname, &cval, &cache))
+    {
+      memcpy (rgb, cval.ptr, 3 * sizeof (GLfloat));
+      return;
+    }
+
+  if (colorname[0] != '#' ||
+      sscanf (colorname + 1, "%2x%2x%2x", &r, &g, &b) != 3)
+    r = g = b = 255;
+
+  cval.ptr = malloc (3 * sizeof (GLfloat));
+  ((GLfloat *)cval.ptr)[0] = r / 255.;
+  ((GLfloat *)cval.ptr)[1] = g / 255.;
+  ((GLfloat *)cval.ptr)[2] = b / 255.;
+  hid_cache_color (1, colorname, &cval, &cache);
+
+  memcpy (rgb, cval.ptr, 3 * sizeof (GLfloat));
+}
+
+/* Works out the GL colour to draw with, as the GTK HID's GL renderer does */
+static void
+set_gl_color_for_gc (hidGC gc)
+{
+  glbenchGC bench_gc = (glbenchGC)gc;
+  GLfloat rgb[3];
+  double a, maxi, mult;
+
+  if (current_colorname != NULL &&
+      strcmp (current_colorname, bench_gc->colorname) == 0)
+    return;
+
+  free (current_colorname);
+  current_colorname = strdup (bench_gc->colorname);
+
+  if (strcmp (bench_gc->colorname, "erase") == 0)
+    {
+      lookup_color (Settings.BackgroundColor, rgb);
+      a = 1.0;
+    }
+  else if (strcmp (bench_gc->colorname, "drill") == 0)
+    {
+      lookup_color (Settings.OffLimitColor, rgb);
+      a = 0.85;
+    }
+  else
+    {
+      lookup_color (bench_gc->colorname, rgb);
+      a = 0.7;
+    }
+
+  if (!trans_lines)
+    a = 1.0;
+  maxi = MAX (rgb[0], MAX (rgb[1], rgb[2]));
+  mult = MIN (1 / a, 1 / maxi);
+
+  hidgl_flush_triangles (hidgl);
+  hidgl_set_color (hidgl, rgb[0] * mult, rgb[1] * mult, rgb[2] * mult, a);
+}
+
+static void
+use_gc (hidGC gc)
+{
+  if (gc->hid != &glbench_hid)
+    {
+      fprintf (stderr, "Fatal: GC from another HID passed to glbench HID\n");
+      abort ();
+    }
+
+  if (current_gc == gc)
+    return;
+
+  current_gc = gc;
+  set_gl_color_for_gc (gc);
+}
+
+static void
+glbench_set_color (hidGC gc, const char *name)
+{
+  glbenchGC bench_gc = (glbenchGC)gc;
+
+  if (name == NULL)
+    name = "#ff0000";
+
+  bench_gc->colorname = name;
+  if (current_gc == gc)
+    set_gl_color_for_gc (gc);
+}
+
+static void
+glbench_set_line_cap (hidGC gc, EndCapStyle style)
+{
+  ((glbenchGC)gc)->cap = style;
+}
+
+static void
+glbench_set_line_width (hidGC gc, Coord width)
+{
+  ((glbenchGC)gc)->width = width;
+}
+
+static void
+glbench_set_draw_xor (hidGC gc, int xor_)
+{
+}
+
+static void
+glbench_draw_line (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
+{
+  glbenchGC bench_gc = (glbenchGC)gc;
+
+  use_gc (gc);
+  hidgl_draw_line (gc, bench_gc->cap, bench_gc->width, x1, y1, x2, y2, coord_per_px);
+}
+
+static void
+glbench_draw_arc (hidGC gc, Coord cx, Coord cy, Coord xradius, Coord yradius,
+                  Angle start_angle, Angle delta_angle)
+{
+  glbenchGC bench_gc = (glbenchGC)gc;
+
+  use_gc (gc);
+  hidgl_draw_arc (gc, bench_gc->width, cx, cy, xradius, yradius,
+                  start_angle, delta_angle, coord_per_px);
+}
+
+static void
+glbench_draw_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
+{
+  use_gc (gc);
+  hidgl_draw_rect (gc, x1, y1, x2, y2);
+}
+
+static void
+glbench_fill_circle (hidGC gc, Coord cx, Coord cy, Coord radius)
+{
+  use_gc (gc);
+  hidgl_fill_circle (gc, cx, cy, radius);
+}
+
+static void
+glbench_fill_polygon (hidGC gc, int n_coords, Coord *x, Coord *y)
+{
+  use_gc (gc);
+  hidgl_fill_polygon (gc, n_coords, x, y);
+}
+
+static void
+glbench_fill_pcb_polygon (hidGC gc, PolygonType *poly, const BoxType *clip_box)
+{
+  use_gc (gc);
+  hidgl_fill_pcb_polygon (gc, poly, clip_box);
+}
+
+static void
+glbench_fill_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
+{
+  use_gc (gc);
+  hidgl_fill_rect (gc, x1, y1, x2, y2);
+}
+
+static void
+glbench_calibrate (double xval, double yval)
+{
+}
+
+static void
+glbench_set_crosshair (int x, int y, int action)
+{
+}
+
+/* Reads a script of views from filename. Returns NULL on error. */
+static bench_view *
+load_script (const char *filename, int *n_views)
+{
+  FILE *f;
+  char line[256];
+  bench_view *views = NULL;
+  int n = 0, lineno = 0;
+
+  f = fopen (filename, "r");
+  if (f == NULL)
+    {
+      perror (filename);
+      return NULL;
+    }
+
+  while (fgets (line, sizeof (line), f) != NULL)
+    {
+      char *p = line;
+
+      lineno++;
+      while (*p == ' ' || *p == '\t')
+        p++;
+      if (*p == '#' || *p == '\n' || *p == '\0')
+        continue;
+
+      views = (bench_view *) realloc (views, (n + 1) * sizeof (bench_view));
+      if (sscanf (p, "%lf %lf %lf",
+                  &views[n].zoom, &views[n].x, &views[n].y) != 3 ||
+          views[n].zoom <= 0.)
+        {
+          fprintf (stderr, "%s:%d: Expected a zoom and the x and y of the view\n",
+                   filename, lineno);
+          free (views);
+          fclose (f);
+          return NULL;
+        }
+      n++;
+    }
+  fclose (f);
+
+  if (n == 0)
+    {
+      fprintf (stderr, "%s: No views in script\n", filename);
+      return NULL;
+    }
+
+  *n_views = n;
+  return views;
+}
+
+/* Works out the board region shown in a view, keeping the aspect ratio
+ * of the output.
+ */
+static void
+view_region (const bench_view *view, BoxType *region)
+{
+  double aspect = (double)width / (double)height;
+  double view_width, view_height;
+  double cx, cy;
+
+  view_width = MAX (PCB->MaxWidth, PCB->MaxHeight * aspect) / view->zoom;
+  view_height = view_width / aspect;
+  cx = PCB->MaxWidth * view->x;
+  cy = PCB->MaxHeight * view->y;
+
+  region->X1 = cx - view_width / 2;
+  region->X2 = cx + view_width / 2;
+  region->Y1 = cy - view_height / 2;
+  region->Y2 = cy + view_height / 2;
+}
+
+/* Renders one view, returning how long it took in milliseconds */
+static double
+render_view (const bench_view *view, GTimer *timer)
+{
+  GLfloat bg[3];
+  BoxType region;
+
+  view_region (view, &region);
+  coord_per_px = (double)(region.X2 - region.X1) / (double)width;
+
+  g_timer_start (timer);
+
+  hidgl_start_render (hidgl);
+
+  glViewport (0, 0, width, height);
+  glMatrixMode (GL_PROJECTION);
+  glLoadIdentity ();
+  glOrtho (region.X1, region.X2, region.Y2, region.Y1, -1., 1.);
+  glMatrixMode (GL_MODELVIEW);
+  glLoadIdentity ();
+
+  glEnable (GL_BLEND);
+  glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glEnable (GL_DEPTH_TEST);
+  glDepthFunc (GL_ALWAYS);
+
+  lookup_color (Settings.OffLimitColor, bg);
+  glClearColor (bg[0], bg[1], bg[2], 1.);
+  glStencilMask (~0);
+  glClearStencil (0);
+  glClear (GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  hidgl_reset_stencil_usage (hidgl);
+
+  /* Disable the stencil test until we need it - otherwise it gets dirty */
+  glDisable (GL_STENCIL_TEST);
+  glStencilMask (0);
+  glStencilFunc (GL_ALWAYS, 0, 0);
+
+  /* The colour last set may not have survived the previous frame */
+  free (current_colorname);
+  current_colorname = NULL;
+  current_gc = NULL;
+
+  hid_expose_callback (&glbench_graphics, &region, 0);
+
+  hidgl_finish_render (hidgl);
+  glFinish ();
+
+  return 1000. * g_timer_elapsed (timer, NULL);
+}
+
+static int
+compare_times (const void *va, const void *vb)
+{
+  double a = *(const double *) va;
+  double b = *(const double *) vb;
+
+  return (a > b) - (a < b);
+}
+
+/* Nearest rank percentile of n sorted samples */
+static double
+percentile (double *sorted, int n, double p)
+{
+  int rank = (int) ceil (p / 100. * n);
+
+  return sorted[MAX (rank, 1) - 1];
+}
+
+static void
+glbench_do_export (HID_Attr_Val * options)
+{
+  OSMesaContext ctx;
+  GLubyte *buffer;
+  GTimer *timer;
+  bench_view *script = default_script;
+  int n_views = sizeof (default_script) / sizeof (default_script[0]);
+  int repeat;
+  int n_frames, frame, i;
+  double *times;
+  double total = 0.;
+  hidgl_stats stats;
+
+  if (!options)
+    {
+      glbench_get_export_options (0);
+      for (i = 0; i < NUM_OPTIONS; i++)
+        glbench_values[i] = glbench_attribute_list[i].default_val;
+      options = glbench_values;
+    }
+
+  width = options[HA_width].int_value;
+  height = options[HA_height].int_value;
+  repeat = options[HA_repeat].int_value;
+
+  if (options[HA_script].str_value != NULL)
+    {
+      script = load_script (options[HA_script].str_value, &n_views);
+      if (script == NULL)
+        return;
+    }
+
+  buffer = (GLubyte *) malloc (width * height * 4);
+  ctx = OSMesaCreateContextExt (OSMESA_RGBA, 24, 8, 0, NULL);
+  if (ctx == NULL || !OSMesaMakeCurrent (ctx, buffer, GL_UNSIGNED_BYTE, width, height))
+    {
+      fprintf (stderr, "Error:  Could not create an offscreen GL context\n");
+      if (ctx != NULL)
+        OSMesaDestroyContext (ctx);
+      free (buffer);
+      if (script != default_script)
+        free (script);
+      return;
+    }
+
+  hidgl_init ();
+  hidgl = hidgl_new_instance ();
+  timer = g_timer_new ();
+
+  /* Polygons need the stencil buffer to mask their holes */
+  glGetIntegerv (GL_STENCIL_BITS, &i);
+  if (i == 0)
+    glbench_graphics_class.fill_pcb_polygon = common_fill_pcb_polygon;
+
+  /* The first frame compiles shaders and warms caches, so isn't counted */
+  render_view (&script[0], timer);
+  hidgl_reset_stats (hidgl);
+
+  n_frames = n_views * repeat;
+  times = (double *) malloc (n_frames * sizeof (double));
+  for (frame = 0; frame < n_frames; frame++)
+    {
+      times[frame] = render_view (&script[frame % n_views], timer);
+      total += times[frame];
+    }
+
+  hidgl_get_stats (hidgl, &stats);
+  qsort (times, n_frames, sizeof (double), compare_times);
+
+  printf ("glbench: %s, %dx%d, %d views x %d\n",
+          PCB->Filename ? PCB->Filename : "<unnamed>",
+          width, height, n_views, repeat);
+  printf ("glbench: frame ms mean %.3f p50 %.3f p90 %.3f p99 %.3f max %.3f\n",
+          total / n_frames,
+          percentile (times, n_frames, 50.),
+          percentile (times, n_frames, 90.),
+          percentile (times, n_frames, 99.),
+          times[n_frames - 1]);
+  printf ("glbench: per frame %lu draw calls, %lu vertices, %lu instances\n",
+          stats.draw_calls / n_frames,
+          stats.vertices / n_frames,
+          stats.instances / n_frames);
+
+  free (times);
+  g_timer_destroy (timer);
+  hidgl_free_instance (hidgl);
+  hidgl = NULL;
+  free (current_colorname);
+  current_colorname = NULL;
+  OSMesaDestroyContext (ctx);
+  free (buffer);
+  if (script != default_script)
+    free (script);
+}
+
+#include "dolists.h"
+
+void
+hid_glbench_init ()
+{
+  memset (&glbench_hid, 0, sizeof (HID));
+  memset (&glbench_graphics, 0, sizeof (HID_DRAW));
+  memset (&glbench_graphics_class, 0, sizeof (HID_DRAW_CLASS));
+
+  common_nogui_init (&glbench_hid);
+
+  glbench_hid.struct_size = sizeof (HID);
+  glbench_hid.name        = "glbench";
+  glbench_hid.description = "Offscreen GL redraw benchmark";
+  glbench_hid.exporter    = 1;
+
+  glbench_hid.get_export_options  = glbench_get_export_options;
+  glbench_hid.do_export           = glbench_do_export;
+  glbench_hid.parse_arguments     = glbench_parse_arguments;
+  glbench_hid.calibrate           = glbench_calibrate;
+  glbench_hid.set_crosshair       = glbench_set_crosshair;
+
+  common_nogui_graphics_class_init (&glbench_graphics_class);
+  common_draw_helpers_class_init (&glbench_graphics_class);
+
+  glbench_graphics_class.set_layer        = glbench_set_layer;
+  glbench_graphics_class.end_layer        = glbench_end_layer;
+  glbench_graphics_class.make_gc          = glbench_make_gc;
+  glbench_graphics_class.destroy_gc       = glbench_destroy_gc;
+  glbench_graphics_class.use_mask         = glbench_use_mask;
+  glbench_graphics_class.set_color        = glbench_set_color;
+  glbench_graphics_class.set_line_cap     = glbench_set_line_cap;
+  glbench_graphics_class.set_line_width   = glbench_set_line_width;
+  glbench_graphics_class.set_draw_xor     = glbench_set_draw_xor;
+  glbench_graphics_class.draw_line        = glbench_draw_line;
+  glbench_graphics_class.draw_arc         = glbench_draw_arc;
+  glbench_graphics_class.draw_rect        = glbench_draw_rect;
+  glbench_graphics_class.fill_circle      = glbench_fill_circle;
+  glbench_graphics_class.fill_polygon     = glbench_fill_polygon;
+  glbench_graphics_class.fill_pcb_polygon = glbench_fill_pcb_polygon;
+  glbench_graphics_class.fill_rect        = glbench_fill_rect;
+
+  /* Draw as the screen would, not as an export */
+  glbench_graphics_class.gui = true;
+
+  glbench_graphics.klass = &glbench_graphics_class;
+  glbench_graphics.poly_after = true;
+  common_nogui_graphics_init (&glbench_graphics);
+  common_draw_helpers_init (&glbench_graphics);
+
+  hid_register_hid (&glbench_hid);
+
+#include "glbench_lists.h"
+}
@@ -3,6 +3,7 @@
 #endif
 
 #include <stdio.h>
+#include <math.h>
 
 #include "crosshair.h"
 #include "clip.h"
@@ -24,6 +25,30 @@ extern HID_DRAW ghid_graphics;
 static enum mask_mode cur_mask = HID_MASK_OFF;
 static int mask_seq = 0;
 
+/* The board is rendered into a cache of TILE_SIZE x TILE_SIZE pixmaps,
+ * aligned to a grid in screen space at each zoom level, which are copied
+ * into the backing pixmap to compose the view. Panning, or returning to a
+ * previous zoom level, then only needs to render tiles not yet cached.
+ * Overlays such as the attached objects are drawn over the composed view,
+ * and never enter the cache.
+ */
+#define TILE_SIZE 256
+#define MAX_CACHED_TILES 128
+
+typedef struct render_tile {
+  GdkPixmap *pixmap;
+
+  /* Position of the tile in the grid, and the view it was rendered for */
+  int tx, ty;
+  double coord_per_px;
+  bool flip_x;
+  bool flip_y;
+
+  BoxType area;            /* Region of the board the tile covers */
+  bool dirty;
+  unsigned int last_used;  /* Frame the tile was last composed in */
+} render_tile;
+
 typedef struct render_priv {
   GdkGC *bg_gc;
   GdkGC *offlimits_gc;
@@ -35,6 +60,12 @@ typedef struct render_priv {
   int attached_invalidate_depth;
   int mark_invalidate_depth;
 
+  /* Tile cache */
+  render_tile tiles[MAX_CACHED_TILES];
+  int n_tiles;
+  unsigned int frame;
+  GdkPixmap *tile_mask;
+
   /* Feature for leading the user to a particular location */
   guint lead_user_timeout;
   GTimer *lead_user_timer;
@@ -715,29 +746,12 @@ ghid_fill_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
 		      x1, y1, x2 - x1 + 1, y2 - y1 + 1);
 }
 
+/* Draws the board within priv->clip_rect of the current drawable */
 static void
-redraw_region (GdkRectangle *rect)
+draw_board (render_priv *priv)
 {
   int eleft, eright, etop, ebottom;
   BoxType region;
-  render_priv *priv = gport->render_priv;
-
-  if (!gport->pixmap)
-    return;
-
-  if (rect != NULL)
-    {
-      priv->clip_rect = *rect;
-      priv->clip = true;
-    }
-  else
-    {
-      priv->clip_rect.x = 0;
-      priv->clip_rect.y = 0;
-      priv->clip_rect.width = gport->width;
-      priv->clip_rect.height = gport->height;
-      priv->clip = false;
-    }
 
   set_clip (priv, priv->bg_gc);
   set_clip (priv, priv->offlimits_gc);
@@ -804,6 +818,220 @@ redraw_region (GdkRectangle *rect)
 
   hid_expose_callback (&ghid_graphics, &region, 0);
   ghid_draw_grid ();
+}
+
+static void
+flush_tiles (render_priv *priv)
+{
+  int i;
+
+  for (i = 0; i < priv->n_tiles; i++)
+    g_object_unref (priv->tiles[i].pixmap);
+
+  priv->n_tiles = 0;
+}
+
+/* Marks any cached tiles, at any zoom level, covering the region as stale */
+static void
+invalidate_tiles (render_priv *priv, Coord left, Coord right, Coord top, Coord bottom)
+{
+  int i;
+
+  for (i = 0; i < priv->n_tiles; i++)
+    {
+      render_tile *tile = &priv->tiles[i];
+
+      if (tile->area.X1 <= right && tile->area.X2 >= left &&
+          tile->area.Y1 <= bottom && tile->area.Y2 >= top)
+        tile->dirty = true;
+    }
+}
+
+/* The view offset of a tile's top left corner */
+static Coord
+tile_origin (int t)
+{
+  return (Coord) (t * TILE_SIZE * gport->view.coord_per_px);
+}
+
+/* Finds the tile at the given grid position for the current zoom level,
+ * recycling the least recently used one if it isn't already cached.
+ * Returns NULL if every cached tile is already part of this frame.
+ */
+static render_tile *
+lookup_tile (render_priv *priv, int tx, int ty)
+{
+  render_tile *tile = NULL;
+  Coord x1, x2, y1, y2;
+  int i;
+
+  for (i = 0; i < priv->n_tiles; i++)
+    {
+      tile = &priv->tiles[i];
+      if (tile->tx == tx && tile->ty == ty &&
+          tile->coord_per_px == gport->view.coord_per_px &&
+          tile->flip_x == gport->view.flip_x &&
+          tile->flip_y == gport->view.flip_y)
+        return tile;
+    }
+
+  if (priv->n_tiles < MAX_CACHED_TILES)
+    {
+      tile = &priv->tiles[priv->n_tiles++];
+      tile->pixmap = gdk_pixmap_new (gport->pixmap, TILE_SIZE, TILE_SIZE, -1);
+    }
+  else
+    {
+      tile = NULL;
+      for (i = 0; i < priv->n_tiles; i++)
+        if (priv->tiles[i].last_used != priv->frame &&
+            (tile == NULL || priv->tiles[i].last_used < tile->last_used))
+          tile = &priv->tiles[i];
+
+      if (tile == NULL)
+        return NULL;
+    }
+
+  tile->tx = tx;
+  tile->ty = ty;
+  tile->coord_per_px = gport->view.coord_per_px;
+  tile->flip_x = gport->view.flip_x;
+  tile->flip_y = gport->view.flip_y;
+  tile->dirty = true;
+
+  /* Allow a pixel either side for rounding to screen coordinates */
+  x1 = tile_origin (tx) - gport->view.coord_per_px;
+  x2 = tile_origin (tx + 1) + gport->view.coord_per_px;
+  y1 = tile_origin (ty) - gport->view.coord_per_px;
+  y2 = tile_origin (ty + 1) + gport->view.coord_per_px;
+  tile->area.X1 = gport->view.flip_x ? PCB->MaxWidth - x2 : x1;
+  tile->area.X2 = gport->view.flip_x ? PCB->MaxWidth - x1 : x2;
+  tile->area.Y1 = gport->view.flip_y ? PCB->MaxHeight - y2 : y1;
+  tile->area.Y2 = gport->view.flip_y ? PCB->MaxHeight - y1 : y2;
+
+  return tile;
+}
+
+/* Renders the board into a tile, by temporarily pointing the drawing
+ * routines at it instead of the backing pixmap.
+ */
+static void
+render_tile_contents (render_priv *priv, render_tile *tile)
+{
+  GdkPixmap *save_pixmap = gport->pixmap;
+  GdkPixmap *save_mask = gport->mask;
+  GdkDrawable *save_drawable = gport->drawable;
+  view_data save_view = gport->view;
+  int save_width = gport->width;
+  int save_height = gport->height;
+
+  if (priv->tile_mask == NULL)
+    priv->tile_mask = gdk_pixmap_new (0, TILE_SIZE, TILE_SIZE, 1);
+
+  gport->pixmap = tile->pixmap;
+  gport->drawable = tile->pixmap;
+  gport->mask = priv->tile_mask;
+  gport->width = TILE_SIZE;
+  gport->height = TILE_SIZE;
+  gport->view.x0 = tile_origin (tile->tx);
+  gport->view.y0 = tile_origin (tile->ty);
+  gport->view.width = TILE_SIZE * gport->view.coord_per_px;
+  gport->view.height = TILE_SIZE * gport->view.coord_per_px;
+
+  priv->clip_rect.x = 0;
+  priv->clip_rect.y = 0;
+  priv->clip_rect.width = TILE_SIZE;
+  priv->clip_rect.height = TILE_SIZE;
+  priv->clip = false;
+
+  draw_board (priv);
+
+  gport->pixmap = save_pixmap;
+  gport->mask = save_mask;
+  gport->drawable = save_drawable;
+  gport->view = save_view;
+  gport->width = save_width;
+  gport->height = save_height;
+
+  tile->dirty = false;
+}
+
+/* Composes the area of the backing pixmap within rect from cached tiles,
+ * rendering any which are missing or stale.
+ */
+static void
+compose_tiles (render_priv *priv, GdkRectangle *rect)
+{
+  double tile_coords = TILE_SIZE * gport->view.coord_per_px;
+  int tx1, tx2, ty1, ty2;
+  int tx, ty;
+
+  priv->frame++;
+
+  tx1 = floor ((gport->view.x0 + rect->x * gport->view.coord_per_px) / tile_coords);
+  ty1 = floor ((gport->view.y0 + rect->y * gport->view.coord_per_px) / tile_coords);
+  tx2 = floor ((gport->view.x0 + (rect->x + rect->width) * gport->view.coord_per_px) / tile_coords);
+  ty2 = floor ((gport->view.y0 + (rect->y + rect->height) * gport->view.coord_per_px) / tile_coords);
+
+  for (ty = ty1; ty <= ty2; ty++)
+    for (tx = tx1; tx <= tx2; tx++)
+      {
+        render_tile *tile = lookup_tile (priv, tx, ty);
+        GdkRectangle dest, area;
+
+        dest.x = floor ((tile_origin (tx) - gport->view.x0) / gport->view.coord_per_px + 0.5);
+        dest.y = floor ((tile_origin (ty) - gport->view.y0) / gport->view.coord_per_px + 0.5);
+        dest.width = TILE_SIZE;
+        dest.height = TILE_SIZE;
+
+        if (!gdk_rectangle_intersect (&dest, rect, &area))
+          continue;
+
+        /* Out of tiles, so draw this part of the view directly */
+        if (tile == NULL)
+          {
+            priv->clip_rect = area;
+            priv->clip = true;
+            draw_board (priv);
+            continue;
+          }
+
+        if (tile->dirty)
+          render_tile_contents (priv, tile);
+
+        tile->last_used = priv->frame;
+
+        gdk_gc_set_clip_mask (priv->bg_gc, NULL);
+        gdk_draw_drawable (gport->pixmap, priv->bg_gc, tile->pixmap,
+                           area.x - dest.x, area.y - dest.y, area.x, area.y,
+                           area.width, area.height);
+      }
+}
+
+static void
+redraw_region (GdkRectangle *rect)
+{
+  GdkRectangle view_rect;
+  render_priv *priv = gport->render_priv;
+
+  if (!gport->pixmap)
+    return;
+
+  view_rect.x = 0;
+  view_rect.y = 0;
+  view_rect.width = gport->width;
+  view_rect.height = gport->height;
+
+  if (rect != NULL && !gdk_rectangle_intersect (rect, &view_rect, &view_rect))
+    return;
+
+  compose_tiles (priv, &view_rect);
+
+  priv->clip_rect = view_rect;
+  priv->clip = (rect != NULL);
+
+  set_clip (priv, priv->bg_gc);
+  set_clip (priv, priv->mask_gc);
 
   /* In some cases we are called with the crosshair still off */
   if (priv->attached_invalidate_depth == 0)
@@ -827,6 +1055,9 @@ ghid_invalidate_lr (int left, int right, int top, int bottom)
   int dleft, dright, dtop, dbottom;
   int minx, maxx, miny, maxy;
   GdkRectangle rect;
+  render_priv *priv = gport->render_priv;
+
+  invalidate_tiles (priv, left, right, top, bottom);
 
   dleft = Vx (left);
   dright = Vx (right);
@@ -847,7 +1078,10 @@ ghid_invalidate_lr (int left, int right, int top, int bottom)
   ghid_screen_update ();
 }
 
-
+/* Repaints the view from the tile cache. Panning and zooming can reuse
+ * the cached tiles, so whatever changes what is drawn, or how, flushes
+ * them through ghid_invalidate_caches () first.
+ */
 void
 ghid_invalidate_all ()
 {
@@ -855,6 +1089,22 @@ ghid_invalidate_all ()
   ghid_screen_update ();
 }
 
+/* Called by the core when the whole board may have changed, unlike
+ * ghid_invalidate_all (), which the GUI uses to simply repaint the view.
+ */
+static void
+ghid_invalidate_everything (void)
+{
+  ghid_invalidate_caches ();
+  ghid_invalidate_all ();
+}
+
+void
+ghid_invalidate_caches (void)
+{
+  flush_tiles (gport->render_priv);
+}
+
 void
 ghid_notify_crosshair_change (bool changes_complete)
 {
@@ -1056,6 +1306,8 @@ ghid_init_renderer (int *argc, char ***argv, GHidPort *port)
   /* Init any GC's required */
   port->render_priv = g_new0 (render_priv, 1);
   port->render_priv->crosshair_gc = hid_draw_make_gc (&ghid_graphics);
+
+  ghid_hid.invalidate_all = ghid_invalidate_everything;
 }
 
 void
@@ -1065,6 +1317,9 @@ ghid_shutdown_renderer (GHidPort *port)
 
   hid_draw_destroy_gc (priv->crosshair_gc);
   ghid_cancel_lead_user ();
+  flush_tiles (priv);
+  if (priv->tile_mask != NULL)
+    g_object_unref (priv->tile_mask);
   g_free (port->render_priv);
   port->render_priv = NULL;
 }
@@ -1356,7 +1611,7 @@ lead_user_cb (gpointer data)
   double elapsed_time;
 
   /* Queue a redraw */
-  ghid_invalidate_all ();
+  repaint_view ();
 
   /* Update radius */
   elapsed_time = g_timer_elapsed (priv->lead_user_timer, NULL);
@@ -1398,7 +1653,7 @@ ghid_cancel_lead_user (void)
     g_timer_destroy (priv->lead_user_timer);
 
   if (priv->lead_user)
-    ghid_invalidate_all ();
+    repaint_view ();
 
   priv->lead_user_timeout = 0;
   priv->lead_user_timer = NULL;
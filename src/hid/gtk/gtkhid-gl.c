@@ -73,6 +73,100 @@ static GLfloat last_projection_matrix[4][4] = {{1.0, 0.0, 0.0, 0.0},
                                                {0.0, 0.0, 0.0, 1.0}};
 static int global_view_2d = 1;
 
+/* Lines, arcs and text on each copper layer are recorded into retained
+ * geometry, split into a RETAINED_TILES x RETAINED_TILES grid over the
+ * board so that an edit only needs the tiles it touches re-recorded.
+ * Each tile has one chunk for its lines and arcs, which are recorded on
+ * worker threads, and another for its text, which is recorded through
+ * the HID drawing API, on the GL thread. Only the tiles in view are
+ * recorded and drawn, so zooming in on part of a large board doesn't
+ * re-record the rest of it.
+ */
+#define RETAINED_TILES 8
+#define RETAINED_CHUNKS (RETAINED_TILES * RETAINED_TILES)
+#define TEXT_CHUNK(tile) (RETAINED_CHUNKS + (tile))
+
+/* Upper limit on threads used to record retained geometry */
+#define MAX_RETAINED_WORKERS 16
+
+/* Level of detail: objects whose bounding box is smaller than LOD_PIXELS
+ * on screen are drawn as a filled box rather than in full. Text shorter
+ * than LOD_TEXT_PIXELS is likewise drawn as a filled box, and pin and pad
+ * names that small are not drawn at all.
+ */
+#define LOD_PIXELS       2.
+#define LOD_TEXT_PIXELS  4.
+
+/* Statistics gathered whilst drawing a frame, shown by the DrawStats
+ * action. Times are of the CPU work drawing, and don't include the GPU
+ * catching up, except as it holds up the buffer swap.
+ */
+typedef struct frame_stats {
+  double frame_ms;
+  double record_ms;                 /* Recording retained geometry */
+  double swap_ms;
+  double group_ms[MAX_LAYER];
+  bool group_drawn[MAX_LAYER];
+  unsigned long rtree_nodes;
+  bool scene_cached;                /* Only the overlay was drawn */
+  int tiles_pending;                /* Still being recorded in the background */
+  hidgl_stats gl;
+} frame_stats;
+
+#define STATS_MAX_LINES    (MAX_LAYER + 12)
+#define STATS_LINE_LENGTH  80
+
+typedef struct layer_geometry {
+  hidgl_retained *geometry;
+
+  /* State the recorded geometry depends upon */
+  PCBType *pcb;
+  Coord max_width;
+  Coord max_height;
+  double scale;
+  float depth;
+  bool thin;
+
+  /* Set for tiles whose recorded geometry is wrong, rather than only out
+   * of date, so must be re-recorded before they are next drawn.
+   */
+  bool wrong[RETAINED_CHUNKS];
+
+  /* Tiles being recorded in the background */
+  bool recording[RETAINED_CHUNKS];
+
+  /* Extent of the objects recorded into each tile, which may reach beyond
+   * the tile itself. It doesn't depend on the scale, so is kept until the
+   * tile is invalidated by a change to the board.
+   */
+  BoxType bounds[RETAINED_CHUNKS];
+  bool bounds_valid[RETAINED_CHUNKS];
+} layer_geometry;
+
+/* Holes drawn as drill channels in the 3D view, grouped by their colour */
+enum hole_color {
+  HOLE_DRILL,
+  HOLE_WARN,
+  HOLE_PIN_SELECTED,
+  HOLE_VIA_SELECTED,
+  HOLE_CONNECTED,
+  HOLE_FOUND,
+  N_HOLE_COLORS
+};
+
+typedef struct {
+  Coord x;
+  Coord y;
+  Coord radius;
+  bool is_via;
+} cached_hole;
+
+typedef struct {
+  cached_hole *holes;
+  int count;
+  int space;
+} hole_list;
+
 typedef struct render_priv {
   GdkGLConfig *glconfig;
   bool trans_lines;
@@ -94,6 +188,38 @@ typedef struct render_priv {
   GList *active_gc_list;
   double edit_depth;
 
+  layer_geometry layer_geometry[MAX_LAYER];
+  hidgl_instance *recorders[MAX_RETAINED_WORKERS];
+
+  /* Background recording of retained geometry, see record_retained_layers () */
+  GThreadPool *record_pool;
+  GAsyncQueue *idle_recorders;
+  GAsyncQueue *finished_jobs;
+  int jobs_in_flight;
+  gint redraw_queued;
+
+  /* Drawing statistics, and the on-screen display of them */
+  GTimer *frame_timer;
+  frame_stats stats;
+  bool show_stats;
+  GLuint stats_font_base;
+
+  /* The last scene drawn, everything but the overlay, and the view it
+   * was drawn with. Whilst only the overlay changes, we redraw from this.
+   */
+  GLuint scene_texture;
+  bool scene_valid;
+  int scene_width;
+  int scene_height;
+  GLfloat scene_modelview[4][4];
+  GLfloat scene_projection[4][4];
+
+  /* Every pin and via hole, gathered when first needed after the board
+   * changes, rather than searched for every frame and pair of groups.
+   */
+  hole_list holes[N_HOLE_COLORS];
+  bool holes_valid;
+
 } render_priv;
 
 typedef struct gtk_gc_struct
@@ -108,6 +234,7 @@ typedef struct gtk_gc_struct
 
 static void draw_lead_user (hidGC gc, render_priv *priv);
 static bool ghid_unproject_to_z_plane (int ex, int ey, Coord pcb_z, Coord *pcb_x, Coord *pcb_y);
+static void stop_retained_workers (render_priv *priv);
 
 
 #define BOARD_THICKNESS         MM_TO_COORD(1.60)
@@ -193,6 +320,7 @@ start_subcomposite (hidgl_instance *hidgl)
   int stencil_bit;
 
   /* Flush out any existing geoemtry to be rendered */
+  hidgl_flush_instances (hidgl);
   hidgl_flush_triangles (hidgl);
 
   glEnable (GL_STENCIL_TEST);                                 /* Enable Stencil test */
@@ -211,6 +339,7 @@ end_subcomposite (hidgl_instance *hidgl)
   render_priv *priv = gport->render_priv;
 
   /* Flush out any existing geoemtry to be rendered */
+  hidgl_flush_instances (hidgl);
   hidgl_flush_triangles (hidgl);
 
   hidgl_return_stencil_bit (hidgl, priv->subcomposite_stencil_bit);  /* Relinquish any bitplane we previously used */
@@ -498,6 +627,7 @@ ghid_use_mask (enum mask_mode mode)
     return;
 
   /* Flush out any existing geoemtry to be rendered */
+  hidgl_flush_instances (hidgl);
   hidgl_flush_triangles (hidgl);
 
   switch (mode)
@@ -578,44 +708,26 @@ typedef struct
   double blue;
 } ColorCache;
 
+/* Works out the GL colour to draw with for the named colour */
 static void
-set_gl_color_for_gc (hidGC gc)
+compute_gl_color (const char *colorname, double alpha_mult, bool trans_lines,
+                  GLfloat *rgba)
 {
-  gtkGC gtk_gc = (gtkGC)gc;
-  render_priv *priv = gport->render_priv;
   static void *cache = NULL;
   hidval cval;
   ColorCache *cc;
   double r, g, b, a;
 
-  if (priv->current_colorname != NULL &&
-      strcmp (priv->current_colorname, gtk_gc->colorname) == 0 &&
-      priv->current_alpha_mult == gtk_gc->alpha_mult)
-    return;
-
-  free (priv->current_colorname);
-  priv->current_colorname = NULL;
-
-  /* If we can't set the GL colour right now, quit with
-   * current_colorname set to NULL, so we don't NOOP the
-   * next set_gl_color_for_gc call.
-   */
-  if (!priv->in_context)
-    return;
-
-  priv->current_colorname = strdup (gtk_gc->colorname);
-  priv->current_alpha_mult = gtk_gc->alpha_mult;
-
   if (gport->colormap == NULL)
     gport->colormap = gtk_widget_get_colormap (gport->top_window);
-  if (strcmp (gtk_gc->colorname, "erase") == 0)
+  if (strcmp (colorname, "erase") == 0)
     {
       r = gport->bg_color.red   / 65535.;
       g = gport->bg_color.green / 65535.;
       b = gport->bg_color.blue  / 65535.;
       a = 1.0;
     }
-  else if (strcmp (gtk_gc->colorname, "drill") == 0)
+  else if (strcmp (colorname, "drill") == 0)
     {
       r = gport->offlimits_color.red   / 65535.;
       g = gport->offlimits_color.green / 65535.;
@@ -624,19 +736,19 @@ set_gl_color_for_gc (hidGC gc)
     }
   else
     {
-      if (hid_cache_color (0, gtk_gc->colorname, &cval, &cache))
+      if (hid_cache_color (0, colorname, &cval, &cache))
         cc = (ColorCache *) cval.ptr;
       else
         {
           cc = (ColorCache *) malloc (sizeof (ColorCache));
           memset (cc, 0, sizeof (*cc));
           cval.ptr = cc;
-          hid_cache_color (1, gtk_gc->colorname, &cval, &cache);
+          hid_cache_color (1, colorname, &cval, &cache);
         }
 
       if (!cc->color_set)
         {
-          if (gdk_color_parse (gtk_gc->colorname, &cc->color))
+          if (gdk_color_parse (colorname, &cc->color))
             gdk_color_alloc (gport->colormap, &cc->color);
           else
             gdk_color_white (gport->colormap, &cc->color);
@@ -652,8 +764,8 @@ set_gl_color_for_gc (hidGC gc)
     }
   if (1) {
     double maxi, mult;
-    a *= gtk_gc->alpha_mult;
-    if (!priv->trans_lines)
+    a *= alpha_mult;
+    if (!trans_lines)
       a = 1.0;
     maxi = r;
     if (g > maxi) maxi = g;
@@ -666,8 +778,41 @@ set_gl_color_for_gc (hidGC gc)
 #endif
   }
 
+  rgba[0] = r;
+  rgba[1] = g;
+  rgba[2] = b;
+  rgba[3] = a;
+}
+
+static void
+set_gl_color_for_gc (hidGC gc)
+{
+  gtkGC gtk_gc = (gtkGC)gc;
+  render_priv *priv = gport->render_priv;
+  GLfloat rgba[4];
+
+  if (priv->current_colorname != NULL &&
+      strcmp (priv->current_colorname, gtk_gc->colorname) == 0 &&
+      priv->current_alpha_mult == gtk_gc->alpha_mult)
+    return;
+
+  free (priv->current_colorname);
+  priv->current_colorname = NULL;
+
+  /* If we can't set the GL colour right now, quit with
+   * current_colorname set to NULL, so we don't NOOP the
+   * next set_gl_color_for_gc call.
+   */
+  if (!priv->in_context)
+    return;
+
+  priv->current_colorname = strdup (gtk_gc->colorname);
+  priv->current_alpha_mult = gtk_gc->alpha_mult;
+
+  compute_gl_color (gtk_gc->colorname, gtk_gc->alpha_mult, priv->trans_lines, rgba);
+
   hidgl_flush_triangles (gtk_gc->hidgl_gc.hidgl);
-  glColor4d (r, g, b, a);
+  hidgl_set_color (gtk_gc->hidgl_gc.hidgl, rgba[0], rgba[1], rgba[2], rgba[3]);
 }
 
 void
@@ -824,15 +969,104 @@ ghid_fill_rect (hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
   hidgl_fill_rect (gc, x1, y1, x2, y2);
 }
 
+static int
+tile_coord (Coord c, Coord extent)
+{
+  Coord tile_size = MAX (extent / RETAINED_TILES, 1);
+
+  return CLAMP (c / tile_size, 0, RETAINED_TILES - 1);
+}
+
+static int
+tile_index (const BoxType *box)
+{
+  int tx = tile_coord ((box->X1 + box->X2) / 2, PCB->MaxWidth);
+  int ty = tile_coord ((box->Y1 + box->Y2) / 2, PCB->MaxHeight);
+
+  return ty * RETAINED_TILES + tx;
+}
+
+/* Marks any retained geometry in the given region of the board as stale */
+static void
+invalidate_retained_area (Coord left, Coord right, Coord top, Coord bottom)
+{
+  render_priv *priv = gport->render_priv;
+  int first_x, last_x, first_y, last_y;
+  int tx, ty;
+  int i;
+
+  first_x = tile_coord (MIN (left, right), PCB->MaxWidth);
+  last_x  = tile_coord (MAX (left, right), PCB->MaxWidth);
+  first_y = tile_coord (MIN (top, bottom), PCB->MaxHeight);
+  last_y  = tile_coord (MAX (top, bottom), PCB->MaxHeight);
+
+  priv->holes_valid = false;
+
+  for (i = 0; i < MAX_LAYER; i++)
+    {
+      layer_geometry *lg = &priv->layer_geometry[i];
+
+      if (lg->geometry == NULL)
+        continue;
+
+      for (ty = first_y; ty <= last_y; ty++)
+        for (tx = first_x; tx <= last_x; tx++)
+          {
+            hidgl_retained_invalidate (lg->geometry, ty * RETAINED_TILES + tx);
+            hidgl_retained_invalidate (lg->geometry, TEXT_CHUNK (ty * RETAINED_TILES + tx));
+            lg->bounds_valid[ty * RETAINED_TILES + tx] = false;
+          }
+    }
+}
+
+void
+ghid_invalidate_caches (void)
+{
+  render_priv *priv = gport->render_priv;
+  int i, tile;
+
+  priv->holes_valid = false;
+
+  /* The board may be a new one, even at the same address, so nothing
+   * recorded from the old one may be drawn whilst it is re-recorded.
+   */
+  for (i = 0; i < MAX_LAYER; i++)
+    {
+      layer_geometry *lg = &priv->layer_geometry[i];
+
+      if (lg->geometry == NULL)
+        continue;
+
+      hidgl_retained_invalidate_all (lg->geometry);
+      memset (lg->bounds_valid, 0, sizeof (lg->bounds_valid));
+      for (tile = 0; tile < RETAINED_CHUNKS; tile++)
+        lg->wrong[tile] = true;
+    }
+}
+
 void
 ghid_invalidate_lr (int left, int right, int top, int bottom)
 {
+  invalidate_retained_area (left, right, top, bottom);
+  ghid_invalidate_all ();
+}
+
+/* Called by the core when the whole board may have changed, unlike
+ * ghid_invalidate_all (), which the GUI uses to simply repaint the view.
+ */
+static void
+ghid_invalidate_everything (void)
+{
+  ghid_invalidate_caches ();
   ghid_invalidate_all ();
 }
 
 #define MAX_ELAPSED (50. / 1000.) /* 50ms */
-void
-ghid_invalidate_all ()
+/* Repaints the view for a change to the overlay alone, so the cached
+ * scene underneath it can be reused.
+ */
+static void
+ghid_invalidate_overlay (void)
 {
   render_priv *priv = gport->render_priv;
   double elapsed = g_timer_elapsed (priv->time_since_expose, NULL);
@@ -843,6 +1077,15 @@ ghid_invalidate_all ()
     gdk_window_process_all_updates ();
 }
 
+void
+ghid_invalidate_all ()
+{
+  render_priv *priv = gport->render_priv;
+
+  priv->scene_valid = false;
+  ghid_invalidate_overlay ();
+}
+
 void
 ghid_notify_crosshair_change (bool changes_complete)
 {
@@ -850,8 +1093,8 @@ ghid_notify_crosshair_change (bool changes_complete)
   if (gport->drawing_area == NULL)
     return;
 
-  /* FIXME: We could just invalidate the bounds of the crosshair attached objects? */
-  ghid_invalidate_all ();
+  /* The crosshair and attached objects are drawn in the overlay */
+  ghid_invalidate_overlay ();
 }
 
 void
@@ -861,8 +1104,7 @@ ghid_notify_mark_change (bool changes_complete)
   if (gport->drawing_area == NULL)
     return;
 
-  /* FIXME: We could just invalidate the bounds of the mark? */
-  ghid_invalidate_all ();
+  ghid_invalidate_overlay ();
 }
 
 static void
@@ -1003,6 +1245,7 @@ ghid_init_renderer (int *argc, char ***argv, GHidPort *port)
   port->render_priv = priv = g_new0 (render_priv, 1);
 
   priv->time_since_expose = g_timer_new ();
+  priv->frame_timer = g_timer_new ();
 
   gtk_gl_init(argc, argv);
 
@@ -1020,18 +1263,41 @@ ghid_init_renderer (int *argc, char ***argv, GHidPort *port)
   hidgl_init ();
   priv->hidgl = hidgl_new_instance ();
 
+#if !GLIB_CHECK_VERSION (2, 32, 0)
+  /* Retained geometry is recorded on worker threads */
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+#endif
+
   /* Setup HID function pointers specific to the GL renderer*/
   ghid_graphics_class.end_layer = ghid_end_layer;
   ghid_graphics_class.fill_pcb_polygon = ghid_fill_pcb_polygon;
   ghid_graphics_class.thindraw_pcb_polygon = ghid_thindraw_pcb_polygon;
+
+  ghid_hid.invalidate_all = ghid_invalidate_everything;
 }
 
 void
 ghid_shutdown_renderer (GHidPort *port)
 {
   render_priv *priv = port->render_priv;
+  int i;
+
+  /* Workers may still be recording into the retained geometry */
+  stop_retained_workers (priv);
+
+  for (i = 0; i < MAX_LAYER; i++)
+    hidgl_retained_free (priv->layer_geometry[i].geometry);
+
+  for (i = 0; i < MAX_RETAINED_WORKERS; i++)
+    if (priv->recorders[i] != NULL)
+      hidgl_free_recorder (priv->recorders[i]);
+
+  for (i = 0; i < N_HOLE_COLORS; i++)
+    free (priv->holes[i].holes);
 
   hidgl_free_instance (priv->hidgl);
+  g_timer_destroy (priv->frame_timer);
 
   ghid_cancel_lead_user ();
   g_free (port->render_priv);
@@ -1084,7 +1350,9 @@ ghid_start_drawing (GHidPort *port, GtkWidget *widget)
 void
 ghid_end_drawing (GHidPort *port, GtkWidget *widget)
 {
+  render_priv *priv = port->render_priv;
   GdkGLDrawable *pGlDrawable = gtk_widget_get_gl_drawable (widget);
+  double start = g_timer_elapsed (priv->frame_timer, NULL);
 
   hidgl_finish_render (port->render_priv->hidgl);
 
@@ -1093,6 +1361,8 @@ ghid_end_drawing (GHidPort *port, GtkWidget *widget)
   else
     glFlush ();
 
+  priv->stats.swap_ms = 1000. * (g_timer_elapsed (priv->frame_timer, NULL) - start);
+
   port->render_priv->in_context = false;
 
   /* end drawing to current GL-context */
@@ -1156,6 +1426,54 @@ set_pv_inlayer_color (PinType *pv, LayerType *layer, int type)
     }
 }
 
+/* Returns true if the box is too small on screen, at the given scale, to
+ * be worth drawing in full detail.
+ */
+static bool
+below_lod_at (const BoxType *b, double pixels, double coord_per_px)
+{
+  Coord limit = coord_per_px * pixels;
+
+  return (b->X2 - b->X1 < limit && b->Y2 - b->Y1 < limit);
+}
+
+static bool
+below_lod (const BoxType *b, double pixels)
+{
+  return below_lod_at (b, pixels, gport->view.coord_per_px);
+}
+
+/* Computes the box standing in for an object too small to draw in
+ * detail, which is its bounding box, grown to cover at least one pixel.
+ */
+static void
+lod_box_at (const BoxType *b, BoxType *box, double coord_per_px)
+{
+  Coord px = coord_per_px;
+  Coord cx = (b->X1 + b->X2) / 2;
+  Coord cy = (b->Y1 + b->Y2) / 2;
+
+  box->X1 = MIN (b->X1, cx - px / 2);
+  box->Y1 = MIN (b->Y1, cy - px / 2);
+  box->X2 = MAX (b->X2, cx + px / 2);
+  box->Y2 = MAX (b->Y2, cy + px / 2);
+}
+
+static void
+lod_box (const BoxType *b, BoxType *box)
+{
+  lod_box_at (b, box, gport->view.coord_per_px);
+}
+
+static void
+draw_lod_box (const BoxType *b)
+{
+  BoxType box;
+
+  lod_box (b, &box);
+  hid_draw_fill_rect (Output.fgGC, box.X1, box.Y1, box.X2, box.Y2);
+}
+
 static void
 _draw_pv_name (PinType *pv)
 {
@@ -1168,6 +1486,10 @@ _draw_pv_name (PinType *pv)
   else
     text.TextString = EMPTY (TEST_FLAG (SHOWNUMBERFLAG, PCB) ? pv->Number : pv->Name);
 
+  /* Don't bother with names too small to read */
+  if (56 * pv->Thickness / 100 < gport->view.coord_per_px * LOD_TEXT_PIXELS)
+    return;
+
   vert = TEST_FLAG (EDGE2FLAG, pv);
 
   if (vert)
@@ -1196,13 +1518,29 @@ _draw_pv_name (PinType *pv)
 static void
 _draw_pv (PinType *pv, bool draw_hole)
 {
+  render_priv *priv = gport->render_priv;
+
   if (TEST_FLAG (THINDRAWFLAG, PCB))
     hid_draw_thin_pcb_pv (Output.fgGC, Output.fgGC, pv, draw_hole, false);
+  else if (!draw_hole &&
+           !TEST_FLAG (HOLEFLAG, pv) &&
+           !TEST_FLAG (SQUAREFLAG, pv) &&
+           !TEST_FLAG (OCTAGONFLAG, pv))
+    {
+      /* Round pins and vias are batched up and drawn in one go */
+      if (use_gc (Output.fgGC))
+        hidgl_queue_circle (Output.fgGC, pv->X, pv->Y,
+                            pv->Thickness / 2, pv->DrillingHole / 2);
+    }
   else
     hid_draw_fill_pcb_pv (Output.fgGC, Output.bgGC, pv, draw_hole, false);
 
   if (!TEST_FLAG (HOLEFLAG, pv) && TEST_FLAG (DISPLAYNAMEFLAG, pv))
-    _draw_pv_name (pv);
+    {
+      /* The name must be drawn over the top of the pin */
+      hidgl_flush_instances (priv->hidgl);
+      _draw_pv_name (pv);
+    }
 }
 
 static void
@@ -1279,6 +1617,10 @@ draw_pad_name (PadType *pad)
   else
     text.TextString = EMPTY (TEST_FLAG (SHOWNUMBERFLAG, PCB) ? pad->Number : pad->Name);
 
+  /* Don't bother with names too small to read */
+  if (90 * pad->Thickness / 100 < gport->view.coord_per_px * LOD_TEXT_PIXELS)
+    return;
+
   /* should text be vertical ? */
   vert = (pad->Point1.X == pad->Point2.X);
 
@@ -1329,7 +1671,10 @@ draw_pad (PadType *pad)
                     PCB->PinSelectedColor, PCB->ConnectedColor, PCB->FoundColor,
                     FRONT (pad) ? PCB->PinColor : PCB->InvisibleObjectsColor);
 
-  _draw_pad (Output.fgGC, pad, false, false);
+  if (below_lod (&pad->BoundingBox, LOD_PIXELS) && !TEST_FLAG (THINDRAWFLAG, PCB))
+    draw_lod_box (&pad->BoundingBox);
+  else
+    _draw_pad (Output.fgGC, pad, false, false);
 
   if (TEST_FLAG (DISPLAYNAMEFLAG, pad))
     draw_pad_name (pad);
@@ -1386,14 +1731,44 @@ hole_callback (const BoxType * b, void *cl)
   return 1;
 }
 
+/* The extent of a line's copper. Unlike its bounding box, this leaves out
+ * the clearance.
+ */
+static void
+line_copper_box (const LineType *line, BoxType *box)
+{
+  Coord half = line->Thickness / 2;
+
+  box->X1 = MIN (line->Point1.X, line->Point2.X) - half;
+  box->Y1 = MIN (line->Point1.Y, line->Point2.Y) - half;
+  box->X2 = MAX (line->Point1.X, line->Point2.X) + half;
+  box->Y2 = MAX (line->Point1.Y, line->Point2.Y) + half;
+}
+
+static void
+arc_copper_box (const ArcType *arc, BoxType *box)
+{
+  Coord half = arc->Clearance / 2;
+
+  box->X1 = arc->BoundingBox.X1 + half;
+  box->Y1 = arc->BoundingBox.Y1 + half;
+  box->X2 = arc->BoundingBox.X2 - half;
+  box->Y2 = arc->BoundingBox.Y2 - half;
+}
+
 static int
 line_callback (const BoxType * b, void *cl)
 {
   LayerType *layer = cl;
   LineType *line = (LineType *)b;
+  BoxType copper;
 
   set_layer_object_color (layer, (AnyObjectType *) line);
-  hid_draw_pcb_line (Output.fgGC, line);
+  line_copper_box (line, &copper);
+  if (below_lod (&copper, LOD_PIXELS) && !TEST_FLAG (THINDRAWFLAG, PCB))
+    draw_lod_box (&copper);
+  else
+    hid_draw_pcb_line (Output.fgGC, line);
   return 1;
 }
 
@@ -1402,9 +1777,14 @@ arc_callback (const BoxType * b, void *cl)
 {
   LayerType *layer = cl;
   ArcType *arc = (ArcType *)b;
+  BoxType copper;
 
   set_layer_object_color (layer, (AnyObjectType *) arc);
-  hid_draw_pcb_arc (Output.fgGC, arc);
+  arc_copper_box (arc, &copper);
+  if (below_lod (&copper, LOD_PIXELS) && !TEST_FLAG (THINDRAWFLAG, PCB))
+    draw_lod_box (&copper);
+  else
+    hid_draw_pcb_arc (Output.fgGC, arc);
   return 1;
 }
 
@@ -1419,6 +1799,14 @@ text_callback (const BoxType * b, void *cl)
     hid_draw_set_color (Output.fgGC, layer->SelectedColor);
   else
     hid_draw_set_color (Output.fgGC, layer->Color);
+
+  /* Text too small to read is drawn as a solid block */
+  if (MIN (b->X2 - b->X1, b->Y2 - b->Y1) < gport->view.coord_per_px * LOD_TEXT_PIXELS)
+    {
+      draw_lod_box (b);
+      return 1;
+    }
+
   if (layer == &PCB->Data->SILKLAYER ||
       layer == &PCB->Data->BACKSILKLAYER)
     min_silk_line = PCB->minSlk;
@@ -1428,84 +1816,697 @@ text_callback (const BoxType * b, void *cl)
   return 1;
 }
 
-struct poly_info
+struct retained_info
 {
   LayerType *layer;
-  const BoxType *drawn_area;
+  int tile;
+  BoxType bounds;
 };
 
+/* Objects are recorded into the tile containing the centre of their
+ * bounding box, so that each is recorded exactly once.
+ */
 static int
-poly_callback (const BoxType * b, void *cl)
+retained_line_callback (const BoxType * b, void *cl)
 {
-  struct poly_info *i = (struct poly_info *) cl;
-  PolygonType *polygon = (PolygonType *) b;
+  struct retained_info *i = (struct retained_info *) cl;
 
-  set_layer_object_color (i->layer, (AnyObjectType *) polygon);
-  hid_draw_pcb_polygon (Output.fgGC, polygon, i->drawn_area);
-  return 1;
+  if (tile_index (b) != i->tile)
+    return 0;
+
+  return line_callback (b, i->layer);
 }
 
 static int
-poly_callback_no_clear (const BoxType * b, void *cl)
+retained_arc_callback (const BoxType * b, void *cl)
 {
-  struct poly_info *i = (struct poly_info *) cl;
-  PolygonType *polygon = (PolygonType *) b;
+  struct retained_info *i = (struct retained_info *) cl;
 
-  if (TEST_FLAG (CLEARPOLYFLAG, polygon))
+  if (tile_index (b) != i->tile)
     return 0;
 
-  set_layer_object_color (i->layer, (AnyObjectType *) polygon);
-  hid_draw_pcb_polygon (Output.fgGC, polygon, i->drawn_area);
-  return 1;
+  return arc_callback (b, i->layer);
 }
 
 static int
-poly_callback_clearing (const BoxType * b, void *cl)
+retained_text_callback (const BoxType * b, void *cl)
 {
-  struct poly_info *i = (struct poly_info *) cl;
-  PolygonType *polygon = (PolygonType *) b;
+  struct retained_info *i = (struct retained_info *) cl;
 
-  if (!TEST_FLAG (CLEARPOLYFLAG, polygon))
+  if (tile_index (b) != i->tile)
     return 0;
 
-  set_layer_object_color (i->layer, (AnyObjectType *) polygon);
-  hid_draw_pcb_polygon (Output.fgGC, polygon, i->drawn_area);
-  return 1;
+  return text_callback (b, i->layer);
 }
 
-static int
-clearPin_callback (const BoxType * b, void *cl)
+/* The region of the board searched for objects to record into a tile */
+static void
+retained_tile_box (int tile, BoxType *box)
 {
-  PinType *pin = (PinType *) b;
-  if (TEST_FLAG (THINDRAWFLAG, PCB) || TEST_FLAG (THINDRAWPOLYFLAG, PCB))
-    hid_draw_thin_pcb_pv (Output.pmGC, Output.pmGC, pin, false, true);
-  else
-    hid_draw_fill_pcb_pv (Output.pmGC, Output.pmGC, pin, false, true);
-  return 1;
+  Coord tile_w = MAX (PCB->MaxWidth / RETAINED_TILES, 1);
+  Coord tile_h = MAX (PCB->MaxHeight / RETAINED_TILES, 1);
+  int tx = tile % RETAINED_TILES;
+  int ty = tile / RETAINED_TILES;
+
+  /* Edge tiles also collect anything lying off the board */
+  box->X1 = (tx == 0) ? -MAX_COORD : tx * tile_w;
+  box->Y1 = (ty == 0) ? -MAX_COORD : ty * tile_h;
+  box->X2 = (tx == RETAINED_TILES - 1) ? MAX_COORD : (tx + 1) * tile_w;
+  box->Y2 = (ty == RETAINED_TILES - 1) ? MAX_COORD : (ty + 1) * tile_h;
 }
 
-static int
-clearPad_callback (const BoxType * b, void *cl)
+/* Returns the retained geometry of a copper layer, invalidating it if
+ * anything it was recorded with has changed.
+ */
+static layer_geometry *
+sync_layer_geometry (int layernum, float depth)
 {
-  PadType *pad = (PadType *) b;
-  int *side = cl;
-  if (ON_SIDE (pad, *side) && pad->Mask)
-    _draw_pad (Output.pmGC, pad, true, true);
-  return 1;
+  render_priv *priv = gport->render_priv;
+  layer_geometry *lg = &priv->layer_geometry[layernum];
+  bool thin = TEST_FLAG (THINDRAWFLAG, PCB);
+  bool wrong;
+  int tile;
+
+  if (lg->geometry == NULL)
+    {
+      lg->geometry = hidgl_retained_new (2 * RETAINED_CHUNKS);
+      for (tile = 0; tile < RETAINED_CHUNKS; tile++)
+        lg->wrong[tile] = true;
+    }
+
+  /* At a different scale, the old geometry is only at the wrong level of
+   * detail, so may still be drawn whilst it is re-recorded.
+   */
+  wrong = (lg->pcb != PCB ||
+           lg->max_width != PCB->MaxWidth ||
+           lg->max_height != PCB->MaxHeight ||
+           lg->depth != depth ||
+           lg->thin != thin);
+
+  if (wrong || lg->scale != gport->view.coord_per_px)
+    {
+      hidgl_retained_invalidate_all (lg->geometry);
+      for (tile = 0; tile < RETAINED_CHUNKS && wrong; tile++)
+        {
+          lg->wrong[tile] = true;
+          lg->bounds_valid[tile] = false;
+        }
+      lg->pcb = PCB;
+      lg->max_width = PCB->MaxWidth;
+      lg->max_height = PCB->MaxHeight;
+      lg->scale = gport->view.coord_per_px;
+      lg->depth = depth;
+      lg->thin = thin;
+    }
+
+  return lg;
 }
 
 static int
-clearPin_callback_solid (const BoxType * b, void *cl)
+tile_bounds_callback (const BoxType * b, void *cl)
 {
-  PinType *pin = (PinType *) b;
-  hid_draw_fill_pcb_pv (Output.pmGC, Output.pmGC, pin, false, true);
+  struct retained_info *i = (struct retained_info *) cl;
+  BoxType *bounds = &i->bounds;
+
+  if (tile_index (b) != i->tile)
+    return 0;
+
+  MAKEMIN (bounds->X1, b->X1);
+  MAKEMIN (bounds->Y1, b->Y1);
+  MAKEMAX (bounds->X2, b->X2);
+  MAKEMAX (bounds->Y2, b->Y2);
   return 1;
 }
 
-static int
-clearPad_callback_solid (const BoxType * b, void *cl)
+/* Returns true if anything recorded into a tile of a layer may be seen in
+ * the given region of the board.
+ */
+static bool
+tile_in_view (LayerType *layer, layer_geometry *lg, int tile, const BoxType *view)
 {
-  PadType *pad = (PadType *) b;
+  BoxType *bounds = &lg->bounds[tile];
+  struct retained_info info;
+  BoxType tile_box;
+  Coord px = gport->view.coord_per_px;
+
+  if (!lg->bounds_valid[tile])
+    {
+      info.layer = layer;
+      info.tile = tile;
+      info.bounds.X1 = info.bounds.Y1 = MAX_COORD;
+      info.bounds.X2 = info.bounds.Y2 = -MAX_COORD;
+
+      retained_tile_box (tile, &tile_box);
+      r_search (layer->line_tree, &tile_box, NULL, tile_bounds_callback, &info);
+      r_search (layer->arc_tree, &tile_box, NULL, tile_bounds_callback, &info);
+      r_search (layer->text_tree, &tile_box, NULL, tile_bounds_callback, &info);
+
+      *bounds = info.bounds;
+      lg->bounds_valid[tile] = true;
+    }
+
+  /* Objects too small to see are drawn as boxes, which may be up to a
+   * pixel larger than the object.
+   */
+  return (bounds->X1 - px <= view->X2 && bounds->X2 + px >= view->X1 &&
+          bounds->Y1 - px <= view->Y2 && bounds->Y2 + px >= view->Y1);
+}
+
+/* Recording lines and arcs on worker threads
+ *
+ * Before a frame is drawn, the lines and arcs of every stale tile on the
+ * visible copper layers are copied into a snapshot, which is handed to a
+ * pool of worker threads. Each worker records snapshots through its own
+ * hidgl recorder, into the back buffer of the tile's chunk, so it never
+ * reads the board whilst the core may be changing it. Colours are worked
+ * out beforehand on the GL thread.
+ *
+ * The GL thread waits for the workers for up to RETAINED_FRAME_BUDGET,
+ * swaps in whatever has finished, and draws any other tiles as they were
+ * last recorded. Once the rest finish, an idle handler queues a single
+ * redraw for all of them. Only where the previous recording is wrong,
+ * rather than out of date, such as for a newly loaded board, does the GL
+ * thread wait for everything.
+ */
+#define RETAINED_FRAME_BUDGET 20000 /* Microseconds */
+
+enum {
+  OBJECT_NORMAL,
+  OBJECT_SELECTED,
+  OBJECT_CONNECTED,
+  OBJECT_FOUND,
+  OBJECT_N_COLORS
+};
+
+typedef struct retained_job {
+  layer_geometry *lg;
+  int tile;
+  float depth;
+  double scale;
+  bool thin;
+  GLfloat color[OBJECT_N_COLORS][4];
+
+  /* Snapshot of the objects in the tile */
+  LineType *lines;
+  int n_lines;
+  int lines_space;
+  ArcType *arcs;
+  int n_arcs;
+  int arcs_space;
+} retained_job;
+
+typedef struct retained_worker {
+  hidgl_instance *recorder;
+  struct hidgl_gc_struct gc;
+  retained_job *job;
+  int color;
+} retained_worker;
+
+/* Matches the choice of colour made by set_layer_object_color() */
+static int
+object_color_index (AnyObjectType *obj)
+{
+  if (TEST_FLAG (SELECTEDFLAG, obj))  return OBJECT_SELECTED;
+  if (TEST_FLAG (CONNECTEDFLAG, obj)) return OBJECT_CONNECTED;
+  if (TEST_FLAG (FOUNDFLAG, obj))     return OBJECT_FOUND;
+  return OBJECT_NORMAL;
+}
+
+static void
+worker_set_color (retained_worker *w, AnyObjectType *obj)
+{
+  int color = object_color_index (obj);
+  GLfloat *rgba = w->job->color[color];
+
+  if (color == w->color)
+    return;
+
+  hidgl_flush_triangles (w->recorder);
+  hidgl_set_color (w->recorder, rgba[0], rgba[1], rgba[2], rgba[3]);
+  w->color = color;
+}
+
+/* Draws the box standing in for an object whose copper, given by b, is too
+ * small to draw in detail, returning false if it isn't.
+ */
+static bool
+worker_draw_lod_box (retained_worker *w, const BoxType *b)
+{
+  BoxType box;
+
+  if (w->job->thin || !below_lod_at (b, LOD_PIXELS, w->job->scale))
+    return false;
+
+  lod_box_at (b, &box, w->job->scale);
+  hidgl_fill_rect ((hidGC)&w->gc, box.X1, box.Y1, box.X2, box.Y2);
+  return true;
+}
+
+static void
+worker_draw_line (retained_worker *w, LineType *line)
+{
+  BoxType copper;
+
+  worker_set_color (w, (AnyObjectType *) line);
+  line_copper_box (line, &copper);
+  if (!worker_draw_lod_box (w, &copper))
+    hidgl_draw_line ((hidGC)&w->gc, Trace_Cap,
+                     w->job->thin ? 0 : line->Thickness,
+                     line->Point1.X, line->Point1.Y,
+                     line->Point2.X, line->Point2.Y,
+                     w->job->scale);
+}
+
+static void
+worker_draw_arc (retained_worker *w, ArcType *arc)
+{
+  BoxType copper;
+
+  worker_set_color (w, (AnyObjectType *) arc);
+  arc_copper_box (arc, &copper);
+  if (!worker_draw_lod_box (w, &copper) && arc->Thickness)
+    hidgl_draw_arc ((hidGC)&w->gc,
+                    w->job->thin ? 0 : arc->Thickness,
+                    arc->X, arc->Y, arc->Width, arc->Height,
+                    arc->StartAngle, arc->Delta,
+                    w->job->scale);
+}
+
+/* Redraws the view for any recordings which finished after the frame
+ * waiting for them gave up.
+ */
+static gboolean
+retained_jobs_finished_cb (gpointer data)
+{
+  render_priv *priv = gport->render_priv;
+
+  if (priv == NULL || priv->finished_jobs == NULL)
+    return FALSE;
+
+  g_atomic_int_set (&priv->redraw_queued, 0);
+
+  if (g_async_queue_length (priv->finished_jobs) > 0)
+    ghid_invalidate_all ();
+
+  return FALSE;
+}
+
+static void
+worker_record_job (gpointer data, gpointer user_data)
+{
+  render_priv *priv = user_data;
+  retained_worker w;
+  int i;
+
+  memset (&w, 0, sizeof (retained_worker));
+  w.job = data;
+  w.color = -1;
+  w.recorder = g_async_queue_pop (priv->idle_recorders);
+  w.gc.hidgl = w.recorder;
+  w.gc.depth = w.job->depth;
+
+  hidgl_retained_begin_pending_chunk (w.recorder, w.job->lg->geometry, w.job->tile);
+  for (i = 0; i < w.job->n_lines; i++)
+    worker_draw_line (&w, &w.job->lines[i]);
+  for (i = 0; i < w.job->n_arcs; i++)
+    worker_draw_arc (&w, &w.job->arcs[i]);
+  hidgl_retained_end_chunk (w.recorder);
+
+  g_async_queue_push (priv->idle_recorders, w.recorder);
+  g_async_queue_push (priv->finished_jobs, w.job);
+
+  if (g_atomic_int_compare_and_exchange (&priv->redraw_queued, 0, 1))
+    g_idle_add (retained_jobs_finished_cb, NULL);
+}
+
+static int
+retained_worker_count (void)
+{
+#if GLIB_CHECK_VERSION (2, 36, 0)
+  return CLAMP (g_get_num_processors (), 1, MAX_RETAINED_WORKERS);
+#else
+  return 1;
+#endif
+}
+
+static void
+start_retained_workers (render_priv *priv)
+{
+  int n_workers = retained_worker_count ();
+  int i;
+
+  if (priv->finished_jobs != NULL)
+    return;
+
+  priv->idle_recorders = g_async_queue_new ();
+  priv->finished_jobs = g_async_queue_new ();
+
+  for (i = 0; i < n_workers; i++)
+    {
+      priv->recorders[i] = hidgl_new_recorder ();
+      g_async_queue_push (priv->idle_recorders, priv->recorders[i]);
+    }
+
+  /* Without a pool, jobs are recorded on the GL thread as they're queued */
+  priv->record_pool = g_thread_pool_new (worker_record_job, priv, n_workers, TRUE, NULL);
+}
+
+/* Swaps a finished recording in for drawing */
+static void
+finish_retained_job (render_priv *priv, retained_job *job)
+{
+  hidgl_retained_swap_pending (job->lg->geometry, job->tile);
+  job->lg->recording[job->tile] = false;
+  priv->jobs_in_flight--;
+
+  free (job->lines);
+  free (job->arcs);
+  free (job);
+}
+
+static retained_job *
+pop_finished_job (render_priv *priv, gint64 end_time)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  if (end_time <= now)
+    return g_async_queue_try_pop (priv->finished_jobs);
+
+#if GLIB_CHECK_VERSION (2, 32, 0)
+  return g_async_queue_timeout_pop (priv->finished_jobs, end_time - now);
+#else
+  {
+    GTimeVal end;
+
+    g_get_current_time (&end);
+    g_time_val_add (&end, end_time - now);
+    return g_async_queue_timed_pop (priv->finished_jobs, &end);
+  }
+#endif
+}
+
+/* Swaps in every recording which has finished by end_time (on the
+ * monotonic clock), or every one in flight if wait_all is set.
+ */
+static void
+collect_retained_jobs (render_priv *priv, bool wait_all, gint64 end_time)
+{
+  retained_job *job;
+
+  while (priv->jobs_in_flight > 0)
+    {
+      if (wait_all)
+        job = g_async_queue_pop (priv->finished_jobs);
+      else
+        job = pop_finished_job (priv, end_time);
+
+      if (job == NULL)
+        break;
+
+      finish_retained_job (priv, job);
+    }
+}
+
+static void
+stop_retained_workers (render_priv *priv)
+{
+  if (priv->finished_jobs == NULL)
+    return;
+
+  collect_retained_jobs (priv, true, 0);
+
+  if (priv->record_pool != NULL)
+    g_thread_pool_free (priv->record_pool, FALSE, TRUE);
+
+  g_async_queue_unref (priv->idle_recorders);
+  g_async_queue_unref (priv->finished_jobs);
+  priv->record_pool = NULL;
+  priv->idle_recorders = NULL;
+  priv->finished_jobs = NULL;
+}
+
+static int
+snapshot_line_callback (const BoxType * b, void *cl)
+{
+  retained_job *job = cl;
+
+  if (tile_index (b) != job->tile)
+    return 0;
+
+  if (job->n_lines == job->lines_space)
+    {
+      job->lines_space = MAX (64, 2 * job->lines_space);
+      job->lines = realloc (job->lines, job->lines_space * sizeof (LineType));
+    }
+
+  job->lines[job->n_lines++] = *(LineType *)b;
+  return 1;
+}
+
+static int
+snapshot_arc_callback (const BoxType * b, void *cl)
+{
+  retained_job *job = cl;
+
+  if (tile_index (b) != job->tile)
+    return 0;
+
+  if (job->n_arcs == job->arcs_space)
+    {
+      job->arcs_space = MAX (64, 2 * job->arcs_space);
+      job->arcs = realloc (job->arcs, job->arcs_space * sizeof (ArcType));
+    }
+
+  job->arcs[job->n_arcs++] = *(ArcType *)b;
+  return 1;
+}
+
+/* Snapshots a stale tile of a layer, and queues it to be recorded */
+static void
+queue_retained_job (render_priv *priv, LayerType *layer, retained_job *proto, int tile)
+{
+  retained_job *job = malloc (sizeof (retained_job));
+  BoxType tile_box;
+
+  *job = *proto;
+  job->tile = tile;
+
+  retained_tile_box (tile, &tile_box);
+  r_search (layer->line_tree, &tile_box, NULL, snapshot_line_callback, job);
+  r_search (layer->arc_tree, &tile_box, NULL, snapshot_arc_callback, job);
+
+  /* Invalidations from here on need another recording */
+  hidgl_retained_mark_clean (job->lg->geometry, tile);
+  job->lg->recording[tile] = true;
+  job->lg->wrong[tile] = false;
+  priv->jobs_in_flight++;
+
+  if (priv->record_pool != NULL)
+    g_thread_pool_push (priv->record_pool, job, NULL);
+  else
+    worker_record_job (job, priv);
+}
+
+/* Queues the lines and arcs of any stale tiles in view on the copper
+ * layers of the given groups, drawn with the corresponding alpha_mult, to
+ * be recorded in the background, then waits a while for them.
+ */
+static void
+record_retained_layers (int ngroups, int *groups, double *alpha_mult, const BoxType *view)
+{
+  render_priv *priv = gport->render_priv;
+  gint64 end_time = g_get_monotonic_time () + RETAINED_FRAME_BUDGET;
+  int layers[MAX_LAYER];
+  int layer_group[MAX_LAYER];
+  int n_layers = 0;
+  bool wait_all = false;
+  int i, j, tile;
+
+  start_retained_workers (priv);
+
+  for (i = 0; i < ngroups; i++)
+    for (j = 0; j < PCB->LayerGroups.Number[groups[i]]; j++)
+      {
+        int layernum = PCB->LayerGroups.Entries[groups[i]][j];
+        layer_geometry *lg;
+
+        if (layernum >= max_copper_layer || !PCB->Data->Layer[layernum].On)
+          continue;
+
+        lg = sync_layer_geometry (layernum, compute_depth (groups[i]));
+        for (tile = 0; tile < RETAINED_CHUNKS; tile++)
+          if (lg->wrong[tile] &&
+              tile_in_view (PCB->Data->Layer + layernum, lg, tile, view))
+            wait_all = true;
+
+        layers[n_layers] = layernum;
+        layer_group[n_layers++] = i;
+      }
+
+  /* Tiles still in flight can't be queued again until their recordings
+   * are swapped in, so when we must wait for every tile, we wait for
+   * those first. Otherwise, we just take whatever has finished.
+   */
+  collect_retained_jobs (priv, wait_all, 0);
+
+  for (i = 0; i < n_layers; i++)
+    {
+      LayerType *layer = PCB->Data->Layer + layers[i];
+      layer_geometry *lg = &priv->layer_geometry[layers[i]];
+      double alpha = alpha_mult[layer_group[i]];
+      retained_job proto;
+
+      memset (&proto, 0, sizeof (retained_job));
+      proto.lg = lg;
+      proto.depth = lg->depth;
+      proto.scale = lg->scale;
+      proto.thin = lg->thin;
+      compute_gl_color (layer->Color,         alpha, true, proto.color[OBJECT_NORMAL]);
+      compute_gl_color (layer->SelectedColor, alpha, true, proto.color[OBJECT_SELECTED]);
+      compute_gl_color (PCB->ConnectedColor,  alpha, true, proto.color[OBJECT_CONNECTED]);
+      compute_gl_color (PCB->FoundColor,      alpha, true, proto.color[OBJECT_FOUND]);
+
+      for (tile = 0; tile < RETAINED_CHUNKS; tile++)
+        if (hidgl_retained_chunk_is_dirty (lg->geometry, tile) &&
+            !lg->recording[tile] &&
+            tile_in_view (layer, lg, tile, view))
+          queue_retained_job (priv, layer, &proto, tile);
+    }
+
+  collect_retained_jobs (priv, wait_all, end_time);
+  priv->stats.tiles_pending = priv->jobs_in_flight;
+}
+
+/* Draws the lines, arcs and text of a copper layer in the screen region
+ * from its retained geometry, re-recording any tiles there which have
+ * been invalidated since the last frame.
+ */
+static void
+draw_retained_layer (int layernum, const BoxType *screen)
+{
+  render_priv *priv = gport->render_priv;
+  LayerType *Layer = PCB->Data->Layer + layernum;
+  layer_geometry *lg;
+  struct retained_info info;
+  BoxType tile_box;
+  bool visible[2 * RETAINED_CHUNKS];
+
+  lg = sync_layer_geometry (layernum, ((hidglGC)Output.fgGC)->depth);
+
+  info.layer = Layer;
+
+  /* Lines and arcs are normally already recorded by
+   * record_retained_layers(), and text is recorded here.
+   */
+  for (info.tile = 0; info.tile < RETAINED_CHUNKS; info.tile++)
+    {
+      visible[info.tile] = tile_in_view (Layer, lg, info.tile, screen);
+      visible[TEXT_CHUNK (info.tile)] = visible[info.tile];
+
+      if (!visible[info.tile])
+        continue;
+
+      retained_tile_box (info.tile, &tile_box);
+
+      if (hidgl_retained_chunk_is_dirty (lg->geometry, info.tile) &&
+          !lg->recording[info.tile])
+        {
+          hidgl_retained_begin_chunk (priv->hidgl, lg->geometry, info.tile);
+          r_search (Layer->line_tree, &tile_box, NULL, retained_line_callback, &info);
+          r_search (Layer->arc_tree, &tile_box, NULL, retained_arc_callback, &info);
+          hidgl_retained_end_chunk (priv->hidgl);
+          lg->wrong[info.tile] = false;
+        }
+
+      if (hidgl_retained_chunk_is_dirty (lg->geometry, TEXT_CHUNK (info.tile)))
+        {
+          hidgl_retained_begin_chunk (priv->hidgl, lg->geometry, TEXT_CHUNK (info.tile));
+          r_search (Layer->text_tree, &tile_box, NULL, retained_text_callback, &info);
+          hidgl_retained_end_chunk (priv->hidgl);
+        }
+    }
+
+  hidgl_retained_draw (priv->hidgl, lg->geometry, visible);
+}
+
+struct poly_info
+{
+  LayerType *layer;
+  const BoxType *drawn_area;
+};
+
+static int
+poly_callback (const BoxType * b, void *cl)
+{
+  struct poly_info *i = (struct poly_info *) cl;
+  PolygonType *polygon = (PolygonType *) b;
+
+  set_layer_object_color (i->layer, (AnyObjectType *) polygon);
+  hid_draw_pcb_polygon (Output.fgGC, polygon, i->drawn_area);
+  return 1;
+}
+
+static int
+poly_callback_no_clear (const BoxType * b, void *cl)
+{
+  struct poly_info *i = (struct poly_info *) cl;
+  PolygonType *polygon = (PolygonType *) b;
+
+  if (TEST_FLAG (CLEARPOLYFLAG, polygon))
+    return 0;
+
+  set_layer_object_color (i->layer, (AnyObjectType *) polygon);
+  hid_draw_pcb_polygon (Output.fgGC, polygon, i->drawn_area);
+  return 1;
+}
+
+static int
+poly_callback_clearing (const BoxType * b, void *cl)
+{
+  struct poly_info *i = (struct poly_info *) cl;
+  PolygonType *polygon = (PolygonType *) b;
+
+  if (!TEST_FLAG (CLEARPOLYFLAG, polygon))
+    return 0;
+
+  set_layer_object_color (i->layer, (AnyObjectType *) polygon);
+  hid_draw_pcb_polygon (Output.fgGC, polygon, i->drawn_area);
+  return 1;
+}
+
+static int
+clearPin_callback (const BoxType * b, void *cl)
+{
+  PinType *pin = (PinType *) b;
+  if (TEST_FLAG (THINDRAWFLAG, PCB) || TEST_FLAG (THINDRAWPOLYFLAG, PCB))
+    hid_draw_thin_pcb_pv (Output.pmGC, Output.pmGC, pin, false, true);
+  else
+    hid_draw_fill_pcb_pv (Output.pmGC, Output.pmGC, pin, false, true);
+  return 1;
+}
+
+static int
+clearPad_callback (const BoxType * b, void *cl)
+{
+  PadType *pad = (PadType *) b;
+  int *side = cl;
+  if (ON_SIDE (pad, *side) && pad->Mask)
+    _draw_pad (Output.pmGC, pad, true, true);
+  return 1;
+}
+
+static int
+clearPin_callback_solid (const BoxType * b, void *cl)
+{
+  PinType *pin = (PinType *) b;
+  hid_draw_fill_pcb_pv (Output.pmGC, Output.pmGC, pin, false, true);
+  return 1;
+}
+
+static int
+clearPad_callback_solid (const BoxType * b, void *cl)
+{
+  PadType *pad = (PadType *) b;
   int *side = cl;
   if (ON_SIDE (pad, *side) && pad->Mask)
     hid_draw_fill_pcb_pad (Output.pmGC, pad, true, true);
@@ -1708,9 +2709,7 @@ GhidDrawLayerGroup (int group, const BoxType * screen)
       if (TEST_FLAG (CHECKPLANESFLAG, PCB))
         continue;
 
-      r_search (Layer->line_tree, screen, NULL, line_callback, Layer);
-      r_search (Layer->arc_tree, screen, NULL, arc_callback, Layer);
-      r_search (Layer->text_tree, screen, NULL, text_callback, Layer);
+      draw_retained_layer (layernum, screen);
     }
   }
 
@@ -1719,88 +2718,125 @@ GhidDrawLayerGroup (int group, const BoxType * screen)
   return (n_entries > 1);
 }
 
-static void
-DrawDrillChannel (hidGC gc, int vx, int vy, int vr, int from_layer, int to_layer, double scale)
+static int
+add_hole (PinType *Pin, int Type)
 {
-#define PIXELS_PER_CIRCLINE 5.
-#define MIN_FACES_PER_CYL 6
-#define MAX_FACES_PER_CYL 360
-  float radius = vr;
-  float x, y, z1, z2;
-  int i;
-  int slices;
-
-  slices = M_PI * 2 * vr / scale / PIXELS_PER_CIRCLINE;
-
-  if (slices < MIN_FACES_PER_CYL)
-    slices = MIN_FACES_PER_CYL;
-
-  if (slices > MAX_FACES_PER_CYL)
-    slices = MAX_FACES_PER_CYL;
-
-  z1 = compute_depth (from_layer);
-  z2 = compute_depth (to_layer);
-
-  x = vx + vr;
-  y = vy;
-
-  hidgl_ensure_vertex_space (gc, 2 * slices + 2 + 2);
+  render_priv *priv = gport->render_priv;
+  enum hole_color color;
+  hole_list *list;
+  cached_hole *hole;
 
-  /* NB: Repeated first virtex to separate from other tri-strip */
-  hidgl_add_vertex_3D_tex (gc, x, y, z1, 0.0, 0.0);
-  hidgl_add_vertex_3D_tex (gc, x, y, z1, 0.0, 0.0);
-  hidgl_add_vertex_3D_tex (gc, x, y, z2, 0.0, 0.0);
+  if (TEST_FLAG (WARNFLAG, Pin))
+    color = HOLE_WARN;
+  else if (TEST_FLAG (SELECTEDFLAG, Pin))
+    color = (Type == VIA_TYPE) ? HOLE_VIA_SELECTED : HOLE_PIN_SELECTED;
+  else if (TEST_FLAG (CONNECTEDFLAG, Pin))
+    color = HOLE_CONNECTED;
+  else if (TEST_FLAG (FOUNDFLAG, Pin))
+    color = HOLE_FOUND;
+  else
+    color = HOLE_DRILL;
 
-  for (i = 0; i < slices; i++)
+  list = &priv->holes[color];
+  if (list->count == list->space)
     {
-      x = radius * cosf (((float)(i + 1)) * 2. * M_PI / (float)slices) + vx;
-      y = radius * sinf (((float)(i + 1)) * 2. * M_PI / (float)slices) + vy;
-
-      hidgl_add_vertex_3D_tex (gc, x, y, z1, 0.0, 0.0);
-      hidgl_add_vertex_3D_tex (gc, x, y, z2, 0.0, 0.0);
+      list->space = MAX (1024, 2 * list->space);
+      list->holes = realloc (list->holes, list->space * sizeof (cached_hole));
     }
 
-  /* NB: Repeated last virtex to separate from other tri-strip */
-  hidgl_add_vertex_3D_tex (gc, x, y, z2, 0.0, 0.0);
+  hole = &list->holes[list->count++];
+  hole->x = Pin->X;
+  hole->y = Pin->Y;
+  hole->radius = Pin->DrillingHole / 2;
+  hole->is_via = (Type == VIA_TYPE);
+  return 0;
 }
 
-struct cyl_info {
-  int from_layer;
-  int to_layer;
-  double scale;
-};
+static int
+pin_hole_list_callback (const BoxType * b, void *cl)
+{
+  return add_hole ((PinType *)b, PIN_TYPE);
+}
 
 static int
-draw_hole_cyl (PinType *Pin, struct cyl_info *info, int Type)
+via_hole_list_callback (const BoxType * b, void *cl)
 {
-  char *color;
+  return add_hole ((PinType *)b, VIA_TYPE);
+}
 
-  if (TEST_FLAG (WARNFLAG, Pin))
-    color = PCB->WarnColor;
-  else if (TEST_FLAG (SELECTEDFLAG, Pin))
-    color = (Type == VIA_TYPE) ? PCB->ViaSelectedColor : PCB->PinSelectedColor;
-  else if (TEST_FLAG (CONNECTEDFLAG, Pin))
-    color = PCB->ConnectedColor;
-  else if (TEST_FLAG (FOUNDFLAG, Pin))
-    color = PCB->FoundColor;
-  else
-    color = "drill";
+static void
+update_hole_list (void)
+{
+  render_priv *priv = gport->render_priv;
+  int i;
 
-  hid_draw_set_color (Output.fgGC, color);
-  DrawDrillChannel (Output.fgGC, Pin->X, Pin->Y, Pin->DrillingHole / 2, info->from_layer, info->to_layer, info->scale);
-  return 0;
+  if (priv->holes_valid)
+    return;
+
+  for (i = 0; i < N_HOLE_COLORS; i++)
+    priv->holes[i].count = 0;
+
+  r_search (PCB->Data->pin_tree, NULL, NULL, pin_hole_list_callback, NULL);
+  r_search (PCB->Data->via_tree, NULL, NULL, via_hole_list_callback, NULL);
+
+  priv->holes_valid = true;
 }
 
-static int
-pin_hole_cyl_callback (const BoxType * b, void *cl)
+static char *
+hole_color_name (enum hole_color color)
 {
-  return draw_hole_cyl ((PinType *)b, (struct cyl_info *)cl, PIN_TYPE);
+  switch (color)
+    {
+    case HOLE_WARN:         return PCB->WarnColor;
+    case HOLE_PIN_SELECTED: return PCB->PinSelectedColor;
+    case HOLE_VIA_SELECTED: return PCB->ViaSelectedColor;
+    case HOLE_CONNECTED:    return PCB->ConnectedColor;
+    case HOLE_FOUND:        return PCB->FoundColor;
+    default:                return "drill";
+    }
 }
 
-static int
-via_hole_cyl_callback (const BoxType * b, void *cl)
+/* Queues the drill channels of the visible holes between two layer groups,
+ * each colour of hole being drawn in a single instanced call.
+ */
+static void
+DrawDrillChannels (int from_group, int to_group, double alpha_mult, const BoxType *drawn_area)
 {
-  return draw_hole_cyl ((PinType *)b, (struct cyl_info *)cl, VIA_TYPE);
+  render_priv *priv = gport->render_priv;
+  float z1 = compute_depth (from_group);
+  float z2 = compute_depth (to_group);
+  int color;
+  int i;
+
+  update_hole_list ();
+
+  for (color = 0; color < N_HOLE_COLORS; color++)
+    {
+      hole_list *list = &priv->holes[color];
+
+      if (list->count == 0)
+        continue;
+
+      hid_draw_set_color (Output.fgGC, hole_color_name (color));
+      ghid_set_alpha_mult (Output.fgGC, alpha_mult);
+
+      for (i = 0; i < list->count; i++)
+        {
+          cached_hole *hole = &list->holes[i];
+
+          if (!(hole->is_via ? PCB->ViaOn : PCB->PinOn))
+            continue;
+
+          if (hole->x + hole->radius < drawn_area->X1 ||
+              hole->x - hole->radius > drawn_area->X2 ||
+              hole->y + hole->radius < drawn_area->Y1 ||
+              hole->y - hole->radius > drawn_area->Y2)
+            continue;
+
+          hidgl_queue_cylinder (Output.fgGC, hole->x, hole->y, hole->radius,
+                                z1, z2, gport->view.coord_per_px);
+        }
+    }
 }
 
 static int
@@ -1864,13 +2900,14 @@ ghid_draw_everything (BoxType *drawn_area)
   int do_group[MAX_LAYER];
   /* This is the reverse of the order in which we draw them.  */
   int drawn_groups[MAX_LAYER];
-  struct cyl_info cyl_info;
+  double group_alpha_mult[MAX_LAYER];
   int reverse_layers;
   int save_show_solder;
   int top_group;
   int bottom_group;
   int min_phys_group;
   int max_phys_group;
+  double start;
 
   priv->current_colorname = NULL;
 
@@ -1917,6 +2954,25 @@ ghid_draw_everything (BoxType *drawn_area)
     }
   }
 
+#define FADE_FACTOR 1
+  number_phys_on_top = max_phys_group - min_phys_group;
+  for (i = ngroups - 1; i >= 0; i--) {
+    bool is_this_physical = drawn_groups[i] >= min_phys_group &&
+                            drawn_groups[i] <= max_phys_group;
+
+    group_alpha_mult[i] = global_view_2d ? pow (FADE_FACTOR, i) :
+      (is_this_physical ? pow (FADE_FACTOR, number_phys_on_top) : 1.);
+
+    if (is_this_physical)
+      number_phys_on_top --;
+  }
+
+  /* Bring the retained layer geometry up to date, ready for drawing */
+  start = g_timer_elapsed (priv->frame_timer, NULL);
+  if (!TEST_FLAG (CHECKPLANESFLAG, PCB))
+    record_retained_layers (ngroups, drawn_groups, group_alpha_mult, drawn_area);
+  priv->stats.record_ms = 1000. * (g_timer_elapsed (priv->frame_timer, NULL) - start);
+
   /*
    * first draw all 'invisible' stuff
    */
@@ -1941,8 +2997,6 @@ ghid_draw_everything (BoxType *drawn_area)
   }
 
   /* draw all layers in layerstack order */
-#define FADE_FACTOR 1
-  number_phys_on_top = max_phys_group - min_phys_group;
   for (i = ngroups - 1; i >= 0; i--) {
     bool is_this_physical = drawn_groups[i] >= min_phys_group &&
                             drawn_groups[i] <= max_phys_group;
@@ -1950,24 +3004,16 @@ ghid_draw_everything (BoxType *drawn_area)
                             drawn_groups[i - 1] >= min_phys_group &&
                             drawn_groups[i - 1] <= max_phys_group;
 
-    double alpha_mult = global_view_2d ? pow (FADE_FACTOR, i) :
-      (is_this_physical ? pow (FADE_FACTOR, number_phys_on_top) : 1.);
-
-    if (is_this_physical)
-      number_phys_on_top --;
-
-    ghid_set_alpha_mult (Output.fgGC, alpha_mult);
+    ghid_set_alpha_mult (Output.fgGC, group_alpha_mult[i]);
+    start = g_timer_elapsed (priv->frame_timer, NULL);
     GhidDrawLayerGroup (drawn_groups [i], drawn_area);
+    priv->stats.group_ms[drawn_groups[i]] = 1000. * (g_timer_elapsed (priv->frame_timer, NULL) - start);
+    priv->stats.group_drawn[drawn_groups[i]] = true;
 
 #if 1
     if (!global_view_2d && is_this_physical && is_next_physical) {
-      cyl_info.from_layer = drawn_groups[i];
-      cyl_info.to_layer = drawn_groups[i - 1];
-      cyl_info.scale = gport->view.coord_per_px;
-      hid_draw_set_color (Output.fgGC, "drill");
-      ghid_set_alpha_mult (Output.fgGC, alpha_mult * 0.75);
-      if (PCB->PinOn) r_search (PCB->Data->pin_tree, drawn_area, NULL, pin_hole_cyl_callback, &cyl_info);
-      if (PCB->ViaOn) r_search (PCB->Data->via_tree, drawn_area, NULL, via_hole_cyl_callback, &cyl_info);
+      DrawDrillChannels (drawn_groups[i], drawn_groups[i - 1],
+                         group_alpha_mult[i] * 0.75, drawn_area);
     }
 #endif
   }
@@ -2030,112 +3076,139 @@ ghid_draw_everything (BoxType *drawn_area)
 }
 
 #define Z_NEAR 3.0
-gboolean
-ghid_drawing_area_expose_cb (GtkWidget *widget,
-                             GdkEventExpose *ev,
-                             GHidPort *port)
+/* Formats the statistics of the last frame drawn, one line per entry in
+ * lines[], returning the number of lines.
+ */
+static int
+format_stats (frame_stats *stats, char lines[][STATS_LINE_LENGTH])
 {
-  render_priv *priv = port->render_priv;
-  GtkAllocation allocation;
-  BoxType region;
-  Coord min_x, min_y;
-  Coord max_x, max_y;
-  Coord new_x, new_y;
-  Coord min_depth;
-  Coord max_depth;
-  float aspect;
-  GLfloat scale[] = {1, 0, 0, 0,
-                     0, 1, 0, 0,
-                     0, 0, 1, 0,
-                     0, 0, 0, 1};
-  bool horizon_problem = false;
-
-  gtk_widget_get_allocation (widget, &allocation);
-
-  ghid_start_drawing (port, widget);
+  hidgl_stats *gl = &stats->gl;
+  unsigned long tess_total = gl->tess_cache_hits + gl->tess_cache_misses;
+  int n = 0;
+  int group;
+
+  snprintf (lines[n++], STATS_LINE_LENGTH, "Frame: %.2f ms (+%.2f ms swap)%s",
+            stats->frame_ms, stats->swap_ms,
+            stats->scene_cached ? ", overlay only" : "");
+  snprintf (lines[n++], STATS_LINE_LENGTH, "  Recording geometry: %.2f ms, %d tiles pending",
+            stats->record_ms, stats->tiles_pending);
+
+  for (group = 0; group < max_group; group++)
+    {
+      const char *name = "";
 
-  Output.fgGC = hid_draw_make_gc (&ghid_graphics);
-  Output.bgGC = hid_draw_make_gc (&ghid_graphics);
-  Output.pmGC = hid_draw_make_gc (&ghid_graphics);
+      if (!stats->group_drawn[group])
+        continue;
 
-  /* If we don't have any stencil bits available,
-     we can't use the hidgl polygon drawing routine */
-  /* TODO: We could use the GLU tessellator though */
-  if (hidgl_stencil_bits (priv->hidgl) == 0)
-    ghid_graphics_class.fill_pcb_polygon = common_fill_pcb_polygon;
+      if (PCB->LayerGroups.Number[group] > 0)
+        name = PCB->Data->Layer[PCB->LayerGroups.Entries[group][0]].Name;
 
-  glEnable (GL_BLEND);
-  glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      snprintf (lines[n++], STATS_LINE_LENGTH, "  Group %d (%s): %.2f ms",
+                group + 1, name, stats->group_ms[group]);
+    }
 
-  glViewport (0, 0, allocation.width, allocation.height);
+  snprintf (lines[n++], STATS_LINE_LENGTH, "Draw calls: %lu (%lu flushes)",
+            gl->draw_calls, gl->flushes);
+  snprintf (lines[n++], STATS_LINE_LENGTH, "Triangles: %lu, vertices: %lu",
+            gl->triangles, gl->vertices);
+  snprintf (lines[n++], STATS_LINE_LENGTH, "Instances: %lu",
+            gl->instances);
+  snprintf (lines[n++], STATS_LINE_LENGTH, "Retained uploads: %lu",
+            gl->retained_uploads);
+  snprintf (lines[n++], STATS_LINE_LENGTH, "R-tree nodes visited: %lu",
+            stats->rtree_nodes);
+  snprintf (lines[n++], STATS_LINE_LENGTH, "Tessellation cache: %lu/%lu hits (%.0f%%)",
+            gl->tess_cache_hits, tess_total,
+            tess_total ? 100. * gl->tess_cache_hits / tess_total : 100.);
+
+  return n;
+}
 
-  glEnable (GL_SCISSOR_TEST);
-  glScissor (ev->area.x,
-             allocation.height - ev->area.height - ev->area.y,
-             ev->area.width, ev->area.height);
+#define STATS_FONT "Monospace 9"
+#define STATS_LINE_HEIGHT 14
 
-  glMatrixMode (GL_PROJECTION);
-  glLoadIdentity ();
+/* Draws the statistics of the frame over the top left of the view */
+static void
+draw_stats (render_priv *priv, int width, int height)
+{
+  char lines[STATS_MAX_LINES][STATS_LINE_LENGTH];
+  int n_lines;
+  int i;
+  GLint program;
 
-  aspect = (float)allocation.width / (float)allocation.height;
+  if (priv->stats_font_base == 0)
+    {
+      PangoFontDescription *font_desc;
 
-#ifdef VIEW_ORTHO
-  glOrtho (-1. * aspect, 1. * aspect, 1., -1., 1., 24.);
-#else
-  glFrustum (-1. * aspect, 1 * aspect, 1., -1., 1., 24.);
-#endif
+      font_desc = pango_font_description_from_string (STATS_FONT);
+      priv->stats_font_base = glGenLists (128);
+      if (gdk_gl_font_use_pango_font (font_desc, 0, 128, priv->stats_font_base) == NULL)
+        {
+          fprintf (stderr, "DrawStats: Can't load font \"%s\"\n", STATS_FONT);
+          glDeleteLists (priv->stats_font_base, 128);
+          priv->stats_font_base = 0;
+          priv->show_stats = false;
+        }
+      pango_font_description_free (font_desc);
 
-  glMatrixMode (GL_MODELVIEW);
-  glLoadIdentity ();
+      if (priv->stats_font_base == 0)
+        return;
+    }
 
-#ifndef VIEW_ORTHO
-  /* TEST HACK */
-  glScalef (11., 11., 1.);
-#endif
+  n_lines = format_stats (&priv->stats, lines);
 
-  /* Push the space coordinates board back into the middle of the z-view volume */
-  /* XXX: THIS CAUSES NEED FOR SCALING BY 11 IN ghid_unproject_to_z_plane(), FOR ORTHO VIEW ONLY! */
-  glTranslatef (0., 0., -11.);
+  glGetIntegerv (GL_CURRENT_PROGRAM, &program);
+  hidgl_shader_activate (NULL);
 
-  /* Rotate about the center of the board space */
-  glMultMatrixf ((GLfloat *)view_matrix);
+  glPushAttrib (GL_ENABLE_BIT | GL_CURRENT_BIT | GL_LIST_BIT);
+  glDisable (GL_DEPTH_TEST);
+  glDisable (GL_STENCIL_TEST);
+  glDisable (GL_SCISSOR_TEST);
+  glDisable (GL_TEXTURE_2D);
 
-  /* Flip about the center of the viewed area */
-  glScalef ((port->view.flip_x ? -1. : 1.),
-            (port->view.flip_y ? -1. : 1.),
-            ((port->view.flip_x == port->view.flip_y) ? 1. : -1.));
+  glMatrixMode (GL_PROJECTION);
+  glPushMatrix ();
+  glLoadIdentity ();
+  glOrtho (0, width, height, 0, -1, 1);
+  glMatrixMode (GL_MODELVIEW);
+  glPushMatrix ();
+  glLoadIdentity ();
 
-  /* Scale board coordiantes to (-1,-1)-(1,1) coordiantes */
-  /* Adjust the "w" coordinate of our homogeneous coodinates. We coulld in
-   * theory just use glScalef to transform, but on mesa this produces errors
-   * as the resulting modelview matrix has a very small determinant.
-   */
-  scale[15] = port->view.coord_per_px * (float)MIN (widget->allocation.width, widget->allocation.height) / 2.;
-  /* XXX: Need to choose which to use (width or height) based on the aspect of the window
-   *      AND the aspect of the board!
-   */
-  glMultMatrixf (scale);
+  glColor4f (0., 0., 0., 0.6);
+  glRecti (0, 0, 40 * STATS_LINE_HEIGHT, (n_lines + 1) * STATS_LINE_HEIGHT);
 
-  /* Translate to the center of the board space view */
-  glTranslatef (-SIDE_X (port->view.x0 + port->view.width / 2),
-                -SIDE_Y (port->view.y0 + port->view.height / 2),
-                0.);
+  glColor4f (1., 1., 1., 1.);
+  glListBase (priv->stats_font_base);
+  for (i = 0; i < n_lines; i++)
+    {
+      glRasterPos2i (STATS_LINE_HEIGHT / 2, (i + 1) * STATS_LINE_HEIGHT);
+      glCallLists (strlen (lines[i]), GL_UNSIGNED_BYTE, lines[i]);
+    }
 
-  /* Stash the model view matrix so we can work out the screen coordinate -> board coordinate mapping */
-  glGetFloatv (GL_MODELVIEW_MATRIX, (GLfloat *)last_modelview_matrix);
-  glGetFloatv (GL_PROJECTION_MATRIX, (GLfloat *)last_projection_matrix);
+  glPopMatrix ();
+  glMatrixMode (GL_PROJECTION);
+  glPopMatrix ();
+  glMatrixMode (GL_MODELVIEW);
+  glPopAttrib ();
 
-#if 0
-  /* Fix up matrix so the board Z coordinate does not affect world Z
-   * this lets us view each stacked layer without parallax effects.
-   *
-   * Commented out because it breaks:
-   *   Board view "which side should I render first" calculation
-   *   Z-buffer depth occlusion when rendering component models
-   */
-  last_modelview_matrix[2][2] = 0.;
-  glLoadMatrixf ((GLfloat *)last_modelview_matrix);
-#endif
+  glUseProgram (program);
+}
+
+/* Draws the board, grid and any 3D models within the exposed area. This
+ * is everything in the view apart from the overlay (attached objects,
+ * marks, crosshair and lead user), so it may be cached by cache_scene ().
+ */
+static void
+draw_scene (GHidPort *port, GdkEventExpose *ev)
+{
+  render_priv *priv = port->render_priv;
+  BoxType region;
+  Coord min_x, min_y;
+  Coord max_x, max_y;
+  Coord new_x, new_y;
+  Coord min_depth;
+  Coord max_depth;
+  bool horizon_problem = false;
 
   glEnable (GL_STENCIL_TEST);
   glEnable (GL_DEPTH_TEST);
@@ -2339,11 +3412,6 @@ ghid_drawing_area_expose_cb (GtkWidget *widget,
   hidgl_set_depth (Output.fgGC, priv->edit_depth);
 
   ghid_draw_grid (Output.fgGC, &region);
-
-  ghid_invalidate_current_gc ();
-
-  DrawAttached (Output.fgGC);
-  DrawMark (Output.fgGC);
   hidgl_flush_triangles (priv->hidgl);
 
   glEnable (GL_LIGHTING);
@@ -2403,6 +3471,240 @@ ghid_drawing_area_expose_cb (GtkWidget *widget,
   glDisable (GL_LIGHT0);
   glDisable (GL_COLOR_MATERIAL);
   glDisable (GL_LIGHTING);
+}
+
+/* Whether the cached scene was drawn with the view we're about to draw */
+static bool
+scene_is_cached (render_priv *priv, int width, int height)
+{
+  return priv->scene_valid &&
+         priv->scene_width == width &&
+         priv->scene_height == height &&
+         memcmp (priv->scene_modelview, last_modelview_matrix,
+                 sizeof (last_modelview_matrix)) == 0 &&
+         memcmp (priv->scene_projection, last_projection_matrix,
+                 sizeof (last_projection_matrix)) == 0;
+}
+
+/* Copies the scene just drawn into a texture, so it can be redrawn
+ * without drawing the board when only the overlay changes.
+ */
+static void
+cache_scene (render_priv *priv, int width, int height)
+{
+  hidgl_flush_instances (priv->hidgl);
+  hidgl_flush_triangles (priv->hidgl);
+
+  if (priv->scene_texture == 0)
+    glGenTextures (1, &priv->scene_texture);
+
+  glBindTexture (GL_TEXTURE_2D, priv->scene_texture);
+
+  if (width != priv->scene_width || height != priv->scene_height)
+    {
+      glCopyTexImage2D (GL_TEXTURE_2D, 0, GL_RGB, 0, 0, width, height, 0);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+      glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    }
+  else
+    glCopyTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+  glBindTexture (GL_TEXTURE_2D, 0);
+
+  priv->scene_width = width;
+  priv->scene_height = height;
+  memcpy (priv->scene_modelview, last_modelview_matrix,
+          sizeof (last_modelview_matrix));
+  memcpy (priv->scene_projection, last_projection_matrix,
+          sizeof (last_projection_matrix));
+  priv->scene_valid = true;
+}
+
+/* Draws the scene saved by cache_scene () over the whole view */
+static void
+draw_cached_scene (render_priv *priv)
+{
+  GLint program;
+
+  glGetIntegerv (GL_CURRENT_PROGRAM, &program);
+  hidgl_shader_activate (NULL);
+
+  /* The overlay may use the stencil buffer to draw polygons */
+  glStencilMask (~0);
+  glClearStencil (0);
+  glClear (GL_STENCIL_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  hidgl_reset_stencil_usage (priv->hidgl);
+  glStencilMask (0);
+
+  glPushAttrib (GL_ENABLE_BIT | GL_TEXTURE_BIT);
+  glDisable (GL_DEPTH_TEST);
+  glDisable (GL_STENCIL_TEST);
+  glDisable (GL_BLEND);
+  glEnable (GL_TEXTURE_2D);
+  glBindTexture (GL_TEXTURE_2D, priv->scene_texture);
+  glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+  glMatrixMode (GL_PROJECTION);
+  glPushMatrix ();
+  glLoadIdentity ();
+  glMatrixMode (GL_MODELVIEW);
+  glPushMatrix ();
+  glLoadIdentity ();
+
+  glBegin (GL_QUADS);
+  glTexCoord2f (0., 0.);
+  glVertex2f (-1., -1.);
+  glTexCoord2f (1., 0.);
+  glVertex2f (1., -1.);
+  glTexCoord2f (1., 1.);
+  glVertex2f (1., 1.);
+  glTexCoord2f (0., 1.);
+  glVertex2f (-1., 1.);
+  glEnd ();
+
+  glPopMatrix ();
+  glMatrixMode (GL_PROJECTION);
+  glPopMatrix ();
+  glMatrixMode (GL_MODELVIEW);
+  glPopAttrib ();
+
+  glUseProgram (program);
+}
+
+gboolean
+ghid_drawing_area_expose_cb (GtkWidget *widget,
+                             GdkEventExpose *ev,
+                             GHidPort *port)
+{
+  render_priv *priv = port->render_priv;
+  GtkAllocation allocation;
+  float aspect;
+  GLfloat scale[] = {1, 0, 0, 0,
+                     0, 1, 0, 0,
+                     0, 0, 1, 0,
+                     0, 0, 0, 1};
+  unsigned long rtree_nodes;
+
+  gtk_widget_get_allocation (widget, &allocation);
+
+  ghid_start_drawing (port, widget);
+
+  g_timer_start (priv->frame_timer);
+  memset (priv->stats.group_drawn, 0, sizeof (priv->stats.group_drawn));
+  hidgl_reset_stats (priv->hidgl);
+  rtree_nodes = r_search_nodes_visited;
+
+  Output.fgGC = hid_draw_make_gc (&ghid_graphics);
+  Output.bgGC = hid_draw_make_gc (&ghid_graphics);
+  Output.pmGC = hid_draw_make_gc (&ghid_graphics);
+
+  /* If we don't have any stencil bits available,
+     we can't use the hidgl polygon drawing routine */
+  /* TODO: We could use the GLU tessellator though */
+  if (hidgl_stencil_bits (priv->hidgl) == 0)
+    ghid_graphics_class.fill_pcb_polygon = common_fill_pcb_polygon;
+
+  glEnable (GL_BLEND);
+  glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glViewport (0, 0, allocation.width, allocation.height);
+
+  glEnable (GL_SCISSOR_TEST);
+  glScissor (ev->area.x,
+             allocation.height - ev->area.height - ev->area.y,
+             ev->area.width, ev->area.height);
+
+  glMatrixMode (GL_PROJECTION);
+  glLoadIdentity ();
+
+  aspect = (float)allocation.width / (float)allocation.height;
+
+#ifdef VIEW_ORTHO
+  glOrtho (-1. * aspect, 1. * aspect, 1., -1., 1., 24.);
+#else
+  glFrustum (-1. * aspect, 1 * aspect, 1., -1., 1., 24.);
+#endif
+
+  glMatrixMode (GL_MODELVIEW);
+  glLoadIdentity ();
+
+#ifndef VIEW_ORTHO
+  /* TEST HACK */
+  glScalef (11., 11., 1.);
+#endif
+
+  /* Push the space coordinates board back into the middle of the z-view volume */
+  /* XXX: THIS CAUSES NEED FOR SCALING BY 11 IN ghid_unproject_to_z_plane(), FOR ORTHO VIEW ONLY! */
+  glTranslatef (0., 0., -11.);
+
+  /* Rotate about the center of the board space */
+  glMultMatrixf ((GLfloat *)view_matrix);
+
+  /* Flip about the center of the viewed area */
+  glScalef ((port->view.flip_x ? -1. : 1.),
+            (port->view.flip_y ? -1. : 1.),
+            ((port->view.flip_x == port->view.flip_y) ? 1. : -1.));
+
+  /* Scale board coordiantes to (-1,-1)-(1,1) coordiantes */
+  /* Adjust the "w" coordinate of our homogeneous coodinates. We coulld in
+   * theory just use glScalef to transform, but on mesa this produces errors
+   * as the resulting modelview matrix has a very small determinant.
+   */
+  scale[15] = port->view.coord_per_px * (float)MIN (widget->allocation.width, widget->allocation.height) / 2.;
+  /* XXX: Need to choose which to use (width or height) based on the aspect of the window
+   *      AND the aspect of the board!
+   */
+  glMultMatrixf (scale);
+
+  /* Translate to the center of the board space view */
+  glTranslatef (-SIDE_X (port->view.x0 + port->view.width / 2),
+                -SIDE_Y (port->view.y0 + port->view.height / 2),
+                0.);
+
+  /* Stash the model view matrix so we can work out the screen coordinate -> board coordinate mapping */
+  glGetFloatv (GL_MODELVIEW_MATRIX, (GLfloat *)last_modelview_matrix);
+  glGetFloatv (GL_PROJECTION_MATRIX, (GLfloat *)last_projection_matrix);
+
+#if 0
+  /* Fix up matrix so the board Z coordinate does not affect world Z
+   * this lets us view each stacked layer without parallax effects.
+   *
+   * Commented out because it breaks:
+   *   Board view "which side should I render first" calculation
+   *   Z-buffer depth occlusion when rendering component models
+   */
+  last_modelview_matrix[2][2] = 0.;
+  glLoadMatrixf ((GLfloat *)last_modelview_matrix);
+#endif
+
+  if (scene_is_cached (priv, allocation.width, allocation.height))
+    {
+      draw_cached_scene (priv);
+      priv->stats.scene_cached = true;
+    }
+  else
+    {
+      draw_scene (port, ev);
+
+      /* Only a scene covering the whole view can be reused */
+      if (ev->area.x == 0 && ev->area.y == 0 &&
+          ev->area.width == allocation.width &&
+          ev->area.height == allocation.height)
+        cache_scene (priv, allocation.width, allocation.height);
+      else
+        priv->scene_valid = false;
+
+      priv->stats.scene_cached = false;
+    }
+
+  /* Draw the overlay, which changes as the pointer moves */
+  hidgl_set_depth (Output.fgGC, priv->edit_depth);
+  ghid_invalidate_current_gc ();
+
+  DrawAttached (Output.fgGC);
+  DrawMark (Output.fgGC);
 
   draw_crosshair (Output.fgGC, priv);
 
@@ -2410,6 +3712,13 @@ ghid_drawing_area_expose_cb (GtkWidget *widget,
 
   draw_lead_user (Output.fgGC, priv);
 
+  priv->stats.frame_ms = 1000. * g_timer_elapsed (priv->frame_timer, NULL);
+  priv->stats.rtree_nodes = r_search_nodes_visited - rtree_nodes;
+  hidgl_get_stats (priv->hidgl, &priv->stats.gl);
+
+  if (priv->show_stats)
+    draw_stats (priv, allocation.width, allocation.height);
+
   ghid_end_drawing (port, widget);
 
   hid_draw_destroy_gc (Output.fgGC);
@@ -3149,7 +4458,7 @@ lead_user_cb (gpointer data)
   double elapsed_time;
 
   /* Queue a redraw */
-  ghid_invalidate_all ();
+  ghid_invalidate_overlay ();
 
   /* Update radius */
   elapsed_time = g_timer_elapsed (priv->lead_user_timer, NULL);
@@ -3191,9 +4500,79 @@ ghid_cancel_lead_user (void)
     g_timer_destroy (priv->lead_user_timer);
 
   if (priv->lead_user)
-    ghid_invalidate_all ();
+    ghid_invalidate_overlay ();
 
   priv->lead_user_timeout = 0;
   priv->lead_user_timer = NULL;
   priv->lead_user = false;
 }
+
+/* ------------------------------------------------------------ */
+
+static const char drawstats_syntax[] =
+"DrawStats()\n"
+"DrawStats(Show|Hide|Toggle)";
+
+static const char drawstats_help[] =
+N_("Reports statistics about drawing the last frame.");
+
+/* %start-doc actions DrawStats
+
+With no arguments, the timings and counts gathered whilst drawing the
+last frame are printed on standard output. These include the time
+spent drawing each layer group, the number of draw calls, triangles and
+vertices sent to the graphics card, the number of r-tree nodes searched
+and how often polygons were drawn from cached tessellations.
+
+@table @code
+
+@item Show
+Shows the same statistics over the top left of the board view,
+updated as each frame is drawn.
+
+@item Hide
+Hides the statistics again.
+
+@item Toggle
+Shows the statistics if they are hidden, otherwise hides them.
+
+@end table
+
+This action is only available with the OpenGL renderer.
+
+%end-doc */
+
+static int
+DrawStats (int argc, char **argv, Coord x, Coord y)
+{
+  render_priv *priv = gport->render_priv;
+  char lines[STATS_MAX_LINES][STATS_LINE_LENGTH];
+  int n_lines;
+  int i;
+
+  if (argc == 0)
+    {
+      n_lines = format_stats (&priv->stats, lines);
+      for (i = 0; i < n_lines; i++)
+        printf ("%s\n", lines[i]);
+      return 0;
+    }
+
+  if (strcasecmp (argv[0], "Show") == 0)
+    priv->show_stats = true;
+  else if (strcasecmp (argv[0], "Hide") == 0)
+    priv->show_stats = false;
+  else if (strcasecmp (argv[0], "Toggle") == 0)
+    priv->show_stats = !priv->show_stats;
+  else
+    AFAIL (drawstats);
+
+  ghid_invalidate_all ();
+  return 0;
+}
+
+HID_Action ghid_gl_action_list[] = {
+  {"DrawStats", 0, DrawStats, drawstats_help, drawstats_syntax}
+};
+
+REGISTER_ACTIONS (ghid_gl_action_list)
@@ -1175,6 +1175,7 @@ PCBChanged (int argc, char **argv, Coord x, Coord y)
     }
   RouteStylesChanged (0, NULL, 0, 0);
 
+  ghid_invalidate_caches ();
   ghid_port_ranges_scale ();
   ghid_zoom_view_fit ();
   ghid_sync_with_new_layout ();
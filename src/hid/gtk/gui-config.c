@@ -1488,6 +1488,7 @@ config_layers_apply (void)
 	  return;
 	}
       PCB->LayerGroups = layer_groups;
+      ghid_invalidate_caches ();
       ghid_invalidate_all();
       groups_modified = FALSE;
     }
@@ -1814,6 +1815,7 @@ config_color_defaults_cb (gpointer data)
   gtk_widget_destroy (config_colors_vbox);
   config_colors_tab_create (config_colors_tab_vbox);
 
+  ghid_invalidate_caches ();
   ghid_invalidate_all();
 }
 
@@ -1843,6 +1845,7 @@ config_color_load_cb (gpointer data)
   config_colors_tab_create (config_colors_tab_vbox);
 
   ghid_layer_buttons_color_update ();
+  ghid_invalidate_caches ();
   ghid_invalidate_all();
 }
 
@@ -1895,6 +1898,7 @@ config_color_set_cb (GtkWidget * button, ConfigColor * cc)
 
   ghid_set_special_colors (ha);
   ghid_layer_buttons_color_update ();
+  ghid_invalidate_caches ();
   ghid_invalidate_all();
 }
 
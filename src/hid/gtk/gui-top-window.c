@@ -552,6 +552,7 @@ layer_selector_select_callback (GHidLayerSelector *ls, int layer, gpointer d)
 
   ignore_layer_update = false;
 
+  ghid_invalidate_caches ();
   ghid_invalidate_all ();
 }
 
@@ -645,7 +646,10 @@ layer_selector_toggle_callback (GHidLayerSelector *ls, int layer, gpointer d)
   ignore_layer_update = false;
 
   if (redraw)
-    ghid_invalidate_all();
+    {
+      ghid_invalidate_caches ();
+      ghid_invalidate_all ();
+    }
 }
 
 /*! \brief Install menu bar and accelerator groups */
@@ -1880,6 +1884,7 @@ LayersChanged (int argc, char **argv, Coord x, Coord y)
   |  the way it will be when the pcb is reloaded.
   */
   pcb_colors_from_settings (PCB);
+  ghid_invalidate_caches ();
   return 0;
 }
 
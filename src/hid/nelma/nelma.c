@@ -100,23 +100,65 @@ typedef struct nelma_gc_struct {
 
 	EndCapStyle     cap;
 	Coord           width;
-	unsigned char   r, g, b;
 	int             erase;
-	struct color_struct *color;
-	gdImagePtr      brush;
 } *nelmaGC;
 
+/*
+ * The core's drawing code isn't reentrant, so each group is drawn on the
+ * main thread into a list of gd operations, already scaled to pixels.
+ * Worker threads render the lists into the groups' images and write them
+ * out, while the main thread goes on with the next group.
+ */
+
+/* upper bound on the groups rendered at once, each needs a whole image */
+#define MAX_NELMA_WORKERS 4
+
+typedef enum {
+	NELMA_OP_RECT,
+	NELMA_OP_FILL_RECT,
+	NELMA_OP_LINE,
+	NELMA_OP_ARC,
+	NELMA_OP_CIRCLE,
+	NELMA_OP_POLYGON
+} nelma_op_type;
+
+typedef struct nelma_op {
+	nelma_op_type   type;
+	int             erase;
+	/* Brush for lines and arcs: 'C'ircle or 'S'quare, and its size */
+	char            brush_type;
+	int             brush_r;
+	/* Line thickness of rectangle outlines */
+	int             thickness;
+	/* Corners, or the centre and size of arcs and circles */
+	int             x1, y1, x2, y2;
+	int             sa, ea;
+	int             n_points;
+	gdPoint        *points;
+} nelma_op;
+
+typedef struct nelma_job {
+	char           *filename;
+	int             w, h;
+	nelma_op       *ops;
+	int             n_ops, max_ops;
+} nelma_job;
+
+/* State of one image while a job is rendered into it */
+typedef struct nelma_render {
+	gdImagePtr      im;
+	struct color_struct white, black;
+	/* The gd brushes made so far, by size, shape and color */
+	GHashTable     *brushes;
+	gdImagePtr      lastbrush;
+} nelma_render;
+
 static HID nelma_hid;
 static HID_DRAW nelma_graphics;
 static HID_DRAW_CLASS nelma_graphics_class;
 
-static struct color_struct *black = NULL, *white = NULL;
-static Coord    linewidth = -1;
-static gdImagePtr lastbrush = (gdImagePtr)((void *) -1);
-
-/* gd image and file for PNG export */
-static gdImagePtr nelma_im = NULL;
-static FILE    *nelma_f = NULL;
+/* The group being drawn */
+static nelma_job *nelma_cur_job = NULL;
 
 static int      is_mask;
 static int      is_drill;
@@ -580,76 +622,164 @@ nelma_choose_groups()
 }
 
 static void 
-nelma_alloc_colors()
+nelma_alloc_colors(nelma_render *rd)
 {
 	/*
 	 * Allocate white and black -- the first color allocated becomes the
 	 * background color
 	 */
 
-	white = (struct color_struct *) malloc(sizeof(*white));
-	white->r = white->g = white->b = 255;
-	white->c = gdImageColorAllocate(nelma_im, white->r, white->g, white->b);
+	rd->white.r = rd->white.g = rd->white.b = 255;
+	rd->white.c = gdImageColorAllocate(rd->im, rd->white.r, rd->white.g, rd->white.b);
 
-	black = (struct color_struct *) malloc(sizeof(*black));
-	black->r = black->g = black->b = 0;
-	black->c = gdImageColorAllocate(nelma_im, black->r, black->g, black->b);
+	rd->black.r = rd->black.g = rd->black.b = 0;
+	rd->black.c = gdImageColorAllocate(rd->im, rd->black.r, rd->black.g, rd->black.b);
 }
 
-static void 
-nelma_start_png(const char *basename, const char *suffix)
+static void
+nelma_use_brush(nelma_render *rd, nelma_op *op)
 {
-	int             h, w;
-	char           *buf;
-
-	buf = nelma_get_png_name(basename, suffix);
+	struct color_struct *color = op->erase ? &rd->white : &rd->black;
+	gpointer        key;
+	gdImagePtr      brush;
+	int             r = op->brush_r;
+
+	key = GINT_TO_POINTER((r << 2) | ((op->brush_type == 'S') << 1) | op->erase);
+	brush = (gdImagePtr) g_hash_table_lookup(rd->brushes, key);
+	if (brush == NULL) {
+		int             bg, fg;
+		if (op->brush_type == 'C')
+			brush = gdImageCreate(2 * r + 1, 2 * r + 1);
+		else
+			brush = gdImageCreate(r + 1, r + 1);
+		bg = gdImageColorAllocate(brush, 255, 255, 255);
+		fg = gdImageColorAllocate(brush, color->r, color->g, color->b);
+		gdImageColorTransparent(brush, bg);
 
-	h = pcb_to_nelma(PCB->MaxHeight);
-	w = pcb_to_nelma(PCB->MaxWidth);
+		/*
+	         * if we shrunk to a radius/box width of zero, then just use
+	         * a single pixel to draw with.
+	         */
+		if (r == 0)
+			gdImageFilledRectangle(brush, 0, 0, 0, 0, fg);
+		else {
+			if (op->brush_type == 'C')
+				gdImageFilledEllipse(brush, r, r, 2 * r, 2 * r, fg);
+			else
+				gdImageFilledRectangle(brush, 0, 0, r, r, fg);
+		}
+		g_hash_table_insert(rd->brushes, key, brush);
+	}
+	if (brush != rd->lastbrush) {
+		gdImageSetBrush(rd->im, brush);
+		rd->lastbrush = brush;
+	}
+}
 
-	/* nelma_im = gdImageCreate (w, h); */
+/* Renders a group's drawing and writes its layer mask. */
+static void
+nelma_render_job(gpointer data, gpointer user_data)
+{
+	nelma_job      *job = (nelma_job *) data;
+	nelma_render    rd;
+	FILE           *f;
+	int             i;
 
 	/* Nelma only works with true color images */
-	nelma_im = gdImageCreate(w, h);
-	nelma_f = fopen(buf, "wb");
+	rd.im = gdImageCreate(job->w, job->h);
+	rd.brushes = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+					   (GDestroyNotify) gdImageDestroy);
+	rd.lastbrush = NULL;
+	nelma_alloc_colors(&rd);
+
+	for (i = 0; i < job->n_ops; i++) {
+		nelma_op       *op = &job->ops[i];
+		int             c = op->erase ? rd.white.c : rd.black.c;
+
+		switch (op->type) {
+		case NELMA_OP_RECT:
+			gdImageSetThickness(rd.im, op->thickness);
+			gdImageRectangle(rd.im, op->x1, op->y1, op->x2, op->y2, c);
+			break;
+		case NELMA_OP_FILL_RECT:
+			gdImageSetThickness(rd.im, 0);
+			gdImageFilledRectangle(rd.im, op->x1, op->y1, op->x2, op->y2, c);
+			break;
+		case NELMA_OP_LINE:
+			nelma_use_brush(&rd, op);
+			gdImageSetThickness(rd.im, 0);
+			gdImageLine(rd.im, op->x1, op->y1, op->x2, op->y2, gdBrushed);
+			break;
+		case NELMA_OP_ARC:
+			nelma_use_brush(&rd, op);
+			gdImageSetThickness(rd.im, 0);
+			gdImageArc(rd.im, op->x1, op->y1, op->x2, op->y2,
+				   op->sa, op->ea, gdBrushed);
+			break;
+		case NELMA_OP_CIRCLE:
+			gdImageSetThickness(rd.im, 0);
+			gdImageFilledEllipse(rd.im, op->x1, op->y1, op->x2, op->y2, c);
+			break;
+		case NELMA_OP_POLYGON:
+			gdImageSetThickness(rd.im, 0);
+			gdImageFilledPolygon(rd.im, op->points, op->n_points, c);
+			break;
+		}
+	}
 
-	nelma_alloc_colors();
+	f = fopen(job->filename, "wb");
+	if (f == NULL)
+		fprintf(stderr, "ERROR:  Could not open %s for writing.\n",
+			job->filename);
+	else {
+#ifdef HAVE_GDIMAGEPNG
+		gdImagePng(rd.im, f);
+#endif
+		fclose(f);
+	}
 
-	free(buf);
+	g_hash_table_destroy(rd.brushes);
+	gdImageDestroy(rd.im);
+
+	for (i = 0; i < job->n_ops; i++)
+		free(job->ops[i].points);
+	free(job->ops);
+	free(job->filename);
+	free(job);
 }
 
-static void 
-nelma_finish_png()
+static int
+nelma_worker_count(void)
 {
-#ifdef HAVE_GDIMAGEPNG
-	gdImagePng(nelma_im, nelma_f);
+#if GLIB_CHECK_VERSION (2, 36, 0)
+	return CLAMP(g_get_num_processors(), 1, MAX_NELMA_WORKERS);
 #else
-	Message("NELMA: PNG not supported by gd. Can't write layer mask.\n");
+	return 1;
 #endif
-	gdImageDestroy(nelma_im);
-	fclose(nelma_f);
-
-	free(white);
-	free(black);
-
-	nelma_im = NULL;
-	nelma_f = NULL;
 }
 
-void 
-nelma_start_png_export()
+/* Draws the current group into a new job. */
+static nelma_job *
+nelma_record_group(const char *basename, const char *suffix)
 {
 	BoxType         region;
+	nelma_job      *job;
+
+	job = (nelma_job *) calloc(1, sizeof(*job));
+	job->filename = nelma_get_png_name(basename, suffix);
+	job->h = pcb_to_nelma(PCB->MaxHeight);
+	job->w = pcb_to_nelma(PCB->MaxWidth);
 
 	region.X1 = 0;
 	region.Y1 = 0;
 	region.X2 = PCB->MaxWidth;
 	region.Y2 = PCB->MaxHeight;
 
-	linewidth = -1;
-	lastbrush = (gdImagePtr)((void *) -1);
-
+	nelma_cur_job = job;
 	hid_expose_callback(&nelma_graphics, &region, 0);
+	nelma_cur_job = NULL;
+
+	return job;
 }
 
 static void 
@@ -660,6 +790,8 @@ nelma_do_export(HID_Attr_Val * options)
 	FILE           *nelma_config;
 	char           *buf;
 	int             len;
+	int             n_workers;
+	GThreadPool    *pool;
 
 	time_t          t;
 
@@ -685,8 +817,18 @@ nelma_do_export(HID_Attr_Val * options)
 
 	nelma_choose_groups();
 
+#ifndef HAVE_GDIMAGEPNG
+	Message("NELMA: PNG not supported by gd. Can't write layer mask.\n");
+#endif
+
+	n_workers = nelma_worker_count();
+	pool = NULL;
+	if (n_workers > 1)
+		pool = g_thread_pool_new(nelma_render_job, NULL, n_workers, TRUE, NULL);
+
 	for (i = 0; i < MAX_GROUP; i++) {
 		if (nelma_export_group[i]) {
+			nelma_job      *job;
 
 			nelma_cur_group = i;
 
@@ -694,17 +836,22 @@ nelma_do_export(HID_Attr_Val * options)
 			idx = (i >= 0 && i < max_group) ?
 				PCB->LayerGroups.Entries[i][0] : i;
 
-			nelma_start_png(nelma_basename,
-					layer_type_to_file_name(idx, FNS_fixed));
-
 			hid_save_and_show_layer_ons(save_ons);
-			nelma_start_png_export();
+			job = nelma_record_group(nelma_basename,
+					layer_type_to_file_name(idx, FNS_fixed));
 			hid_restore_layer_ons(save_ons);
 
-			nelma_finish_png();
+			if (pool)
+				g_thread_pool_push(pool, job, NULL);
+			else
+				nelma_render_job(job, NULL);
 		}
 	}
 
+	/* wait for every layer mask to be written */
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
 	len = strlen(nelma_basename) + 4;
 	buf = (char *)malloc(sizeof(*buf) * len);
 
@@ -771,9 +918,6 @@ nelma_make_gc(void)
 
 	nelma_gc->cap = Trace_Cap;
 	nelma_gc->width = 1;
-	nelma_gc->color = (struct color_struct *) malloc(sizeof(*nelma_gc->color));
-	nelma_gc->color->r = nelma_gc->color->g = nelma_gc->color->b = 0;
-	nelma_gc->color->c = 0;
 
 	return gc;
 }
@@ -795,24 +939,21 @@ nelma_set_color(hidGC gc, const char *name)
 {
 	nelmaGC nelma_gc = (nelmaGC)gc;
 
-	if (nelma_im == NULL) {
+	if (nelma_cur_job == NULL) {
 		return;
 	}
 	if (name == NULL) {
 		name = "#ff0000";
 	}
 	if (!strcmp(name, "drill")) {
-		nelma_gc->color = black;
 		nelma_gc->erase = 0;
 		return;
 	}
 	if (!strcmp(name, "erase")) {
 		/* FIXME -- should be background, not white */
-		nelma_gc->color = white;
 		nelma_gc->erase = 1;
 		return;
 	}
-	nelma_gc->color = black;
 	nelma_gc->erase = 0;
 	return;
 }
@@ -844,124 +985,84 @@ nelma_set_draw_faded(hidGC gc, int faded)
 {
 }
 
-static void
-use_gc(hidGC gc)
+static nelma_op *
+add_op(hidGC gc, nelma_op_type type)
 {
 	nelmaGC nelma_gc = (nelmaGC)gc;
-	int             need_brush = 0;
+	nelma_job      *job = nelma_cur_job;
+	nelma_op       *op;
 
 	if (gc->hid != &nelma_hid) {
 		fprintf(stderr, "Fatal: GC from another HID passed to nelma HID\n");
 		abort();
 	}
-	if (linewidth != nelma_gc->width) {
-		/* Make sure the scaling doesn't erase lines completely */
-		/*
-	        if (SCALE (nelma_gc->width) == 0 && nelma_gc->width > 0)
-		  gdImageSetThickness (im, 1);
-	        else
-	        */
-		gdImageSetThickness(nelma_im, pcb_to_nelma(nelma_gc->width));
-		linewidth = nelma_gc->width;
-		need_brush = 1;
-	}
-	if (lastbrush != nelma_gc->brush || need_brush) {
-		static void    *bcache = 0;
-		hidval          bval;
-		char            name[256];
-		char            type;
-		int             r;
-
-		switch (nelma_gc->cap) {
-		case Round_Cap:
-		case Trace_Cap:
-			type = 'C';
-			r = pcb_to_nelma(nelma_gc->width / 2);
-			break;
-		default:
-		case Square_Cap:
-			r = pcb_to_nelma(nelma_gc->width);
-			type = 'S';
-			break;
-		}
-		sprintf(name, "#%.2x%.2x%.2x_%c_%d", nelma_gc->color->r, nelma_gc->color->g,
-			nelma_gc->color->b, type, r);
-
-		if (hid_cache_color(0, name, &bval, &bcache)) {
-		  nelma_gc->brush = (gdImagePtr)bval.ptr;
-		} else {
-			int             bg, fg;
-			if (type == 'C')
-				nelma_gc->brush = gdImageCreate(2 * r + 1, 2 * r + 1);
-			else
-				nelma_gc->brush = gdImageCreate(r + 1, r + 1);
-			bg = gdImageColorAllocate(nelma_gc->brush, 255, 255, 255);
-			fg =
-				gdImageColorAllocate(nelma_gc->brush, nelma_gc->color->r, nelma_gc->color->g,
-						     nelma_gc->color->b);
-			gdImageColorTransparent(nelma_gc->brush, bg);
-
-			/*
-		         * if we shrunk to a radius/box width of zero, then just use
-		         * a single pixel to draw with.
-		         */
-			if (r == 0)
-				gdImageFilledRectangle(nelma_gc->brush, 0, 0, 0, 0, fg);
-			else {
-				if (type == 'C')
-					gdImageFilledEllipse(nelma_gc->brush, r, r, 2 * r, 2 * r, fg);
-				else
-					gdImageFilledRectangle(nelma_gc->brush, 0, 0, r, r, fg);
-			}
-			bval.ptr = nelma_gc->brush;
-			hid_cache_color(1, name, &bval, &bcache);
+	if (job->n_ops == job->max_ops) {
+		job->max_ops = job->max_ops ? 2 * job->max_ops : 1024;
+		job->ops = (nelma_op *) realloc(job->ops, job->max_ops * sizeof(nelma_op));
+		if (job->ops == NULL) {
+			fprintf(stderr, "ERROR:  add_op():  realloc failed\n");
+			exit(1);
 		}
-
-		gdImageSetBrush(nelma_im, nelma_gc->brush);
-		lastbrush = nelma_gc->brush;
-
 	}
+	op = &job->ops[job->n_ops++];
+	memset(op, 0, sizeof(*op));
+	op->type = type;
+	op->erase = nelma_gc->erase;
+	op->thickness = pcb_to_nelma(nelma_gc->width);
+
+	switch (nelma_gc->cap) {
+	case Round_Cap:
+	case Trace_Cap:
+		op->brush_type = 'C';
+		op->brush_r = pcb_to_nelma(nelma_gc->width / 2);
+		break;
+	default:
+	case Square_Cap:
+		op->brush_r = pcb_to_nelma(nelma_gc->width);
+		op->brush_type = 'S';
+		break;
+	}
+	return op;
 }
 
 static void
 nelma_draw_rect(hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
 {
-	nelmaGC nelma_gc = (nelmaGC)gc;
+	nelma_op       *op = add_op(gc, NELMA_OP_RECT);
 
-	use_gc(gc);
-	gdImageRectangle(nelma_im,
-			 pcb_to_nelma(x1), pcb_to_nelma(y1),
-			 pcb_to_nelma(x2), pcb_to_nelma(y2), nelma_gc->color->c);
+	op->x1 = pcb_to_nelma(x1);
+	op->y1 = pcb_to_nelma(y1);
+	op->x2 = pcb_to_nelma(x2);
+	op->y2 = pcb_to_nelma(y2);
 }
 
 static void
 nelma_fill_rect(hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
 {
-	nelmaGC nelma_gc = (nelmaGC)gc;
+	nelma_op       *op = add_op(gc, NELMA_OP_FILL_RECT);
 
-	use_gc(gc);
-	gdImageSetThickness(nelma_im, 0);
-	linewidth = 0;
-	gdImageFilledRectangle(nelma_im, pcb_to_nelma(x1), pcb_to_nelma(y1),
-			  pcb_to_nelma(x2), pcb_to_nelma(y2), nelma_gc->color->c);
+	op->x1 = pcb_to_nelma(x1);
+	op->y1 = pcb_to_nelma(y1);
+	op->x2 = pcb_to_nelma(x2);
+	op->y2 = pcb_to_nelma(y2);
 }
 
 static void
 nelma_draw_line(hidGC gc, Coord x1, Coord y1, Coord x2, Coord y2)
 {
 	nelmaGC nelma_gc = (nelmaGC)gc;
+	nelma_op       *op;
 
 	if (x1 == x2 && y1 == y2) {
 		Coord             w = nelma_gc->width / 2;
 		nelma_fill_rect(gc, x1 - w, y1 - w, x1 + w, y1 + w);
 		return;
 	}
-	use_gc(gc);
-
-	gdImageSetThickness(nelma_im, 0);
-	linewidth = 0;
-	gdImageLine(nelma_im, pcb_to_nelma(x1), pcb_to_nelma(y1),
-		    pcb_to_nelma(x2), pcb_to_nelma(y2), gdBrushed);
+	op = add_op(gc, NELMA_OP_LINE);
+	op->x1 = pcb_to_nelma(x1);
+	op->y1 = pcb_to_nelma(y1);
+	op->x2 = pcb_to_nelma(x2);
+	op->y2 = pcb_to_nelma(y2);
 }
 
 static void
@@ -969,6 +1070,7 @@ nelma_draw_arc(hidGC gc, Coord cx, Coord cy, Coord width, Coord height,
 	       Angle start_angle, Angle delta_angle)
 {
 	Angle sa, ea;
+	nelma_op       *op;
 
 	/*
 	 * in gdImageArc, 0 degrees is to the right and +90 degrees is down
@@ -991,55 +1093,41 @@ nelma_draw_arc(hidGC gc, Coord cx, Coord cy, Coord width, Coord height,
         sa = NormalizeAngle (sa);
         ea = NormalizeAngle (ea);
 
-#if 0
-	printf("draw_arc %d,%d %dx%d %d..%d %d..%d\n",
-	       cx, cy, width, height, start_angle, delta_angle, sa, ea);
-	printf("gdImageArc (%p, %d, %d, %d, %d, %d, %d, %d)\n",
-	       im, SCALE_X(cx), SCALE_Y(cy),
-	       SCALE(width), SCALE(height), sa, ea, nelma_gc->color->c);
-#endif
-	use_gc(gc);
-	gdImageSetThickness(nelma_im, 0);
-	linewidth = 0;
-	gdImageArc(nelma_im, pcb_to_nelma(cx), pcb_to_nelma(cy),
-		   pcb_to_nelma(2 * width), pcb_to_nelma(2 * height), sa, ea, gdBrushed);
+	op = add_op(gc, NELMA_OP_ARC);
+	op->x1 = pcb_to_nelma(cx);
+	op->y1 = pcb_to_nelma(cy);
+	op->x2 = pcb_to_nelma(2 * width);
+	op->y2 = pcb_to_nelma(2 * height);
+	op->sa = sa;
+	op->ea = ea;
 }
 
 static void
 nelma_fill_circle(hidGC gc, Coord cx, Coord cy, Coord radius)
 {
-	nelmaGC nelma_gc = (nelmaGC)gc;
-
-	use_gc(gc);
-
-	gdImageSetThickness(nelma_im, 0);
-	linewidth = 0;
-	gdImageFilledEllipse(nelma_im, pcb_to_nelma(cx), pcb_to_nelma(cy),
-	  pcb_to_nelma(2 * radius), pcb_to_nelma(2 * radius), nelma_gc->color->c);
+	nelma_op       *op = add_op(gc, NELMA_OP_CIRCLE);
 
+	op->x1 = pcb_to_nelma(cx);
+	op->y1 = pcb_to_nelma(cy);
+	op->x2 = op->y2 = pcb_to_nelma(2 * radius);
 }
 
 static void
 nelma_fill_polygon(hidGC gc, int n_coords, Coord *x, Coord *y)
 {
-	nelmaGC nelma_gc = (nelmaGC)gc;
+	nelma_op       *op = add_op(gc, NELMA_OP_POLYGON);
 	int             i;
-	gdPoint        *points;
 
-	points = (gdPoint *) malloc(n_coords * sizeof(gdPoint));
-	if (points == NULL) {
+	op->points = (gdPoint *) malloc(n_coords * sizeof(gdPoint));
+	if (op->points == NULL) {
 		fprintf(stderr, "ERROR:  nelma_fill_polygon():  malloc failed\n");
 		exit(1);
 	}
-	use_gc(gc);
 	for (i = 0; i < n_coords; i++) {
-		points[i].x = pcb_to_nelma(x[i]);
-		points[i].y = pcb_to_nelma(y[i]);
+		op->points[i].x = pcb_to_nelma(x[i]);
+		op->points[i].y = pcb_to_nelma(y[i]);
 	}
-	gdImageSetThickness(nelma_im, 0);
-	linewidth = 0;
-	gdImageFilledPolygon(nelma_im, points, n_coords, nelma_gc->color->c);
-	free(points);
+	op->n_points = n_coords;
 }
 
 static void
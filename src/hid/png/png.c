@@ -70,9 +70,12 @@ static double scale = 1;
 static Coord x_shift = 0;
 static Coord y_shift = 0;
 static int show_bottom_side;
+/* Image row drawn at the top of the image being drawn into; only
+   non-zero while photo mode is drawing the layers in bands.  */
+static int band_top = 0;
 #define SCALE(w)   ((int)round((w)/scale))
 #define SCALE_X(x) ((int)round(((x) - x_shift)/scale))
-#define SCALE_Y(y) ((int)round(((show_bottom_side ? (PCB->MaxHeight-(y)) : (y)) - y_shift)/scale))
+#define SCALE_Y(y) ((int)round(((show_bottom_side ? (PCB->MaxHeight-(y)) : (y)) - y_shift)/scale) - band_top)
 #define SWAP_IF_SOLDER(a,b) do { Coord c; if (show_bottom_side) { c=a; a=b; b=c; }} while (0)
 
 /* Used to detect non-trivial outlines */
@@ -81,6 +84,7 @@ static int show_bottom_side;
 #define NOT_EDGE(x,y) (NOT_EDGE_X(x) || NOT_EDGE_Y(y))
 
 static void png_fill_circle (hidGC gc, Coord cx, Coord cy, Coord radius);
+static void photo_expose (HID_Attr_Val * options);
 
 /* The result of a failed gdImageColorAllocate() call */
 #define BADC -1
@@ -135,6 +139,17 @@ static gdImagePtr photo_outline;
 static int photo_groups[MAX_LAYER + EXTRA_LAYERS], photo_ngroups;
 static int photo_has_inners;
 
+/* With --photo-tile-rows, the outline is drawn first at full size,
+   since it is flood filled from the edges of the image.  The other
+   layers are then drawn and composited a band of rows at a time, so
+   only one band of each of them is held in memory.  */
+#define PHOTO_PASS_ALL		0
+#define PHOTO_PASS_OUTLINE	1
+#define PHOTO_PASS_LAYERS	2
+
+static int photo_pass, photo_tile_rows;
+static int photo_w, photo_h;	/* size of the photo layer images */
+
 static int doing_outline, have_outline;
 
 #define FMT_gif "GIF"
@@ -444,6 +459,20 @@ In photo-realistic mode, export the silk screen as this colour. Parameter
    HID_Enum, 0, 0, {0, 0, 0}, silk_colour_names, 0},
 #define HA_photo_silk_colour 17
 
+/* %start-doc options "93 PNG Options"
+@ftable @code
+@cindex photo-tile-rows
+@item --photo-tile-rows <num>
+In photo-realistic mode, draw the layers in bands of this many rows of
+pixels.  This bounds the memory used for the intermediate layer images
+of large, high resolution exports.  0 draws the whole image at once.
+@end ftable
+%end-doc
+*/
+  {"photo-tile-rows", "Rows of pixels drawn at a time in photo-mode, 0 for all",
+   HID_Integer, 0, 10000, {0, 0, 0}, 0, 0},
+#define HA_photo_tile_rows 18
+
   {"ben-mode", ATTR_UNDOCUMENTED,
    HID_Boolean, 0, 0, {0, 0, 0}, 0, 0},
 #define HA_ben_mode 12
@@ -655,7 +684,10 @@ png_hid_export_to_file (FILE * the_file, HID_Attr_Val * options)
 	}
     }
 
-  hid_expose_callback (&png_graphics, bounds, 0);
+  if (photo_mode)
+    photo_expose (options);
+  else
+    hid_expose_callback (&png_graphics, bounds, 0);
 
   memcpy (LayerStack, saved_layer_stack, sizeof (LayerStack));
   PCB->Flags = save_flags;
@@ -782,6 +814,337 @@ ts_bs_sm (gdImagePtr im)
       }
 }
 
+/* Flood fill the outside of the board outline, to make it transparent */
+static void
+photo_fill_outline (void)
+{
+  int x, y;
+
+  im = master_im;
+
+  if (photo_outline && have_outline) {
+    int black=gdImageColorResolve(photo_outline, 0x00, 0x00, 0x00);
+
+    // go all the way around the image, trying to fill the outline
+    for (x=0; x<gdImageSX(im); x++) {
+      gdImageFillToBorder(photo_outline, x, 0, black, black);
+      gdImageFillToBorder(photo_outline, x, gdImageSY(im)-1, black, black);
+    }
+    for (y=1; y<gdImageSY(im)-1; y++) {
+      gdImageFillToBorder(photo_outline, 0, y, black, black);
+      gdImageFillToBorder(photo_outline, gdImageSX(im)-1, y, black, black);
+
+    }
+  }
+}
+
+/* Composite image rows first_row .. first_row + n_rows - 1 from the
+   photo layer images, whose top row is image row band_top.  */
+static void
+photo_composite (HID_Attr_Val * options, int first_row, int n_rows)
+{
+  int x, y;
+  color_struct white, black, fr4;
+
+  rgb (&white, 255, 255, 255);
+  rgb (&black, 0, 0, 0);
+  rgb (&fr4, 70, 70, 70);
+
+  im = master_im;
+
+  ts_bs (photo_copper[photo_groups[0]]);
+  ts_bs (photo_silk);
+  ts_bs_sm (photo_mask);
+
+  for (x=0; x<gdImageSX (im); x++) 
+    {
+      for (y=first_row; y<first_row + n_rows; y++)
+	{
+	  color_struct p, cop;
+	  color_struct mask_colour, silk_colour;
+	  int cc, mask, silk;
+	  int transparent;
+	     
+	  if (photo_outline && have_outline) {
+	    transparent=gdImageGetPixel(photo_outline, x, y);	      
+	  } else {
+	    transparent=0;
+	  }
+
+	  mask = photo_mask ? gdImageGetPixel (photo_mask, x, y - band_top) : 0;
+	  silk = photo_silk ? gdImageGetPixel (photo_silk, x, y - band_top) : 0;
+
+	  if (photo_copper[photo_groups[1]]
+	      && gdImageGetPixel (photo_copper[photo_groups[1]], x, y - band_top))
+	    rgb (&cop, 40, 40, 40);
+	  else
+	    rgb (&cop, 100, 100, 110);
+
+	  if (photo_ngroups == 2)
+	    blend (&cop, 0.3, &cop, &fr4);
+	      
+	  cc = gdImageGetPixel (photo_copper[photo_groups[0]], x, y - band_top);
+	  if (cc)
+	    {
+	      int r;
+		  
+	      if (mask)
+		rgb (&cop, 220, 145, 230);
+	      else
+		{
+		  if (options[HA_photo_plating].int_value == PLATING_GOLD)
+		    {
+		      // ENIG
+		      rgb (&cop, 185, 146, 52);
+
+		      // increase top shadow to increase shininess
+		      if (cc == TOP_SHADOW)
+			blend (&cop, 0.7, &cop, &white);
+		    }
+		  else if (options[HA_photo_plating].int_value == PLATING_TIN)
+		    {
+		      // tinned
+		      rgb (&cop, 140, 150, 160);
+
+		      // add some variation to make it look more matte
+		      r = (rand() % 5 - 2) * 2;
+		      cop.r += r;
+		      cop.g += r;
+		      cop.b += r;
+		    }
+		  else if (options[HA_photo_plating].int_value == PLATING_SILVER)
+		    {
+		      // silver
+		      rgb (&cop, 192, 192, 185);
+
+		      // increase top shadow to increase shininess
+		      if (cc == TOP_SHADOW)
+			blend (&cop, 0.7, &cop, &white);
+		    }
+		  else if (options[HA_photo_plating].int_value == PLATING_COPPER)
+		    {
+		      // copper
+		      rgb (&cop, 184, 115, 51);
+
+		      // increase top shadow to increase shininess
+		      if (cc == TOP_SHADOW)
+			blend (&cop, 0.7, &cop, &white);
+		    }
+		}
+		  
+	      if (cc == TOP_SHADOW)
+		blend (&cop, 0.7, &cop, &white);
+	      if (cc == BOTTOM_SHADOW)
+		blend (&cop, 0.7, &cop, &black);
+	    }
+
+	  if (photo_drill && !gdImageGetPixel (photo_drill, x, y - band_top)) 
+	    {		
+	      rgb (&p, 0, 0, 0);
+	      transparent=1;
+	    }
+	  else if (silk)
+	    {
+	      silk_colour = silk_colours[options[HA_photo_silk_colour].int_value];
+	      blend (&p, 1.0, &silk_colour, &silk_colour);
+	      if (silk == TOP_SHADOW)
+		add (&p, 1.0, &p, 1.0, &silk_top_shadow);
+	      else if (silk == BOTTOM_SHADOW)
+		subtract (&p, 1.0, &p, 1.0, &silk_bottom_shadow);
+	    }
+	  else if (mask)
+	    {
+	      p = cop;
+	      mask_colour = mask_colours[options[HA_photo_mask_colour].int_value];
+	      multiply (&p, &p, &mask_colour);
+	      add (&p, 1, &p, 0.2, &mask_colour);
+	      if (mask == TOP_SHADOW)
+		blend (&p, 0.7, &p, &white);
+	      if (mask == BOTTOM_SHADOW)
+		blend (&p, 0.7, &p, &black);
+	    }
+	  else
+	    p = cop;
+	      
+	  if (options[HA_use_alpha].int_value) {
+
+	    cc = (transparent)?\
+	      gdImageColorResolveAlpha(im, 0, 0, 0, 127):\
+	      gdImageColorResolveAlpha(im, p.r, p.g, p.b, 0);
+
+	  } else {
+	    cc = (transparent)?\
+	      gdImageColorResolve(im, 0, 0, 0):\
+	      gdImageColorResolve(im, p.r, p.g, p.b);
+	  }		  
+
+	  if (photo_flip == PHOTO_FLIP_X)
+	    gdImageSetPixel (im, gdImageSX (im) - x - 1, y, cc);
+	  else if (photo_flip == PHOTO_FLIP_Y)
+	    gdImageSetPixel (im, x, gdImageSY (im) - y - 1, cc);
+	  else
+	    gdImageSetPixel (im, x, y, cc);
+	}
+    }
+}
+
+static void
+photo_free_layers (void)
+{
+  int i;
+
+  for (i = 0; i < MAX_LAYER + EXTRA_LAYERS; i++)
+    if (photo_copper[i])
+      {
+	gdImageDestroy (photo_copper[i]);
+	photo_copper[i] = NULL;
+      }
+  if (photo_silk)
+    gdImageDestroy (photo_silk);
+  if (photo_mask)
+    gdImageDestroy (photo_mask);
+  if (photo_drill)
+    gdImageDestroy (photo_drill);
+  photo_silk = photo_mask = photo_drill = NULL;
+}
+
+/* Rows of pixels beyond a band that must be drawn for the band to come
+   out the same as in a full size image.  gd clips lines to the image
+   before applying the brush, so strokes centred outside the image
+   would lose the part that reaches into it, and the shadows look two
+   pixels further.  */
+static int
+photo_band_margin (void)
+{
+  Coord widest = 0;
+  Coord font_widest = 0;
+  int text_scale = 0;
+  int i;
+
+  ALLLINE_LOOP (PCB->Data);
+  {
+    MAKEMAX (widest, line->Thickness);
+  }
+  ENDALL_LOOP;
+  ALLARC_LOOP (PCB->Data);
+  {
+    MAKEMAX (widest, arc->Thickness);
+  }
+  ENDALL_LOOP;
+  ALLPAD_LOOP (PCB->Data);
+  {
+    MAKEMAX (widest, MAX (pad->Thickness, pad->Mask));
+  }
+  ENDALL_LOOP;
+  ELEMENT_LOOP (PCB->Data);
+  {
+    ELEMENTLINE_LOOP (element);
+    {
+      MAKEMAX (widest, line->Thickness);
+    }
+    END_LOOP;
+    ELEMENTARC_LOOP (element);
+    {
+      MAKEMAX (widest, arc->Thickness);
+    }
+    END_LOOP;
+    ELEMENTTEXT_LOOP (element);
+    {
+      MAKEMAX (text_scale, text->Scale);
+    }
+    END_LOOP;
+  }
+  END_LOOP;
+  for (i = 0; i < max_copper_layer + EXTRA_LAYERS; i++)
+    {
+      TEXT_LOOP (PCB->Data->Layer + i);
+      {
+	MAKEMAX (text_scale, text->Scale);
+      }
+      END_LOOP;
+    }
+
+  for (i = 0; i <= MAX_FONTPOSITION; i++)
+    {
+      SymbolType *symbol = &PCB->Font.Symbol[i];
+      Cardinal n;
+
+      for (n = 0; n < symbol->LineN; n++)
+	MAKEMAX (font_widest, symbol->Line[n].Thickness);
+    }
+  MAKEMAX (widest, font_widest * text_scale / 100);
+
+  return SCALE (widest / 2 + bloat) + 3;
+}
+
+/* Draw the photo layers and composite them into master_im */
+static void
+photo_expose (HID_Attr_Val * options)
+{
+  int height = gdImageSY (master_im);
+  int first_row, n_rows, margin;
+  Coord top, bottom, c;
+  BoxType region;
+
+  photo_w = gdImageSX (master_im);
+  photo_h = height;
+  band_top = 0;
+
+  if (photo_tile_rows <= 0 || photo_tile_rows >= height)
+    {
+      photo_pass = PHOTO_PASS_ALL;
+      hid_expose_callback (&png_graphics, bounds, 0);
+      photo_fill_outline ();
+      photo_composite (options, 0, height);
+      photo_free_layers ();
+    }
+  else
+    {
+      photo_pass = PHOTO_PASS_OUTLINE;
+      hid_expose_callback (&png_graphics, bounds, 0);
+      photo_fill_outline ();
+
+      photo_pass = PHOTO_PASS_LAYERS;
+      margin = photo_band_margin ();
+      region = *bounds;
+      for (first_row = 0; first_row < height; first_row += photo_tile_rows)
+	{
+	  n_rows = MIN (photo_tile_rows, height - first_row);
+	  band_top = first_row - margin;
+	  photo_h = n_rows + 2 * margin;
+
+	  /* Only draw the objects that reach into this band, mapping its
+	   * rows back to the board as SCALE_Y does */
+	  top = y_shift + (band_top - 1) * scale;
+	  bottom = y_shift + (band_top + photo_h + 1) * scale;
+	  if (show_bottom_side)
+	    {
+	      c = top;
+	      top = PCB->MaxHeight - bottom;
+	      bottom = PCB->MaxHeight - c;
+	    }
+	  region.Y1 = MAX (bounds->Y1, top);
+	  region.Y2 = MIN (bounds->Y2, bottom);
+
+	  linewidth = -1;
+	  lastbrush = (gdImagePtr)((void *) -1);
+	  lastcap = -1;
+	  hid_expose_callback (&png_graphics, &region, 0);
+
+	  photo_composite (options, first_row, n_rows);
+	  photo_free_layers ();
+	}
+      band_top = 0;
+      photo_pass = PHOTO_PASS_ALL;
+    }
+
+  if (photo_outline)
+    {
+      gdImageDestroy (photo_outline);
+      photo_outline = NULL;
+    }
+}
+
 static void
 png_do_export (HID_Attr_Val * options)
 {
@@ -823,6 +1186,7 @@ png_do_export (HID_Attr_Val * options)
       memset (photo_copper, 0, sizeof(photo_copper));
       photo_silk = photo_mask = photo_drill = 0;
       photo_outline = 0;
+      photo_tile_rows = options[HA_photo_tile_rows].int_value;
       if (options[HA_photo_flip_x].int_value
 	  || options[HA_ben_flip_x].int_value)
 	photo_flip = PHOTO_FLIP_X;
@@ -987,169 +1351,6 @@ png_do_export (HID_Attr_Val * options)
   if (!options[HA_as_shown].int_value)
     hid_restore_layer_ons (save_ons);
 
-  if (photo_mode)
-    {
-      int x, y;
-      color_struct white, black, fr4;
-
-      rgb (&white, 255, 255, 255);
-      rgb (&black, 0, 0, 0);
-      rgb (&fr4, 70, 70, 70);
-
-      im = master_im;
-
-      ts_bs (photo_copper[photo_groups[0]]);
-      ts_bs (photo_silk);
-      ts_bs_sm (photo_mask);
-
-      if (photo_outline && have_outline) {
-	int black=gdImageColorResolve(photo_outline, 0x00, 0x00, 0x00);
-
-	// go all the way around the image, trying to fill the outline
-	for (x=0; x<gdImageSX(im); x++) {
-	  gdImageFillToBorder(photo_outline, x, 0, black, black);
-	  gdImageFillToBorder(photo_outline, x, gdImageSY(im)-1, black, black);
-	}
-	for (y=1; y<gdImageSY(im)-1; y++) {
-	  gdImageFillToBorder(photo_outline, 0, y, black, black);
-	  gdImageFillToBorder(photo_outline, gdImageSX(im)-1, y, black, black);
-
-	}
-      }
-
-
-      for (x=0; x<gdImageSX (im); x++) 
-	{
-	  for (y=0; y<gdImageSY (im); y++)
-	    {
-	      color_struct p, cop;
-	      color_struct mask_colour, silk_colour;
-	      int cc, mask, silk;
-	      int transparent;
-	     
-	      if (photo_outline && have_outline) {
-		transparent=gdImageGetPixel(photo_outline, x, y);	      
-	      } else {
-		transparent=0;
-	      }
-
-	      mask = photo_mask ? gdImageGetPixel (photo_mask, x, y) : 0;
-	      silk = photo_silk ? gdImageGetPixel (photo_silk, x, y) : 0;
-
-	      if (photo_copper[photo_groups[1]]
-		  && gdImageGetPixel (photo_copper[photo_groups[1]], x, y))
-		rgb (&cop, 40, 40, 40);
-	      else
-		rgb (&cop, 100, 100, 110);
-
-	      if (photo_ngroups == 2)
-		blend (&cop, 0.3, &cop, &fr4);
-	      
-	      cc = gdImageGetPixel (photo_copper[photo_groups[0]], x, y);
-	      if (cc)
-		{
-		  int r;
-		  
-		  if (mask)
-		    rgb (&cop, 220, 145, 230);
-		  else
-		    {
-		      if (options[HA_photo_plating].int_value == PLATING_GOLD)
-			{
-			  // ENIG
-			  rgb (&cop, 185, 146, 52);
-
-			  // increase top shadow to increase shininess
-			  if (cc == TOP_SHADOW)
-			    blend (&cop, 0.7, &cop, &white);
-			}
-		      else if (options[HA_photo_plating].int_value == PLATING_TIN)
-			{
-			  // tinned
-			  rgb (&cop, 140, 150, 160);
-
-			  // add some variation to make it look more matte
-			  r = (rand() % 5 - 2) * 2;
-			  cop.r += r;
-			  cop.g += r;
-			  cop.b += r;
-			}
-		      else if (options[HA_photo_plating].int_value == PLATING_SILVER)
-			{
-			  // silver
-			  rgb (&cop, 192, 192, 185);
-
-			  // increase top shadow to increase shininess
-			  if (cc == TOP_SHADOW)
-			    blend (&cop, 0.7, &cop, &white);
-			}
-		      else if (options[HA_photo_plating].int_value == PLATING_COPPER)
-			{
-			  // copper
-			  rgb (&cop, 184, 115, 51);
-
-			  // increase top shadow to increase shininess
-			  if (cc == TOP_SHADOW)
-			    blend (&cop, 0.7, &cop, &white);
-			}
-		    }
-		  
-		  if (cc == TOP_SHADOW)
-		    blend (&cop, 0.7, &cop, &white);
-		  if (cc == BOTTOM_SHADOW)
-		    blend (&cop, 0.7, &cop, &black);
-		}
-
-	      if (photo_drill && !gdImageGetPixel (photo_drill, x, y)) 
-		{		
-		  rgb (&p, 0, 0, 0);
-		  transparent=1;
-		}
-	      else if (silk)
-		{
-		  silk_colour = silk_colours[options[HA_photo_silk_colour].int_value];
-		  blend (&p, 1.0, &silk_colour, &silk_colour);
-		  if (silk == TOP_SHADOW)
-		    add (&p, 1.0, &p, 1.0, &silk_top_shadow);
-		  else if (silk == BOTTOM_SHADOW)
-		    subtract (&p, 1.0, &p, 1.0, &silk_bottom_shadow);
-		}
-	      else if (mask)
-		{
-		  p = cop;
-		  mask_colour = mask_colours[options[HA_photo_mask_colour].int_value];
-		  multiply (&p, &p, &mask_colour);
-		  add (&p, 1, &p, 0.2, &mask_colour);
-		  if (mask == TOP_SHADOW)
-		    blend (&p, 0.7, &p, &white);
-		  if (mask == BOTTOM_SHADOW)
-		    blend (&p, 0.7, &p, &black);
-		}
-	      else
-		p = cop;
-	      
-	      if (options[HA_use_alpha].int_value) {
-
-		cc = (transparent)?\
-		  gdImageColorResolveAlpha(im, 0, 0, 0, 127):\
-		  gdImageColorResolveAlpha(im, p.r, p.g, p.b, 0);
-
-	      } else {
-		cc = (transparent)?\
-		  gdImageColorResolve(im, 0, 0, 0):\
-		  gdImageColorResolve(im, p.r, p.g, p.b);
-	      }		  
-
-	      if (photo_flip == PHOTO_FLIP_X)
-		gdImageSetPixel (im, gdImageSX (im) - x - 1, y, cc);
-	      else if (photo_flip == PHOTO_FLIP_Y)
-		gdImageSetPixel (im, x, gdImageSY (im) - y - 1, cc);
-	      else
-		gdImageSetPixel (im, x, y, cc);
-	    }
-	}
-    }
-
   /* actually write out the image */
   fmt = filetypes[options[HA_filetype].int_value];
 
@@ -1230,6 +1431,9 @@ png_set_layer (const char *name, int group, int empty)
 
   if (photo_mode)
     {
+      if (photo_pass == PHOTO_PASS_OUTLINE && strcmp (name, "outline") != 0)
+	return 0;
+
       switch (idx)
 	{
 	case SL (SILK, TOP):
@@ -1265,6 +1469,8 @@ png_set_layer (const char *name, int group, int empty)
 
 	  if (strcmp (name, "outline") == 0)
 	    {
+	      if (photo_pass == PHOTO_PASS_LAYERS)
+		return 0;
 	      doing_outline = 1;
 	      have_outline = 0;
 	      photo_im = &photo_outline;
@@ -1278,11 +1484,11 @@ png_set_layer (const char *name, int group, int empty)
       if (! *photo_im)
 	{
 	  static color_struct *black = NULL, *white = NULL;
-	  *photo_im = gdImageCreate (gdImageSX (im), gdImageSY (im));
+	  *photo_im = gdImageCreate (photo_w, photo_h);
           if (photo_im == NULL) 
 	    {
 	      Message ("%s():  gdImageCreate(%d, %d) returned NULL.  Aborting export.\n", __FUNCTION__, 
-		       gdImageSX (im), gdImageSY (im));
+		       photo_w, photo_h);
 	      return 0;
 	    }
 
@@ -1308,7 +1514,7 @@ png_set_layer (const char *name, int group, int empty)
 
 	  if (idx == SL (PDRILL, 0)
 	      || idx == SL (UDRILL, 0))
-	    gdImageFilledRectangle (*photo_im, 0, 0, gdImageSX (im), gdImageSY (im), black->c);
+	    gdImageFilledRectangle (*photo_im, 0, 0, photo_w, photo_h, black->c);
 	}
       im = *photo_im;
       return 1;
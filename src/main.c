@@ -1513,6 +1513,19 @@ If set, save pcb files using only mm unit suffix rather than 'smart' mil/mm.
   BSET (SaveMetricOnly, 0, "save-metric-only",
         "If set, save pcb files using only mm unit suffix rather than 'smart' mil/mm."),
 
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --snapshot-cache
+If set, the clipped polygons of a board are saved to
+@file{<board>.pcb.snapshot} when the board is loaded, and read back
+from there on the next load of the unchanged board instead of being
+clipped again.
+@end ftable
+%end-doc
+*/
+  BSET (SnapshotCache, 0, "snapshot-cache",
+        "If set, keep polygon clip snapshots next to board files"),
+
 /* %start-doc options "2 General GUI Options"
 @ftable @code
 @item --all-direction-lines
@@ -73,6 +73,8 @@
 #include "set.h"
 #include "undo.h"
 #include "action.h"
+#include "hid_draw.h"
+#include "hid/common/draw_helpers.h"
 
 #ifdef HAVE_LIBDMALLOC
 #include <dmalloc.h>
@@ -750,6 +752,61 @@ CountHoles (int *plated, int *unplated, const BoxType *within_area)
 }
 
 
+/* ---------------------------------------------------------------------------
+ * r_search callbacks for GetDataBoundingBox.  A subtree is only entered
+ * when its box reaches past the extents found so far, so after the first
+ * few objects the search only walks the outermost branches of each tree.
+ */
+static int
+data_bbox_region (const BoxType * region, void *cl)
+{
+  BoxType *box = (BoxType *) cl;
+
+  return (region->X1 < box->X1 || region->Y1 < box->Y1 ||
+          region->X2 > box->X2 || region->Y2 > box->Y2);
+}
+
+static int
+data_bbox_object (const BoxType * b, void *cl)
+{
+  BoxType *box = (BoxType *) cl;
+
+  MAKEMIN (box->X1, b->X1);
+  MAKEMIN (box->Y1, b->Y1);
+  MAKEMAX (box->X2, b->X2);
+  MAKEMAX (box->Y2, b->Y2);
+  return 1;
+}
+
+/* lines and vias are measured without their clearance, which the
+ * boxes stored in the trees include
+ */
+static int
+data_bbox_line (const BoxType * b, void *cl)
+{
+  LineType *line = (LineType *) b;
+  BoxType *box = (BoxType *) cl;
+
+  MAKEMIN (box->X1, MIN (line->Point1.X, line->Point2.X) - line->Thickness / 2);
+  MAKEMIN (box->Y1, MIN (line->Point1.Y, line->Point2.Y) - line->Thickness / 2);
+  MAKEMAX (box->X2, MAX (line->Point1.X, line->Point2.X) + line->Thickness / 2);
+  MAKEMAX (box->Y2, MAX (line->Point1.Y, line->Point2.Y) + line->Thickness / 2);
+  return 1;
+}
+
+static int
+data_bbox_via (const BoxType * b, void *cl)
+{
+  PinType *via = (PinType *) b;
+  BoxType *box = (BoxType *) cl;
+
+  MAKEMIN (box->X1, via->X - via->Thickness / 2);
+  MAKEMIN (box->Y1, via->Y - via->Thickness / 2);
+  MAKEMAX (box->X2, via->X + via->Thickness / 2);
+  MAKEMAX (box->Y2, via->Y + via->Thickness / 2);
+  return 1;
+}
+
 /* ---------------------------------------------------------------------------
  * gets minimum and maximum coordinates
  * returns NULL if layout is empty
@@ -758,72 +815,43 @@ BoxType *
 GetDataBoundingBox (DataType *Data)
 {
   static BoxType box;
-  /* FIX ME: use r_search to do this much faster */
+  static const BoxType everywhere =
+    { -MAX_COORD, -MAX_COORD, MAX_COORD, MAX_COORD };
+  rtree_t *names = Data->name_tree[NAMEONPCB_INDEX];
+  Cardinal i;
 
   /* preset identifiers with highest and lowest possible values */
   box.X1 = box.Y1 = MAX_COORD;
   box.X2 = box.Y2 = -MAX_COORD;
 
-  /* now scan for the lowest/highest X and Y coordinate */
-  VIA_LOOP (Data);
-  {
-    box.X1 = MIN (box.X1, via->X - via->Thickness / 2);
-    box.Y1 = MIN (box.Y1, via->Y - via->Thickness / 2);
-    box.X2 = MAX (box.X2, via->X + via->Thickness / 2);
-    box.Y2 = MAX (box.Y2, via->Y + via->Thickness / 2);
-  }
-  END_LOOP;
-  ELEMENT_LOOP (Data);
-  {
-    box.X1 = MIN (box.X1, element->BoundingBox.X1);
-    box.Y1 = MIN (box.Y1, element->BoundingBox.Y1);
-    box.X2 = MAX (box.X2, element->BoundingBox.X2);
-    box.Y2 = MAX (box.Y2, element->BoundingBox.Y2);
+  /* element names are not part of the element's own box */
+  r_search (Data->element_tree, &everywhere,
+            data_bbox_region, data_bbox_object, &box);
+  if (names && names->size == Data->ElementN)
+    r_search (names, &everywhere, data_bbox_region, data_bbox_object, &box);
+  else
     {
-      TextType *text = &NAMEONPCB_TEXT (element);
-      box.X1 = MIN (box.X1, text->BoundingBox.X1);
-      box.Y1 = MIN (box.Y1, text->BoundingBox.Y1);
-      box.X2 = MAX (box.X2, text->BoundingBox.X2);
-      box.Y2 = MAX (box.Y2, text->BoundingBox.Y2);
-    };
-  }
-  END_LOOP;
-  ALLLINE_LOOP (Data);
-  {
-    box.X1 = MIN (box.X1, line->Point1.X - line->Thickness / 2);
-    box.Y1 = MIN (box.Y1, line->Point1.Y - line->Thickness / 2);
-    box.X1 = MIN (box.X1, line->Point2.X - line->Thickness / 2);
-    box.Y1 = MIN (box.Y1, line->Point2.Y - line->Thickness / 2);
-    box.X2 = MAX (box.X2, line->Point1.X + line->Thickness / 2);
-    box.Y2 = MAX (box.Y2, line->Point1.Y + line->Thickness / 2);
-    box.X2 = MAX (box.X2, line->Point2.X + line->Thickness / 2);
-    box.Y2 = MAX (box.Y2, line->Point2.Y + line->Thickness / 2);
-  }
-  ENDALL_LOOP;
-  ALLARC_LOOP (Data);
-  {
-    box.X1 = MIN (box.X1, arc->BoundingBox.X1);
-    box.Y1 = MIN (box.Y1, arc->BoundingBox.Y1);
-    box.X2 = MAX (box.X2, arc->BoundingBox.X2);
-    box.Y2 = MAX (box.Y2, arc->BoundingBox.Y2);
-  }
-  ENDALL_LOOP;
-  ALLTEXT_LOOP (Data);
-  {
-    box.X1 = MIN (box.X1, text->BoundingBox.X1);
-    box.Y1 = MIN (box.Y1, text->BoundingBox.Y1);
-    box.X2 = MAX (box.X2, text->BoundingBox.X2);
-    box.Y2 = MAX (box.Y2, text->BoundingBox.Y2);
-  }
-  ENDALL_LOOP;
-  ALLPOLYGON_LOOP (Data);
-  {
-    box.X1 = MIN (box.X1, polygon->BoundingBox.X1);
-    box.Y1 = MIN (box.Y1, polygon->BoundingBox.Y1);
-    box.X2 = MAX (box.X2, polygon->BoundingBox.X2);
-    box.Y2 = MAX (box.Y2, polygon->BoundingBox.Y2);
-  }
-  ENDALL_LOOP;
+      ELEMENT_LOOP (Data);
+      {
+        data_bbox_object (&NAMEONPCB_TEXT (element).BoundingBox, &box);
+      }
+      END_LOOP;
+    }
+  r_search (Data->via_tree, &everywhere,
+            data_bbox_region, data_bbox_via, &box);
+  for (i = 0; i < max_copper_layer + EXTRA_LAYERS; i++)
+    {
+      LayerType *layer = &Data->Layer[i];
+
+      r_search (layer->polygon_tree, &everywhere,
+                data_bbox_region, data_bbox_object, &box);
+      r_search (layer->arc_tree, &everywhere,
+                data_bbox_region, data_bbox_object, &box);
+      r_search (layer->text_tree, &everywhere,
+                data_bbox_region, data_bbox_object, &box);
+      r_search (layer->line_tree, &everywhere,
+                data_bbox_region, data_bbox_line, &box);
+    }
   return (IsDataEmpty (Data) ? NULL : &box);
 }
 
@@ -854,6 +882,9 @@ SetFontInfo (FontType *Ptr)
   LineType *line;
   Coord totalminy = MAX_COORD;
 
+  /* Any text drawn with the old glyphs is out of date */
+  common_draw_pcb_text_flush_cache ();
+
   /* calculate cell with and height (is at least DEFAULT_CELLSIZE)
    * maximum cell width and height
    * minimum x and y position of all lines
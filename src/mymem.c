@@ -42,6 +42,8 @@
 #include "misc.h"
 #include "rats.h"
 #include "rtree.h"
+#include "hid_draw.h"
+#include "hid/common/draw_helpers.h"
 
 #ifdef HAVE_LIBDMALLOC
 #include <dmalloc.h>
@@ -677,9 +679,10 @@ FreePCBMemory (PCBType *pcb)
   free (pcb->PrintFilename);
   FreeDataMemory (pcb->Data);
   free (pcb->Data);
-  /* release font symbols */
+  /* release font symbols, and any text drawn with them */
   for (i = 0; i <= MAX_FONTPOSITION; i++)
     free (pcb->Font.Symbol[i].Line);
+  common_draw_pcb_text_flush_cache ();
   FreeLibraryMemory (&pcb->NetlistLib);
   NetlistChanged (0);
   FreeAttributeListMemory (&pcb->Attributes);
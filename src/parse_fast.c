@@ -0,0 +1,1651 @@
+/*
+ *                            COPYRIGHT
+ *
+ *  PCB, interactive printed circuit board design
+ *  Copyright (C) 2026 PCB Contributors (See ChangeLog for details).
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/* Hand-written parser for .pcb layout files.
+ *
+ * This reads the same language as the lex scanner in parse_l.l and
+ * the yacc grammar in parse_y.y, and builds the same data through the
+ * same create functions, but works straight on the mapped file.
+ * Every statement is a keyword followed by a bracketed argument list,
+ * so the arguments are read into a small array and the statement's
+ * variant is picked by the brackets and the argument types, the way
+ * the grammar's alternatives differ.  Numbers are converted without
+ * copying them out of the file, and strings are unescaped into one
+ * buffer which is reused from statement to statement.
+ *
+ * Anything the grammar accepts should parse the same here; the
+ * parser_diff test loads each layout in tests/inputs with both
+ * parsers and compares the results.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "global.h"
+#include "create.h"
+#include "data.h"
+#include "error.h"
+#include "file.h"
+#include "misc.h"
+#include "move.h"
+#include "parse_l.h"
+#include "polygon.h"
+#include "remove.h"
+#include "rtree.h"
+#include "snapshot.h"
+#include "strflags.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+
+/* the most arguments any statement takes */
+#define MAX_ARGS 16
+
+enum
+{
+  TOK_EOF, TOK_PUNCT, TOK_WORD, TOK_NUMBER, TOK_STRING, TOK_CHAR
+};
+
+/* Keywords and units, the hot ones first */
+enum
+{
+  W_LINE, W_VIA, W_PIN, W_PAD, W_ELEMENTLINE, W_ELEMENTARC, W_ARC,
+  W_TEXT, W_ATTRIBUTE, W_ELEMENT, W_POLYGON, W_HOLE, W_CONNECT, W_NET,
+  W_SYMBOLLINE, W_SYMBOL, W_LAYER, W_RAT, W_RECTANGLE, W_MARK,
+  W_FILEVERSION, W_PCB, W_GRID, W_CURSOR, W_THERMAL, W_POLYAREA, W_DRC,
+  W_FLAGS, W_GROUPS, W_STYLES, W_NETLIST,
+  W_FIRST_UNIT,
+  U_NM = W_FIRST_UNIT, U_UM, U_MM, U_M, U_KM, U_UMIL, U_CMIL, U_MIL, U_IN,
+  U_PX,
+  W_COUNT
+};
+
+static const char *words[W_COUNT] = {
+  "Line", "Via", "Pin", "Pad", "ElementLine", "ElementArc", "Arc",
+  "Text", "Attribute", "Element", "Polygon", "Hole", "Connect", "Net",
+  "SymbolLine", "Symbol", "Layer", "Rat", "Rectangle", "Mark",
+  "FileVersion", "PCB", "Grid", "Cursor", "Thermal", "PolyArea", "DRC",
+  "Flags", "Groups", "Styles", "NetList",
+  "nm", "um", "mm", "m", "km", "umil", "cmil", "mil", "in", "px"
+};
+
+typedef struct
+{
+  int type;
+  int c;			/* the character, or the word */
+  bool is_int;			/* an INTEGER rather than a FLOATING number */
+  int integer;
+  double number;
+  int string;			/* offset in the string buffer, -1 for "" */
+} Token;
+
+typedef struct
+{
+  int type;			/* TOK_NUMBER, TOK_STRING or TOK_CHAR */
+  bool is_int;
+  int integer;
+  double number;
+  int unit;			/* -1 if none */
+  int string;
+  char *s;
+} Arg;
+
+typedef struct
+{
+  const char *p, *end;
+  int line;
+  char *filename;
+  const char *path;		/* the file as opened */
+  const char *source;		/* all of it */
+  size_t size;
+  Token tok;
+
+  /* unescaped strings of the statement being read */
+  char *strings;
+  size_t strings_used, strings_max;
+
+  PCBType *pcb;
+  DataType *data;
+  FontType *font;
+  LayerType *layer;
+  ElementType *element;
+  PolygonType *polygon;
+  LibraryMenuType *menu;
+  int pin_num;
+  bool layer_used[MAX_LAYER + EXTRA_LAYERS];
+} Parser;
+
+/* for the error callbacks of the flag parsers */
+static Parser *current;
+
+static int
+parse_error (const char *s)
+{
+  Message (_("ERROR parsing file '%s'\n"
+	     "    line:        %i\n"
+	     "    description: '%s'\n"),
+	   current->filename, current->line, s);
+  return 0;
+}
+
+static bool
+syntax_error (Parser *ps)
+{
+  parse_error ("syntax error");
+  return false;
+}
+
+/* ---------------------------------------------------------------------------
+ * scanner
+ */
+
+static const double powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Converts [+-]digits[.digits] like g_ascii_strtod does.  With at most
+ * 15 significant digits, the mantissa and the power of ten are both
+ * exact doubles, so the one division rounds correctly; longer numbers
+ * go through a copy on the stack.
+ */
+static double
+decimal_value (const char *s, const char *e)
+{
+  const char *p = s;
+  guint64 mant = 0;
+  int digits = 0, frac = 0;
+  bool neg = false, in_frac = false;
+  char buf[64];
+  double v;
+
+  if (*p == '+' || *p == '-')
+    neg = (*p++ == '-');
+  for (; p < e; p++)
+    {
+      if (*p == '.')
+	{
+	  in_frac = true;
+	  continue;
+	}
+      if (mant || *p != '0')
+	digits++;
+      mant = mant * 10 + (*p - '0');
+      if (in_frac)
+	frac++;
+      if (digits > 15)
+	break;
+    }
+  if (digits <= 15 && frac <= 22)
+    {
+      v = (double) mant / powers_of_ten[frac];
+      return neg ? -v : v;
+    }
+
+  if (e - s < (ptrdiff_t) sizeof (buf))
+    {
+      memcpy (buf, s, e - s);
+      buf[e - s] = '\0';
+      return g_ascii_strtod (buf, NULL);
+    }
+  else
+    {
+      char *copy = g_strndup (s, e - s);
+
+      v = g_ascii_strtod (copy, NULL);
+      g_free (copy);
+      return v;
+    }
+}
+
+static void
+add_string_char (Parser *ps, char c)
+{
+  if (ps->strings_used == ps->strings_max)
+    {
+      ps->strings_max = ps->strings_max ? 2 * ps->strings_max : 256;
+      ps->strings = (char *) realloc (ps->strings, ps->strings_max);
+      if (ps->strings == NULL)
+	{
+	  fprintf (stderr, "ParsePCBFast():  realloc failed\n");
+	  exit (1);
+	}
+    }
+  ps->strings[ps->strings_used++] = c;
+}
+
+static bool
+is_digit (char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static bool
+is_xdigit (char c)
+{
+  return is_digit (c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool
+is_alpha (char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+/* Tries to scan a number at p, with the lexer's patterns
+ *   INTEGER   [+-]?([1-9][0-9]*|0)
+ *   FLOATING  {INTEGER}?"."[0-9]*
+ *   HEX       0x[0-9a-fA-F]+
+ */
+static bool
+scan_number (Parser *ps, const char *p)
+{
+  const char *q = p, *end = ps->end, *int_end = NULL;
+  Token *t = &ps->tok;
+
+  if (q < end && (*q == '+' || *q == '-'))
+    q++;
+  if (q < end && *q >= '1' && *q <= '9')
+    {
+      while (q < end && is_digit (*q))
+	q++;
+      int_end = q;
+    }
+  else if (q < end && *q == '0')
+    int_end = ++q;
+
+  if (*p == '0' && int_end == p + 1 && q + 1 < end && *q == 'x'
+      && is_xdigit (q[1]))
+    {
+      unsigned n = 0;
+
+      for (q++; q < end && is_xdigit (*q); q++)
+	n = n * 16 + (is_digit (*q) ? *q - '0' : (*q | 0x20) - 'a' + 10);
+      t->type = TOK_NUMBER;
+      t->is_int = true;
+      t->integer = n;
+      t->number = t->integer;
+      ps->p = q;
+      return true;
+    }
+
+  if ((int_end && q < end && *q == '.') || (!int_end && *p == '.'))
+    {
+      if (!int_end)
+	q = p;
+      for (q++; q < end && is_digit (*q); q++)
+	;
+      t->type = TOK_NUMBER;
+      t->is_int = false;
+      t->number = decimal_value (p, q);
+      ps->p = q;
+      return true;
+    }
+
+  if (int_end)
+    {
+      t->type = TOK_NUMBER;
+      t->is_int = true;
+      t->integer = round (decimal_value (p, int_end));
+      t->number = t->integer;
+      ps->p = int_end;
+      return true;
+    }
+  return false;
+}
+
+/* Tries to scan a "string" at p; a newline ends it unterminated */
+static bool
+scan_string (Parser *ps, const char *p)
+{
+  const char *q, *end = ps->end;
+  Token *t = &ps->tok;
+
+  for (q = p + 1; q < end && *q != '"'; q++)
+    {
+      if (*q == '\n' || *q == '\r')
+	return false;
+      if (*q == '\\')
+	{
+	  if (q + 1 == end || q[1] == '\n')
+	    return false;
+	  q++;
+	}
+    }
+  if (q == end)
+    return false;
+
+  t->type = TOK_STRING;
+  ps->p = q + 1;
+  if (q == p + 1)
+    {
+      t->string = -1;
+      return true;
+    }
+  t->string = ps->strings_used;
+  for (p++; p < q; p++)
+    {
+      if (*p == '\\')
+	p++;
+      add_string_char (ps, *p);
+    }
+  add_string_char (ps, '\0');
+  return true;
+}
+
+static void
+next_token (Parser *ps)
+{
+  const char *p = ps->p, *end = ps->end;
+  Token *t = &ps->tok;
+
+  for (;;)
+    {
+      if (p == end)
+	{
+	  t->type = TOK_EOF;
+	  ps->p = p;
+	  return;
+	}
+      if (*p == '\n')
+	ps->line++;
+      else if (*p == '#')
+	{
+	  while (p + 1 < end && p[1] != '\n')
+	    p++;
+	}
+      else if (*p != ' ' && *p != '\t' && *p != '\r')
+	break;
+      p++;
+    }
+
+  if (is_alpha (*p))
+    {
+      const char *q = p;
+      size_t len, best_len = 0;
+      int w, best = -1;
+
+      /* like the scanner, take the longest word the letters start with */
+      while (q < end && is_alpha (*q))
+	q++;
+      for (w = 0; w < W_COUNT; w++)
+	if (words[w][0] == *p && (len = strlen (words[w])) <= (size_t) (q - p)
+	    && len > best_len && strncmp (words[w], p, len) == 0)
+	  {
+	    best = w;
+	    best_len = len;
+	  }
+      if (best >= 0)
+	{
+	  t->type = TOK_WORD;
+	  t->c = best;
+	  ps->p = p + best_len;
+	  return;
+	}
+    }
+  else if (*p == '"')
+    {
+      if (scan_string (ps, p))
+	return;
+    }
+  else if (*p == '\'')
+    {
+      if (p + 2 < end && p[1] != '\n' && p[2] == '\'')
+	{
+	  t->type = TOK_CHAR;
+	  t->integer = (unsigned) *(p + 1);
+	  ps->p = p + 3;
+	  return;
+	}
+    }
+  else if (scan_number (ps, p))
+    return;
+
+  /* anything else is a single character */
+  t->type = TOK_PUNCT;
+  t->c = *p;
+  ps->p = p + 1;
+}
+
+static bool
+is_punct (Parser *ps, int c)
+{
+  return ps->tok.type == TOK_PUNCT && ps->tok.c == c;
+}
+
+static bool
+is_word (Parser *ps, int w)
+{
+  return ps->tok.type == TOK_WORD && ps->tok.c == w;
+}
+
+static bool
+expect (Parser *ps, int c)
+{
+  if (!is_punct (ps, c))
+    return syntax_error (ps);
+  next_token (ps);
+  return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * arguments
+ */
+
+/* Reads the bracketed argument list at the current token.  Returns the
+ * opening bracket, or 0 on a syntax error which the caller reports.
+ */
+static int
+read_args (Parser *ps, Arg *args, int *n)
+{
+  int open, close, i;
+
+  if (is_punct (ps, '['))
+    close = ']';
+  else if (is_punct (ps, '('))
+    close = ')';
+  else
+    return 0;
+  open = ps->tok.c;
+
+  /* the previous statement is done with its strings */
+  ps->strings_used = 0;
+  next_token (ps);
+
+  for (*n = 0; !is_punct (ps, close); (*n)++)
+    {
+      Arg *a = &args[*n];
+      Token *t = &ps->tok;
+
+      if (*n == MAX_ARGS
+	  || (t->type != TOK_NUMBER && t->type != TOK_STRING
+	      && t->type != TOK_CHAR))
+	return 0;
+      a->type = t->type;
+      a->is_int = t->is_int;
+      a->integer = t->integer;
+      a->number = t->number;
+      a->string = t->string;
+      a->unit = -1;
+      next_token (ps);
+      if (a->type == TOK_NUMBER && ps->tok.type == TOK_WORD)
+	{
+	  if (ps->tok.c < W_FIRST_UNIT)
+	    return 0;
+	  a->unit = ps->tok.c;
+	  next_token (ps);
+	}
+    }
+  next_token (ps);
+
+  /* the string buffer is done growing */
+  for (i = 0; i < *n; i++)
+    if (args[i].type == TOK_STRING)
+      args[i].s = args[i].string < 0 ? NULL : ps->strings + args[i].string;
+  return open;
+}
+
+/* Checks the arguments' types against a pattern, one letter for each:
+ *   m  a measure: a number, with or without a unit
+ *   n  a number without a unit
+ *   i  an integer without a unit
+ *   s  a string
+ *   f  flags: an integer or a string
+ *   c  a symbol: an integer or a character constant
+ */
+static bool
+args_match (Arg *args, int n, const char *pattern)
+{
+  int i;
+
+  for (i = 0; i < n && pattern[i]; i++)
+    {
+      Arg *a = &args[i];
+      bool integer = a->type == TOK_NUMBER && a->is_int && a->unit < 0;
+
+      switch (pattern[i])
+	{
+	case 'm':
+	  if (a->type != TOK_NUMBER)
+	    return false;
+	  break;
+	case 'n':
+	  if (a->type != TOK_NUMBER || a->unit >= 0)
+	    return false;
+	  break;
+	case 'i':
+	  if (!integer)
+	    return false;
+	  break;
+	case 's':
+	  if (a->type != TOK_STRING)
+	    return false;
+	  break;
+	case 'f':
+	  if (!integer && a->type != TOK_STRING)
+	    return false;
+	  break;
+	case 'c':
+	  if (!integer && a->type != TOK_CHAR)
+	    return false;
+	  break;
+	}
+    }
+  return i == n && pattern[i] == '\0';
+}
+
+static PLMeasure
+measure (Arg *a)
+{
+  PLMeasure m;
+  double n = a->number, d;
+
+  switch (a->unit)
+    {
+    default:
+      d = MIL_TO_COORD (n) / 100.0;
+      break;
+    case U_UMIL:
+      d = MIL_TO_COORD (n) / 1000000.0;
+      break;
+    case U_CMIL:
+      d = MIL_TO_COORD (n) / 100.0;
+      break;
+    case U_MIL:
+      d = MIL_TO_COORD (n);
+      break;
+    case U_IN:
+      d = INCH_TO_COORD (n);
+      break;
+    case U_NM:
+    case U_PX:
+      d = MM_TO_COORD (n) / 1000000.0;
+      break;
+    case U_UM:
+      d = MM_TO_COORD (n) / 1000.0;
+      break;
+    case U_MM:
+      d = MM_TO_COORD (n);
+      break;
+    case U_M:
+      d = MM_TO_COORD (n) * 1000.0;
+      break;
+    case U_KM:
+      d = MM_TO_COORD (n) * 1000000.0;
+      break;
+    }
+  m.ival = (Coord) n;
+  m.bval = round (d);
+  m.dval = d;
+  m.has_units = a->unit >= 0;
+  return m;
+}
+
+/* "measure" means an integer value only, old units (mil), or new units
+ * (cmil); see parse_y.y
+ */
+static int
+integer_value (Arg *a)
+{
+  PLMeasure m = measure (a);
+
+  if (m.has_units)
+    parse_error ("units ignored here");
+  return m.ival;
+}
+
+static Coord
+old_units (Arg *a)
+{
+  PLMeasure m = measure (a);
+
+  if (m.has_units)
+    return m.bval;
+  return round (MIL_TO_COORD (m.ival));
+}
+
+static Coord
+new_units (Arg *a)
+{
+  PLMeasure m = measure (a);
+
+  if (m.has_units)
+    return m.bval;
+  return round (MIL_TO_COORD (m.ival) / 100.0);
+}
+
+#define IV(i) integer_value (&args[i])
+#define OU(i) old_units (&args[i])
+#define NU(i) new_units (&args[i])
+#define FLAGS(i) (args[i].type == TOK_STRING \
+		  ? string_to_flags (args[i].s, parse_error) \
+		  : OldFlags (args[i].integer))
+
+/* ---------------------------------------------------------------------------
+ * statements
+ */
+
+static bool
+parse_attribute (Parser *ps, AttributeListType *list)
+{
+  Arg args[MAX_ARGS];
+  int n;
+
+  next_token (ps);
+  if (read_args (ps, args, &n) != '(' || !args_match (args, n, "ss"))
+    return syntax_error (ps);
+  CreateNewAttribute (list, args[0].s, args[1].s ? args[1].s : (char *) "");
+  return true;
+}
+
+static bool
+parse_via (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n, open;
+
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (open == '[' && args_match (args, n, "mmmmmmsf"))
+    CreateNewVia (ps->data, NU (0), NU (1), NU (2), NU (3), NU (4), NU (5),
+		  args[6].s, FLAGS (7));
+  else if (open == '(' && args_match (args, n, "mmmmmmsi"))
+    CreateNewVia (ps->data, OU (0), OU (1), OU (2), OU (3), OU (4), OU (5),
+		  args[6].s, OldFlags (args[7].integer));
+  else if (open == '(' && args_match (args, n, "mmmmmsi"))
+    CreateNewVia (ps->data, OU (0), OU (1), OU (2), OU (3),
+		  OU (2) + OU (3), OU (4), args[5].s,
+		  OldFlags (args[6].integer));
+  else if (open == '(' && args_match (args, n, "mmmmsi"))
+    CreateNewVia (ps->data, OU (0), OU (1), OU (2), 2 * GROUNDPLANEFRAME,
+		  OU (2) + 2 * MASKFRAME, OU (3), args[4].s,
+		  OldFlags (args[5].integer));
+  else if (open == '(' && args_match (args, n, "mmmsi"))
+    {
+      Coord hole = (OU (2) * DEFAULT_DRILLINGHOLE);
+
+      /* make sure that there's enough copper left */
+      if (OU (2) - hole < MIN_PINORVIACOPPER && OU (2) > MIN_PINORVIACOPPER)
+	hole = OU (2) - MIN_PINORVIACOPPER;
+      CreateNewVia (ps->data, OU (0), OU (1), OU (2), 2 * GROUNDPLANEFRAME,
+		    OU (2) + 2 * MASKFRAME, hole, args[3].s,
+		    OldFlags (args[4].integer));
+    }
+  else
+    return syntax_error (ps);
+  return true;
+}
+
+static bool
+parse_rat (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n, open;
+
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (open == '[' && args_match (args, n, "mmimmif"))
+    CreateNewRat (ps->data, NU (0), NU (1), NU (3), NU (4),
+		  args[2].integer, args[5].integer, Settings.RatThickness,
+		  FLAGS (6));
+  else if (open == '(' && args_match (args, n, "mmimmii"))
+    CreateNewRat (ps->data, OU (0), OU (1), OU (3), OU (4),
+		  args[2].integer, args[5].integer, Settings.RatThickness,
+		  OldFlags (args[6].integer));
+  else
+    return syntax_error (ps);
+  return true;
+}
+
+static bool
+parse_line (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n, open;
+
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (open == '[' && args_match (args, n, "mmmmmmf"))
+    CreateNewLineOnLayer (ps->layer, NU (0), NU (1), NU (2), NU (3),
+			  NU (4), NU (5), FLAGS (6));
+  else if (open == '(' && args_match (args, n, "mmmmmmi"))
+    CreateNewLineOnLayer (ps->layer, OU (0), OU (1), OU (2), OU (3),
+			  OU (4), OU (5), OldFlags (args[6].integer));
+  else if (open == '(' && args_match (args, n, "mmmmmm"))
+    {
+      /* eliminate old-style rat-lines */
+      if ((IV (5) & RATFLAG) == 0)
+	CreateNewLineOnLayer (ps->layer, OU (0), OU (1), OU (2), OU (3),
+			      OU (4), 200 * GROUNDPLANEFRAME,
+			      OldFlags (IV (5)));
+    }
+  else
+    return syntax_error (ps);
+  return true;
+}
+
+static bool
+parse_arc (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n, open;
+
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (open == '[' && args_match (args, n, "mmmmmmnnf"))
+    CreateNewArcOnLayer (ps->layer, NU (0), NU (1), NU (2), NU (3),
+			 args[6].number, args[7].number, NU (4), NU (5),
+			 FLAGS (8));
+  else if (open == '(' && args_match (args, n, "mmmmmmnni"))
+    CreateNewArcOnLayer (ps->layer, OU (0), OU (1), OU (2), OU (3),
+			 args[6].number, args[7].number, OU (4), OU (5),
+			 OldFlags (args[8].integer));
+  else if (open == '(' && args_match (args, n, "mmmmmmni"))
+    CreateNewArcOnLayer (ps->layer, OU (0), OU (1), OU (2), OU (2),
+			 IV (5), args[6].number, OU (4),
+			 200 * GROUNDPLANEFRAME, OldFlags (args[7].integer));
+  else
+    return syntax_error (ps);
+  return true;
+}
+
+static bool
+parse_rectangle (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n;
+
+  next_token (ps);
+  if (read_args (ps, args, &n) != '(' || !args_match (args, n, "mmmmi"))
+    return syntax_error (ps);
+  CreateNewPolygonFromRectangle (ps->layer, OU (0), OU (1),
+				 OU (0) + OU (2), OU (1) + OU (3),
+				 OldFlags (args[4].integer));
+  return true;
+}
+
+/* Text flagged as silk goes to the silk layer of its side */
+static LayerType *
+text_layer (Parser *ps, unsigned flags)
+{
+  if (flags & ONSILKFLAG)
+    return &ps->data->Layer[ps->data->LayerN +
+			    ((flags & ONSOLDERFLAG) ?
+			     BOTTOM_SILK_LAYER : TOP_SILK_LAYER)];
+  return ps->layer;
+}
+
+static bool
+parse_text (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n, open;
+
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (open == '[' && args_match (args, n, "mmnnsf"))
+    {
+      FlagType flags = FLAGS (5);
+
+      CreateNewText (text_layer (ps, flags.f), ps->font, NU (0), NU (1),
+		     args[2].number, args[3].number, args[4].s, flags);
+    }
+  else if (open == '(' && args_match (args, n, "mmnnsi"))
+    CreateNewText (text_layer (ps, args[5].integer), ps->font, OU (0),
+		   OU (1), args[2].number, args[3].number, args[4].s,
+		   OldFlags (args[5].integer));
+  else if (open == '(' && args_match (args, n, "mmnsi"))
+    /* use a default scale of 100% */
+    CreateNewText (ps->layer, ps->font, OU (0), OU (1), args[2].number, 100,
+		   args[3].s, OldFlags (args[4].integer));
+  else
+    return syntax_error (ps);
+  return true;
+}
+
+static bool
+parse_polygon_points (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n, open;
+
+  while (is_punct (ps, '(') || is_punct (ps, '['))
+    {
+      open = read_args (ps, args, &n);
+      if (!open || !args_match (args, n, "mm"))
+	return syntax_error (ps);
+      if (open == '(')
+	CreateNewPointInPolygon (ps->polygon, OU (0), OU (1));
+      else
+	CreateNewPointInPolygon (ps->polygon, NU (0), NU (1));
+    }
+  return true;
+}
+
+static bool
+parse_polygon (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n;
+  Cardinal contour, contour_start, contour_end;
+  bool bad_contour_found = false;
+  PolygonType *polygon;
+
+  next_token (ps);
+  if (read_args (ps, args, &n) != '(' || !args_match (args, n, "f"))
+    return syntax_error (ps);
+  if (!expect (ps, '('))
+    return false;
+  polygon = ps->polygon = CreateNewPolygon (ps->layer, FLAGS (0));
+
+  if (!parse_polygon_points (ps))
+    return false;
+  while (is_word (ps, W_HOLE))
+    {
+      next_token (ps);
+      if (!expect (ps, '('))
+	return false;
+      CreateNewHoleInPolygon (polygon);
+      if (!parse_polygon_points (ps) || !expect (ps, ')'))
+	return false;
+    }
+  if (!expect (ps, ')'))
+    return false;
+
+  /* ignore junk */
+  for (contour = 0; contour <= polygon->HoleIndexN; contour++)
+    {
+      contour_start = (contour == 0) ? 0 : polygon->HoleIndex[contour - 1];
+      contour_end = (contour == polygon->HoleIndexN) ?
+	polygon->PointN : polygon->HoleIndex[contour];
+      if (contour_end - contour_start < 3)
+	bad_contour_found = true;
+    }
+  if (bad_contour_found)
+    {
+      Message (_("WARNING parsing file '%s'\n"
+		 "    line:        %i\n"
+		 "    description: 'ignored polygon "
+		 "(< 3 points in a contour)'\n"), ps->filename, ps->line);
+      DestroyObject (ps->data, POLYGON_TYPE, ps->layer, polygon, polygon);
+    }
+  else
+    {
+      SetPolygonBoundingBox (polygon);
+      if (!ps->layer->polygon_tree)
+	ps->layer->polygon_tree = r_create_tree (NULL, 0, 0);
+      r_insert_entry (ps->layer->polygon_tree, (BoxType *) polygon, 0);
+    }
+  return true;
+}
+
+static bool
+parse_layer (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n, number;
+  LayerType *layer;
+
+  next_token (ps);
+  if (read_args (ps, args, &n) != '('
+      || !(args_match (args, n, "is") || args_match (args, n, "iss")))
+    return syntax_error (ps);
+  if (!expect (ps, '('))
+    return false;
+
+  number = args[0].integer;
+  if (number <= 0 || number > MAX_LAYER + EXTRA_LAYERS)
+    {
+      parse_error ("Layernumber out of range");
+      return false;
+    }
+  if (ps->layer_used[number - 1])
+    {
+      parse_error ("Layernumber used twice");
+      return false;
+    }
+  layer = ps->layer = &ps->data->Layer[number - 1];
+  layer->Name = strdup (args[1].s ? args[1].s : "");
+  ps->layer_used[number - 1] = true;
+
+  while (!is_punct (ps, ')'))
+    {
+      bool ok;
+
+      if (ps->tok.type != TOK_WORD)
+	return syntax_error (ps);
+      switch (ps->tok.c)
+	{
+	case W_LINE:
+	  ok = parse_line (ps);
+	  break;
+	case W_ARC:
+	  ok = parse_arc (ps);
+	  break;
+	case W_RECTANGLE:
+	  ok = parse_rectangle (ps);
+	  break;
+	case W_TEXT:
+	  ok = parse_text (ps);
+	  break;
+	case W_ATTRIBUTE:
+	  ok = parse_attribute (ps, &layer->Attributes);
+	  break;
+	case W_POLYGON:
+	  ok = parse_polygon (ps);
+	  break;
+	default:
+	  return syntax_error (ps);
+	}
+      if (!ok)
+	return false;
+    }
+  next_token (ps);
+  return true;
+}
+
+/* Pins, pads, lines and arcs of elements whose header doesn't have the
+ * mark, in absolute coordinates.
+ */
+static bool
+parse_element_definition (Parser *ps)
+{
+  ElementType *e = ps->element;
+  Arg args[MAX_ARGS];
+  int n, open, word = ps->tok.c;
+  char p_number[8];
+
+  if (ps->tok.type != TOK_WORD)
+    return syntax_error (ps);
+  if (word == W_ATTRIBUTE)
+    return parse_attribute (ps, &e->Attributes);
+
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (word == W_PIN && open == '(' && args_match (args, n, "mmmmssi"))
+    CreateNewPin (e, OU (0), OU (1), OU (2), 2 * GROUNDPLANEFRAME,
+		  OU (2) + 2 * MASKFRAME, OU (3), args[4].s, args[5].s,
+		  OldFlags (args[6].integer));
+  else if (word == W_PIN && open == '(' && args_match (args, n, "mmmmsi"))
+    {
+      sprintf (p_number, "%d", ps->pin_num++);
+      CreateNewPin (e, OU (0), OU (1), OU (2), 2 * GROUNDPLANEFRAME,
+		    OU (2) + 2 * MASKFRAME, OU (3), args[4].s, p_number,
+		    OldFlags (args[5].integer));
+    }
+  else if (word == W_PIN && open == '(' && args_match (args, n, "mmmsi"))
+    {
+      /* drilling hole is 40% of the diameter */
+      Coord hole = OU (2) * DEFAULT_DRILLINGHOLE;
+
+      /* make sure that there's enough copper left */
+      if (OU (2) - hole < MIN_PINORVIACOPPER && OU (2) > MIN_PINORVIACOPPER)
+	hole = OU (2) - MIN_PINORVIACOPPER;
+      sprintf (p_number, "%d", ps->pin_num++);
+      CreateNewPin (e, OU (0), OU (1), OU (2), 2 * GROUNDPLANEFRAME,
+		    OU (2) + 2 * MASKFRAME, hole, args[3].s, p_number,
+		    OldFlags (args[4].integer));
+    }
+  else if (word == W_PAD && open == '(' && args_match (args, n, "mmmmmssi"))
+    CreateNewPad (e, OU (0), OU (1), OU (2), OU (3), OU (4),
+		  2 * GROUNDPLANEFRAME, OU (4) + 2 * MASKFRAME, args[5].s,
+		  args[6].s, OldFlags (args[7].integer));
+  else if (word == W_PAD && open == '(' && args_match (args, n, "mmmmmsi"))
+    {
+      sprintf (p_number, "%d", ps->pin_num++);
+      CreateNewPad (e, OU (0), OU (1), OU (2), OU (3), OU (4),
+		    2 * GROUNDPLANEFRAME, OU (4) + 2 * MASKFRAME, args[5].s,
+		    p_number, OldFlags (args[6].integer));
+    }
+  else if (word == W_ELEMENTLINE && open == '['
+	   && args_match (args, n, "mmmmm"))
+    CreateNewLineInElement (e, NU (0), NU (1), NU (2), NU (3), NU (4));
+  else if (word == W_ELEMENTLINE && open == '('
+	   && args_match (args, n, "mmmmm"))
+    CreateNewLineInElement (e, OU (0), OU (1), OU (2), OU (3), OU (4));
+  else if (word == W_ELEMENTARC && open == '['
+	   && args_match (args, n, "mmmmnnm"))
+    CreateNewArcInElement (e, NU (0), NU (1), NU (2), NU (3),
+			   args[4].number, args[5].number, NU (6));
+  else if (word == W_ELEMENTARC && open == '('
+	   && args_match (args, n, "mmmmnnm"))
+    CreateNewArcInElement (e, OU (0), OU (1), OU (2), OU (3),
+			   args[4].number, args[5].number, OU (6));
+  else if (word == W_MARK && open == '[' && args_match (args, n, "mm"))
+    {
+      e->MarkX = NU (0);
+      e->MarkY = NU (1);
+    }
+  else if (word == W_MARK && open == '(' && args_match (args, n, "mm"))
+    {
+      e->MarkX = OU (0);
+      e->MarkY = OU (1);
+    }
+  else
+    return syntax_error (ps);
+  return true;
+}
+
+/* Pins, pads, lines and arcs relative to the element's mark */
+static bool
+parse_relement_definition (Parser *ps)
+{
+  ElementType *e = ps->element;
+  Arg args[MAX_ARGS];
+  int n, open, word = ps->tok.c;
+
+  if (ps->tok.type != TOK_WORD)
+    return syntax_error (ps);
+  if (word == W_ATTRIBUTE)
+    return parse_attribute (ps, &e->Attributes);
+
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (word == W_PIN && open == '[' && args_match (args, n, "mmmmmmssf"))
+    CreateNewPin (e, NU (0) + e->MarkX, NU (1) + e->MarkY, NU (2), NU (3),
+		  NU (4), NU (5), args[6].s, args[7].s, FLAGS (8));
+  else if (word == W_PIN && open == '(' && args_match (args, n, "mmmmmmssi"))
+    CreateNewPin (e, OU (0) + e->MarkX, OU (1) + e->MarkY, OU (2), OU (3),
+		  OU (4), OU (5), args[6].s, args[7].s,
+		  OldFlags (args[8].integer));
+  else if (word == W_PAD && open == '['
+	   && args_match (args, n, "mmmmmmmssf"))
+    CreateNewPad (e, NU (0) + e->MarkX, NU (1) + e->MarkY,
+		  NU (2) + e->MarkX, NU (3) + e->MarkY, NU (4), NU (5),
+		  NU (6), args[7].s, args[8].s, FLAGS (9));
+  else if (word == W_PAD && open == '('
+	   && args_match (args, n, "mmmmmmmssi"))
+    CreateNewPad (e, OU (0) + e->MarkX, OU (1) + e->MarkY,
+		  OU (2) + e->MarkX, OU (3) + e->MarkY, OU (4), OU (5),
+		  OU (6), args[7].s, args[8].s, OldFlags (args[9].integer));
+  else if (word == W_ELEMENTLINE && open == '['
+	   && args_match (args, n, "mmmmm"))
+    CreateNewLineInElement (e, NU (0) + e->MarkX, NU (1) + e->MarkY,
+			    NU (2) + e->MarkX, NU (3) + e->MarkY, NU (4));
+  else if (word == W_ELEMENTLINE && open == '('
+	   && args_match (args, n, "mmmmm"))
+    CreateNewLineInElement (e, OU (0) + e->MarkX, OU (1) + e->MarkY,
+			    OU (2) + e->MarkX, OU (3) + e->MarkY, OU (4));
+  else if (word == W_ELEMENTARC && open == '['
+	   && args_match (args, n, "mmmmnnm"))
+    CreateNewArcInElement (e, NU (0) + e->MarkX, NU (1) + e->MarkY,
+			   NU (2), NU (3), args[4].number, args[5].number,
+			   NU (6));
+  else if (word == W_ELEMENTARC && open == '('
+	   && args_match (args, n, "mmmmnnm"))
+    CreateNewArcInElement (e, OU (0) + e->MarkX, OU (1) + e->MarkY,
+			   OU (2), OU (3), args[4].number, args[5].number,
+			   OU (6));
+  else
+    return syntax_error (ps);
+  return true;
+}
+
+static bool
+parse_element (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n, open;
+  bool relative = true;
+  ElementType *e;
+
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (open == '(' && args_match (args, n, "ssmmi"))
+    {
+      e = CreateNewElement (ps->data, ps->font, NoFlags (), args[0].s,
+			    args[1].s, NULL, OU (2), OU (3),
+			    args[4].integer, 100, NoFlags (), false);
+      relative = false;
+    }
+  else if (open == '(' && args_match (args, n, "issmmmmi"))
+    {
+      e = CreateNewElement (ps->data, ps->font, OldFlags (args[0].integer),
+			    args[1].s, args[2].s, NULL, OU (3), OU (4),
+			    IV (5), IV (6), OldFlags (args[7].integer), false);
+      relative = false;
+    }
+  else if (open == '(' && args_match (args, n, "isssmmmmi"))
+    {
+      e = CreateNewElement (ps->data, ps->font, OldFlags (args[0].integer),
+			    args[1].s, args[2].s, args[3].s, OU (4), OU (5),
+			    IV (6), IV (7), OldFlags (args[8].integer), false);
+      relative = false;
+    }
+  else if (open == '(' && args_match (args, n, "isssmmmmnni"))
+    {
+      e = CreateNewElement (ps->data, ps->font, OldFlags (args[0].integer),
+			    args[1].s, args[2].s, args[3].s,
+			    OU (4) + OU (6), OU (5) + OU (7),
+			    args[8].number, args[9].number,
+			    OldFlags (args[10].integer), false);
+      e->MarkX = OU (4);
+      e->MarkY = OU (5);
+    }
+  else if (open == '[' && args_match (args, n, "fsssmmmmnnf"))
+    {
+      e = CreateNewElement (ps->data, ps->font, FLAGS (0),
+			    args[1].s, args[2].s, args[3].s,
+			    NU (4) + NU (6), NU (5) + NU (7),
+			    args[8].number, args[9].number, FLAGS (10), false);
+      e->MarkX = NU (4);
+      e->MarkY = NU (5);
+    }
+  else
+    return syntax_error (ps);
+  ps->element = e;
+  ps->pin_num = 1;
+
+  if (!expect (ps, '('))
+    return false;
+  /* there has to be at least one definition */
+  do
+    {
+      if (!(relative ? parse_relement_definition (ps)
+	    : parse_element_definition (ps)))
+	return false;
+    }
+  while (!is_punct (ps, ')'));
+  next_token (ps);
+
+  SetElementBoundingBox (ps->data, e, ps->font);
+  return true;
+}
+
+static bool
+parse_symbol (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n, open, id;
+  SymbolType *symbol;
+
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (!open || !args_match (args, n, "cm"))
+    return syntax_error (ps);
+  if (!expect (ps, '('))
+    return false;
+
+  id = args[0].integer;
+  if (id <= 0 || id > MAX_FONTPOSITION)
+    {
+      parse_error ("fontposition out of range");
+      return false;
+    }
+  symbol = &ps->font->Symbol[id];
+  if (symbol->Valid)
+    {
+      parse_error ("symbol ID used twice");
+      return false;
+    }
+  symbol->Valid = true;
+  symbol->Delta = open == '[' ? NU (1) : OU (1);
+
+  while (is_word (ps, W_SYMBOLLINE))
+    {
+      next_token (ps);
+      open = read_args (ps, args, &n);
+      if (!open || !args_match (args, n, "mmmmm"))
+	return syntax_error (ps);
+      if (open == '[')
+	CreateNewLineInSymbol (symbol, NU (0), NU (1), NU (2), NU (3), NU (4));
+      else
+	CreateNewLineInSymbol (symbol, OU (0), OU (1), OU (2), OU (3), OU (4));
+    }
+  return expect (ps, ')');
+}
+
+static bool
+parse_font (Parser *ps)
+{
+  FontType *font = ps->font;
+  int i;
+
+  /* mark all symbols invalid */
+  font->Valid = false;
+  for (i = 0; i <= MAX_FONTPOSITION; i++)
+    free (font->Symbol[i].Line);
+  bzero (font->Symbol, sizeof (font->Symbol));
+
+  do
+    {
+      if (!parse_symbol (ps))
+	return false;
+    }
+  while (is_word (ps, W_SYMBOL));
+
+  font->Valid = true;
+  SetFontInfo (font);
+  return true;
+}
+
+static bool
+parse_netlist (Parser *ps)
+{
+  Arg args[MAX_ARGS];
+  int n;
+
+  next_token (ps);
+  if (read_args (ps, args, &n) != '(' || n != 0)
+    return syntax_error (ps);
+  if (!expect (ps, '('))
+    return false;
+  while (is_word (ps, W_NET))
+    {
+      next_token (ps);
+      if (read_args (ps, args, &n) != '(' || !args_match (args, n, "ss"))
+	return syntax_error (ps);
+      if (!expect (ps, '('))
+	return false;
+      ps->menu = CreateNewNet (&ps->pcb->NetlistLib, args[0].s, args[1].s);
+      while (is_word (ps, W_CONNECT))
+	{
+	  next_token (ps);
+	  if (read_args (ps, args, &n) != '(' || !args_match (args, n, "s"))
+	    return syntax_error (ps);
+	  CreateNewConnection (ps->menu, args[0].s);
+	}
+      if (!expect (ps, ')'))
+	return false;
+    }
+  return expect (ps, ')');
+}
+
+static int
+check_file_version (int ver)
+{
+  if (ver > PCB_FILE_VERSION)
+    {
+      Message (_("ERROR:  The file you are attempting to load is in a format\n"
+		 "which is too new for this version of pcb.  To load this file\n"
+		 "you need a version of pcb which is >= %d.  If you are\n"
+		 "using a version built from git source, the source date\n"
+		 "must be >= %d.  This copy of pcb can only read files\n"
+		 "up to file version %d.\n"), ver, ver, PCB_FILE_VERSION);
+      return 1;
+    }
+  return 0;
+}
+
+/* The optional header lines, in the order the file has them */
+static bool
+parse_header (Parser *ps)
+{
+  PCBType *pcb = ps->pcb;
+  Arg args[MAX_ARGS];
+  int n, open;
+
+  if (is_word (ps, W_FILEVERSION))
+    {
+      next_token (ps);
+      if (read_args (ps, args, &n) != '[' || !args_match (args, n, "i"))
+	return syntax_error (ps);
+      if (check_file_version (args[0].integer) != 0)
+	return false;
+    }
+
+  if (!is_word (ps, W_PCB))
+    return syntax_error (ps);
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (open == '(' && args_match (args, n, "s"))
+    {
+      pcb->MaxWidth = MAX_COORD;
+      pcb->MaxHeight = MAX_COORD;
+    }
+  else if (open == '(' && args_match (args, n, "smm"))
+    {
+      pcb->MaxWidth = OU (1);
+      pcb->MaxHeight = OU (2);
+    }
+  else if (open == '[' && args_match (args, n, "smm"))
+    {
+      pcb->MaxWidth = NU (1);
+      pcb->MaxHeight = NU (2);
+    }
+  else
+    return syntax_error (ps);
+  pcb->Name = args[0].s ? strdup (args[0].s) : NULL;
+
+  if (!is_word (ps, W_GRID))
+    return syntax_error (ps);
+  next_token (ps);
+  open = read_args (ps, args, &n);
+  if (open == '(' && args_match (args, n, "mmm"))
+    {
+      pcb->Grid = OU (0);
+      pcb->GridOffsetX = OU (1);
+      pcb->GridOffsetY = OU (2);
+    }
+  else if (open == '(' && args_match (args, n, "mmmi"))
+    {
+      pcb->Grid = OU (0);
+      pcb->GridOffsetX = OU (1);
+      pcb->GridOffsetY = OU (2);
+      Settings.DrawGrid = args[3].integer ? true : false;
+    }
+  else if (open == '[' && args_match (args, n, "mmmi"))
+    {
+      pcb->Grid = NU (0);
+      pcb->GridOffsetX = NU (1);
+      pcb->GridOffsetY = NU (2);
+      Settings.DrawGrid = args[3].integer ? true : false;
+    }
+  else
+    return syntax_error (ps);
+
+  if (is_word (ps, W_CURSOR))
+    {
+      next_token (ps);
+      open = read_args (ps, args, &n);
+      if (!open || !args_match (args, n, "mmn"))
+	return syntax_error (ps);
+      pcb->CursorX = open == '[' ? NU (0) : OU (0);
+      pcb->CursorY = open == '[' ? NU (1) : OU (1);
+    }
+
+  if (is_word (ps, W_POLYAREA))
+    {
+      next_token (ps);
+      if (read_args (ps, args, &n) != '[' || !args_match (args, n, "n"))
+	return syntax_error (ps);
+      /* Read in cmil^2 for now; in future this should be a noop. */
+      pcb->IsleArea =
+	MIL_TO_COORD (MIL_TO_COORD (args[0].number) / 100.0) / 100.0;
+    }
+
+  if (is_word (ps, W_THERMAL))
+    {
+      next_token (ps);
+      if (read_args (ps, args, &n) != '[' || !args_match (args, n, "n"))
+	return syntax_error (ps);
+      pcb->ThermScale = args[0].number;
+    }
+
+  if (is_word (ps, W_DRC))
+    {
+      next_token (ps);
+      if (read_args (ps, args, &n) != '['
+	  || !(args_match (args, n, "mmm") || args_match (args, n, "mmmm")
+	       || args_match (args, n, "mmmmmm")))
+	return syntax_error (ps);
+      pcb->Bloat = NU (0);
+      pcb->Shrink = NU (1);
+      pcb->minWid = NU (2);
+      pcb->minRing = NU (2);
+      if (n >= 4)
+	pcb->minSlk = NU (3);
+      if (n == 6)
+	{
+	  pcb->minDrill = NU (4);
+	  pcb->minRing = NU (5);
+	}
+    }
+
+  if (is_word (ps, W_FLAGS))
+    {
+      next_token (ps);
+      if (read_args (ps, args, &n) != '(')
+	return syntax_error (ps);
+      if (args_match (args, n, "i"))
+	pcb->Flags = MakeFlags (args[0].integer & PCB_FLAGS);
+      else if (args_match (args, n, "s"))
+	pcb->Flags = string_to_pcbflags (args[0].s, parse_error);
+      else
+	return syntax_error (ps);
+    }
+
+  if (is_word (ps, W_GROUPS))
+    {
+      next_token (ps);
+      if (read_args (ps, args, &n) != '(' || !args_match (args, n, "s"))
+	return syntax_error (ps);
+      if (ParseGroupString (args[0].s, &pcb->LayerGroups, &ps->data->LayerN))
+	{
+	  Message (_("illegal layer-group string\n"));
+	  return false;
+	}
+    }
+
+  if (is_word (ps, W_STYLES))
+    {
+      next_token (ps);
+      open = read_args (ps, args, &n);
+      if (!open || !args_match (args, n, "s"))
+	return syntax_error (ps);
+      if (ParseRouteString (args[0].s, &pcb->RouteStyle[0],
+			    open == '[' ? "cmil" : "mil"))
+	{
+	  Message (_("illegal route-style string\n"));
+	  return false;
+	}
+    }
+  return true;
+}
+
+static bool
+parse_board (Parser *ps)
+{
+  PCBType *pcb = ps->pcb, *pcb_save = PCB;
+  int i;
+
+  /* reset flags for 'used layers'; init font and data pointers */
+  for (i = 0; i < MAX_LAYER + EXTRA_LAYERS; i++)
+    ps->layer_used[i] = false;
+  ps->font = &pcb->Font;
+  ps->data = pcb->Data;
+  ps->data->pcb = pcb;
+  ps->data->LayerN = 0;
+  /* Parse the default layer group string, just in case the file doesn't have one */
+  if (ParseGroupString (Settings.Groups, &pcb->LayerGroups,
+			&ps->data->LayerN))
+    {
+      Message (_("illegal default layer-group string\n"));
+      return false;
+    }
+
+  if (!parse_header (ps))
+    return false;
+  if (is_word (ps, W_SYMBOL) && !parse_font (ps))
+    return false;
+
+  while (ps->tok.type == TOK_WORD)
+    {
+      bool ok;
+
+      switch (ps->tok.c)
+	{
+	case W_VIA:
+	  ok = parse_via (ps);
+	  break;
+	case W_ATTRIBUTE:
+	  ok = parse_attribute (ps, &pcb->Attributes);
+	  break;
+	case W_RAT:
+	  ok = parse_rat (ps);
+	  break;
+	case W_LAYER:
+	  ok = parse_layer (ps);
+	  break;
+	case W_ELEMENT:
+	  ok = parse_element (ps);
+	  break;
+	default:
+	  goto netlist;
+	}
+      if (!ok)
+	return false;
+    }
+
+netlist:
+  if (is_word (ps, W_NETLIST) && !parse_netlist (ps))
+    return false;
+  if (ps->tok.type != TOK_EOF)
+    return syntax_error (ps);
+
+  CreateNewPCBPost (pcb, 0);
+  /* initialize the polygon clipping now since
+   * we didn't know the layer grouping before.
+   */
+  PCB = pcb;
+  if (!Settings.SnapshotCache
+      || !LoadClipSnapshot (pcb, ps->path, ps->source, ps->size))
+    {
+      ALLPOLYGON_LOOP (ps->data);
+      {
+	InitClip (ps->data, layer, polygon);
+      }
+      ENDALL_LOOP;
+      if (Settings.SnapshotCache)
+	SaveClipSnapshot (pcb, ps->path, ps->source, ps->size);
+    }
+  PCB = pcb_save;
+  return true;
+}
+
+/* This case is when we load a footprint with file->open, or from the
+ * command line
+ */
+static bool
+parse_footprint (Parser *ps)
+{
+  PCBType *pcb = ps->pcb, *pcb_save = PCB;
+  ElementType *e;
+
+  ps->font = &pcb->Font;
+  ps->data = pcb->Data;
+  ps->data->pcb = pcb;
+  ps->data->LayerN = 0;
+
+  if (!parse_element (ps))
+    return false;
+  if (ps->tok.type != TOK_EOF)
+    return syntax_error (ps);
+
+  CreateNewPCBPost (pcb, 0);
+  ParseGroupString ("1,c:2,s", &pcb->LayerGroups, &ps->data->LayerN);
+  e = pcb->Data->Element->data;	/* we know there's only one */
+  PCB = pcb;
+  MoveElementLowLevel (pcb->Data, e, -e->BoundingBox.X1, -e->BoundingBox.Y1);
+  PCB = pcb_save;
+  pcb->MaxWidth = e->BoundingBox.X2;
+  pcb->MaxHeight = e->BoundingBox.Y2;
+  pcb->is_footprint = 1;
+  return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * Parses a board file the way ParsePCB() does.  Returns 0 on success and
+ * 1 on errors, or -1 without touching the board if the file can't be
+ * mapped; the caller falls back to the lex and yacc parser then.
+ */
+int
+ParsePCBFast (PCBType *Ptr, char *Path, char *Filename)
+{
+  Parser ps;
+  struct stat st;
+  char *name;
+  void *map;
+  int fd, r = 1;
+
+  if (Path != NULL && *Path != '\0')
+    name = g_strdup_printf ("%s%s%s", Path, PCB_DIR_SEPARATOR_S, Filename);
+  else
+    name = g_strdup (Filename);
+  fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      g_free (name);
+      return -1;
+    }
+  if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_size == 0
+      || (map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0))
+	 == MAP_FAILED)
+    {
+      close (fd);
+      g_free (name);
+      return -1;
+    }
+#ifdef MADV_SEQUENTIAL
+  madvise (map, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+  memset (&ps, 0, sizeof (ps));
+  ps.p = (const char *) map;
+  ps.end = ps.p + st.st_size;
+  ps.line = 1;
+  ps.filename = Filename;
+  ps.path = name;
+  ps.source = ps.p;
+  ps.size = st.st_size;
+  ps.pcb = Ptr;
+  current = &ps;
+
+  CreateBeLenient (true);
+  next_token (&ps);
+  if (is_word (&ps, W_FILEVERSION) || is_word (&ps, W_PCB))
+    r = !parse_board (&ps);
+  else if (is_word (&ps, W_ELEMENT))
+    r = !parse_footprint (&ps);
+  else if (is_word (&ps, W_SYMBOL))
+    /* a font isn't a board */
+    Message (_("illegal fileformat\n"));
+  else
+    syntax_error (&ps);
+  CreateBeLenient (false);
+
+  current = NULL;
+  free (ps.strings);
+  munmap (map, st.st_size);
+  close (fd);
+  g_free (name);
+  return r;
+}
+
+#else /* !HAVE_SYS_MMAN_H */
+
+int
+ParsePCBFast (PCBType *Ptr, char *Path, char *Filename)
+{
+  return -1;
+}
+
+#endif
@@ -33,6 +33,7 @@
 #include "global.h"
 
 int ParsePCB (PCBType *, char *);
+int ParsePCBFast (PCBType *, char *, char *);
 int ParseElementFile (DataType *, char *);
 int ParseLibraryEntry (DataType *, char *);
 int ParseFont (FontType *, char *);
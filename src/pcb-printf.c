@@ -35,6 +35,8 @@
 #include "config.h"
 #endif
 
+#include <locale.h>
+
 #include "global.h"
 
 #include "pcb-printf.h"
@@ -276,6 +278,23 @@ Coord unit_to_coord (const Unit *unit, double x)
   return base / unit->scale_factor;
 }
 
+/* Largest precision the exact coord formatters handle; beyond this
+ * the scaled coord may overflow 64 bits. */
+#define MAX_EXACT_PREC	9
+
+static const gint64 pow10_table[MAX_EXACT_PREC + 1] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000,
+  10000000, 100000000, 1000000000
+};
+
+/* \brief Number of coords (nanometres) in one of the given unit */
+static gint64
+coords_per_unit (enum e_family family, double scale_factor)
+{
+  return (gint64) ((family == METRIC ? 1000000.0 : 25400.0)
+                   / scale_factor + 0.5);
+}
+
 static int min_sig_figs(double d)
 {
   char buf[50];
@@ -292,6 +311,129 @@ static int min_sig_figs(double d)
   return rv;
 }
 
+/* \brief min_sig_figs for a coord expressed in a base unit
+ * \par Function Description
+ * Gives the same answer as min_sig_figs (COORD_TO_MM (coord)) or
+ * min_sig_figs (COORD_TO_MIL (coord)), but counts the digits of an
+ * exact decimal expansion with integer arithmetic where there is
+ * one. Only values that %g would have to round are passed on to
+ * min_sig_figs.
+ */
+static int
+coord_min_sig_figs (Coord coord, enum e_family family)
+{
+  gint64 per_unit = coords_per_unit (family, 1.0);
+  gint64 c = coord < 0 ? -(gint64) coord : (gint64) coord;
+  int prec, digits;
+
+  if (coord == 0)
+    return 0;
+
+  for (prec = 0; prec <= MAX_EXACT_PREC; prec++)
+    {
+      if (c > G_MAXINT64 / pow10_table[prec])
+        break;
+      if ((c * pow10_table[prec]) % per_unit == 0)
+        {
+          gint64 q = c * pow10_table[prec] / per_unit;
+
+          while (q % 10 == 0)
+            q /= 10;
+          for (digits = 0; q > 0; digits++)
+            q /= 10;
+          /* %g keeps six significant digits */
+          if (digits <= 6)
+            return digits == 1 ? 1 : digits + 1;
+          break;
+        }
+    }
+
+  return min_sig_figs (family == METRIC ? COORD_TO_MM (coord)
+                                        : COORD_TO_MIL (coord));
+}
+
+/* \brief Format a coord as a fixed point decimal without using floats
+ * \par Function Description
+ * Most coords that get exported lie on a grid of whole units, so
+ * their value in the output unit has an exact decimal expansion of
+ * at most prec digits. For those coords, printf's "%.*f" can only
+ * produce that expansion, and it is cheaper to produce it with
+ * integer arithmetic. Coords that would need rounding are left to
+ * printf, so the output is the same either way.
+ *
+ * \param [out] out            Buffer of at least 32 characters
+ * \param [in] coord           The coord to format
+ * \param [in] unit            The unit to output in
+ * \param [in] prec            Number of digits after the decimal point
+ * \param [in] decimal_point   Separator to use if prec > 0
+ *
+ * \return The length of the string written to out, or 0 if the
+ *         coord is not exactly representable and nothing was written.
+ */
+static int
+format_coord_exact (char *out, Coord coord, const Unit *unit, int prec,
+                    const char *decimal_point)
+{
+  char digits[32];
+  gint64 per_unit;
+  gint64 scaled, ipart, fpart;
+  int n = 0, len, i;
+
+  if (prec < 0 || prec > MAX_EXACT_PREC)
+    return 0;
+
+  /* Every unit is an exact whole number of nanometres */
+  per_unit = coords_per_unit (unit->family, unit->scale_factor);
+  if (per_unit < 1)
+    return 0;
+
+  if ((gint64) coord > G_MAXINT64 / pow10_table[prec] ||
+      (gint64) coord < -(G_MAXINT64 / pow10_table[prec]))
+    return 0;
+  scaled = (gint64) coord * pow10_table[prec];
+  if (scaled % per_unit != 0)
+    return 0;
+  scaled /= per_unit;
+
+  /* Keep to 14 significant digits, well inside what a double holds,
+   * so that printf would not have shown any conversion error either */
+  if (scaled >= G_GINT64_CONSTANT (100000000000000) ||
+      scaled <= -G_GINT64_CONSTANT (100000000000000))
+    return 0;
+
+  if (scaled < 0)
+    {
+      out[n++] = '-';
+      scaled = -scaled;
+    }
+  ipart = scaled / pow10_table[prec];
+  fpart = scaled % pow10_table[prec];
+
+  len = 0;
+  do
+    {
+      digits[len++] = '0' + ipart % 10;
+      ipart /= 10;
+    }
+  while (ipart > 0);
+  while (len > 0)
+    out[n++] = digits[--len];
+
+  if (prec > 0)
+    {
+      while (*decimal_point)
+        out[n++] = *decimal_point++;
+      for (i = prec - 1; i >= 0; i--)
+        {
+          out[n + i] = '0' + fpart % 10;
+          fpart /= 10;
+        }
+      n += prec;
+    }
+  out[n] = '\0';
+  return n;
+}
+
 /* \brief Internal coord-to-string converter for pcb-printf
  * \par Function Description
  * Converts a (group of) measurement(s) to a comma-deliminated
@@ -299,30 +441,26 @@ static int min_sig_figs(double d)
  * given, the list is enclosed in parens to make the scope of
  * the unit suffix clear.
  *
+ * \param [out] buff        String to append the formatted coords to
  * \param [in] coord        Array of coords to convert
- * \param [in] n_coords     Number of coords in array
+ * \param [in] n_coords     Number of coords in array, at most 10
  * \param [in] printf_spec  printf sub-specifier to use with %f
  * \param [in] e_allow      Bitmap of units the function may use
  * \param [in] suffix_type  Whether to add a suffix
- *
- * \return A string containing the formatted coords. Must be freed with g_free.
  */
-static gchar *CoordsToString(Coord coord[], int n_coords, const char *printf_spec, enum e_allow allow, enum e_suffix suffix_type)
+static void CoordsToString(GString *buff, Coord coord[], int n_coords, const char *printf_spec, enum e_allow allow, enum e_suffix suffix_type)
 {
-  GString *buff;
-  gchar *printf_buff;
+  char printf_buff[64];
   gchar filemode_buff[G_ASCII_DTOSTR_BUF_SIZE];
+  char exact_buff[32];
+  const char *decimal_point;
   enum e_family family;
-  double *value;
+  double value[10];
   const char *suffix;
-  int i, n;
-
-  value = malloc (n_coords * sizeof *value);
-  buff  = g_string_new ("");
+  int i, n, prec;
+  int file_mode = (suffix_type == FILE_MODE || suffix_type == FILE_MODE_NO_SUFFIX);
 
   /* Sanity checks */
-  if (buff == NULL || value == NULL)
-    return NULL;
   if (allow == 0)
     allow = ALLOW_ALL;
   if (printf_spec == NULL)
@@ -339,7 +477,7 @@ static gchar *CoordsToString(Coord coord[], int n_coords, const char *printf_spe
           imp_votes = 0;
 
       for (i = 0; i < n_coords; ++i)
-        if(min_sig_figs(COORD_TO_MIL(coord[i])) < min_sig_figs(COORD_TO_MM(coord[i])))
+        if (coord_min_sig_figs (coord[i], IMPERIAL) < coord_min_sig_figs (coord[i], METRIC))
           ++imp_votes;
         else
           ++met_votes;
@@ -367,7 +505,7 @@ static gchar *CoordsToString(Coord coord[], int n_coords, const char *printf_spe
       if ((Units[n].allow & allow) != 0 && (Units[n].family == family))
         {
           int n_above_one = 0;
-    
+
           for (i = 0; i < n_coords; ++i)
             if (fabs(value[i] * Units[n].scale_factor) > 1)
               ++n_above_one;
@@ -388,37 +526,62 @@ static gchar *CoordsToString(Coord coord[], int n_coords, const char *printf_spe
   for (i = 0; i < n_coords; ++i)
     value[i] = value[i] * Units[n].scale_factor;
 
-  /* Create sprintf specifier, using default_prec no precision is given */
-  i = 0;
-  while (printf_spec[i] == '%' || isdigit(printf_spec[i]) ||
-         printf_spec[i] == '-' || printf_spec[i] == '+' ||
-         printf_spec[i] == '#')
-    ++i;
-  if (printf_spec[i] == '.')
-    printf_buff = g_strdup_printf (", %sf", printf_spec);
-  else
-    printf_buff = g_strdup_printf (", %s.%df", printf_spec, Units[n].default_prec);
+  /* The exact formatter only stands in for a plain "%.Nf", without
+   * any flags or field width */
+  prec = -1;
+  if (printf_spec[0] == '%' && printf_spec[1] == '\0')
+    prec = Units[n].default_prec;
+  else if (printf_spec[0] == '%' && printf_spec[1] == '.')
+    {
+      prec = 0;
+      for (i = 2; isdigit (printf_spec[i]); i++)
+        prec = prec * 10 + (printf_spec[i] - '0');
+      if (printf_spec[i] != '\0' || i > 4)
+        prec = -1;
+    }
+  decimal_point = ".";
+  if (prec > 0 && !file_mode)
+    decimal_point = localeconv ()->decimal_point;
+  printf_buff[0] = '\0';
 
   /* Actually sprintf the values in place
    *  (+ 2 skips the ", " for first value) */
   if (n_coords > 1)
     g_string_append_c (buff, '(');
-  if (suffix_type == FILE_MODE || suffix_type == FILE_MODE_NO_SUFFIX)
-    {
-      g_ascii_formatd (filemode_buff, sizeof filemode_buff, printf_buff + 2, value[0]);
-      g_string_append_printf (buff, "%s", filemode_buff);
-    }
-  else
-    g_string_append_printf (buff, printf_buff + 2, value[0]);
-  for (i = 1; i < n_coords; ++i)
+  for (i = 0; i < n_coords; ++i)
     {
-      if (suffix_type == FILE_MODE || suffix_type == FILE_MODE_NO_SUFFIX)
+      const char *fmt;
+
+      if (format_coord_exact (exact_buff, coord[i], &Units[n], prec, decimal_point) > 0)
+        {
+          if (i > 0)
+            g_string_append (buff, ", ");
+          g_string_append (buff, exact_buff);
+          continue;
+        }
+
+      /* Create sprintf specifier, using default_prec no precision is given */
+      if (printf_buff[0] == '\0')
         {
-          g_ascii_formatd (filemode_buff, sizeof filemode_buff, printf_buff, value[i]);
-          g_string_append_printf (buff, "%s", filemode_buff);
+          int j = 0;
+          while (printf_spec[j] == '%' || isdigit(printf_spec[j]) ||
+                 printf_spec[j] == '-' || printf_spec[j] == '+' ||
+                 printf_spec[j] == '#')
+            ++j;
+          if (printf_spec[j] == '.')
+            g_snprintf (printf_buff, sizeof printf_buff, ", %sf", printf_spec);
+          else
+            g_snprintf (printf_buff, sizeof printf_buff, ", %s.%df", printf_spec, Units[n].default_prec);
+        }
+      fmt = (i == 0) ? printf_buff + 2 : printf_buff;
+
+      if (file_mode)
+        {
+          g_ascii_formatd (filemode_buff, sizeof filemode_buff, fmt, value[i]);
+          g_string_append (buff, filemode_buff);
         }
       else
-        g_string_append_printf (buff, printf_buff, value[i]);
+        g_string_append_printf (buff, fmt, value[i]);
     }
   if (n_coords > 1)
     g_string_append_c (buff, ')');
@@ -431,53 +594,59 @@ static gchar *CoordsToString(Coord coord[], int n_coords, const char *printf_spe
         case FILE_MODE_NO_SUFFIX:
           break;
         case SUFFIX:
-          g_string_append_printf (buff, " %s", suffix);
+          g_string_append_c (buff, ' ');
+          g_string_append (buff, suffix);
           break;
         case FILE_MODE:
-          g_string_append_printf (buff, "%s", suffix);
+          g_string_append (buff, suffix);
           break;
         }
     }
-
-  g_free (printf_buff);
-  free (value);
-  /* Return just the gchar* part of our string */
-  return g_string_free (buff, FALSE);
 }
 
-/* \brief Main pcb-printf function
+/* \brief Append a printf sub-specifier character, ignoring overlong specs */
+#define SPEC_APPEND(c)					\
+  do {							\
+    if (spec_len < (int) sizeof spec - 1)		\
+      {							\
+        spec[spec_len++] = (c);				\
+        spec[spec_len] = '\0';				\
+      }							\
+  } while (0)
+
+/* \brief Format into an existing string
  * \par Function Description
- * This is a printf wrapper that accepts new format specifiers to
- * output pcb coords as various units. See the comment at the top
- * of pcb-printf.h for full details.
+ * Does the work of pcb_vprintf, appending the output to string.
+ * The specifier is assembled on the stack and each conversion is
+ * appended in place, so nothing is allocated unless string has to
+ * grow.
  *
- * \param [in] fmt    Format specifier
- * \param [in] args   Arguments to specifier
- *
- * \return A formatted string. Must be freed with g_free.
+ * \param [out] string  String to append to
+ * \param [in] fmt      Format specifier
+ * \param [in] args     Arguments to specifier
  */
-gchar *pcb_vprintf(const char *fmt, va_list args)
+static void
+pcb_append_vprintf (GString *string, const char *fmt, va_list args)
 {
-  GString *string = g_string_new ("");
-  GString *spec   = g_string_new ("");
+  char spec[64];
+  int spec_len;
 
   enum e_allow mask = ALLOW_ALL;
 
-  if (string == NULL || spec == NULL)
-    return NULL;
-
   while(*fmt)
     {
       enum e_suffix suffix = NO_SUFFIX;
+      const char *literal;
 
       if(*fmt == '%')
         {
-          gchar *unit_str = NULL;
           const char *ext_unit = "";
           Coord value[10];
-          int count, i, done;
+          int count, i, done, found;
 
-          g_string_assign (spec, "%");
+          spec[0] = '%';
+          spec[1] = '\0';
+          spec_len = 1;
 
           done = 0;
           while ( ! done && fmt++ && *fmt)
@@ -496,7 +665,14 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
                   break;
                 /* Printf sub-specifiers */
                 case '*':
-                  g_string_append_printf (spec, "%d", va_arg (args, int));
+                  {
+                    char num[16];
+                    char *p;
+
+                    g_snprintf (num, sizeof num, "%d", va_arg (args, int));
+                    for (p = num; *p; p++)
+                      SPEC_APPEND (*p);
+                  }
                   break;
                 case '.':
                 case ' ':
@@ -516,7 +692,7 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
                 case '7':
                 case '8':
                 case '9':
-                  g_string_append_c (spec, *fmt);
+                  SPEC_APPEND (*fmt);
                   break;
                 default:
                   done = 1;
@@ -525,22 +701,22 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
 
           /* Tack full specifier onto specifier */
           if (*fmt != 'm')
-            g_string_append_c (spec, *fmt);
+            SPEC_APPEND (*fmt);
           switch(*fmt)
             {
             /* Printf specs */
             case 'o': case 'i': case 'd':
             case 'u': case 'x': case 'X':
-              if(strchr (spec->str, 'l'))
+              if(strchr (spec, 'l'))
                 {
-                  if(strchr (spec->str, 'l') != strrchr (spec->str, 'l'))
-                    unit_str = g_strdup_printf (spec->str, va_arg(args, long long));
+                  if(strchr (spec, 'l') != strrchr (spec, 'l'))
+                    g_string_append_printf (string, spec, va_arg(args, long long));
                   else
-                    unit_str = g_strdup_printf (spec->str, va_arg(args, long));
+                    g_string_append_printf (string, spec, va_arg(args, long));
                 }
               else
                 {
-                  unit_str = g_strdup_printf (spec->str, va_arg(args, int));
+                  g_string_append_printf (string, spec, va_arg(args, int));
                 }
               break;
             case 'e': case 'E':
@@ -549,31 +725,31 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
               if(suffix == FILE_MODE || suffix == FILE_MODE_NO_SUFFIX)
                 {
                   gchar buffer[128];
-                  g_ascii_formatd (buffer, 128, spec->str, va_arg(args, double));
-                  unit_str = g_strdup_printf ("%s", buffer);
+                  g_ascii_formatd (buffer, 128, spec, va_arg(args, double));
+                  g_string_append (string, buffer);
                 }
               else
-                unit_str = g_strdup_printf (spec->str, va_arg(args, double));
+                g_string_append_printf (string, spec, va_arg(args, double));
               break;
             case 'c':
-              if(strchr (spec->str, 'l') && sizeof(int) <= sizeof(wchar_t))
-                unit_str = g_strdup_printf (spec->str, va_arg(args, wchar_t));
+              if(strchr (spec, 'l') && sizeof(int) <= sizeof(wchar_t))
+                g_string_append_printf (string, spec, va_arg(args, wchar_t));
               else
-                unit_str = g_strdup_printf (spec->str, va_arg(args, int));
+                g_string_append_printf (string, spec, va_arg(args, int));
               break;
             case 's':
-              if(strchr (spec->str, 'l'))
-                unit_str = g_strdup_printf (spec->str, va_arg(args, wchar_t *));
+              if(strchr (spec, 'l'))
+                g_string_append_printf (string, spec, va_arg(args, wchar_t *));
               else
-                unit_str = g_strdup_printf (spec->str, va_arg(args, char *));
+                g_string_append_printf (string, spec, va_arg(args, char *));
               break;
             case 'n':
               /* Depending on gcc settings, this will probably break with
                *  some silly "can't put %n in writeable data space" message */
-              unit_str = g_strdup_printf (spec->str, va_arg(args, int *));
+              g_string_append_printf (string, spec, va_arg(args, int *));
               break;
             case 'p':
-              unit_str = g_strdup_printf (spec->str, va_arg(args, void *));
+              g_string_append_printf (string, spec, va_arg(args, void *));
               break;
             case '%':
               g_string_append_c (string, '%');
@@ -588,11 +764,11 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
               count = 1;
               switch(*fmt)
                 {
-                case 's': unit_str = CoordsToString(value, 1, spec->str, ALLOW_MM | ALLOW_MIL, suffix); break;
-                case 'S': unit_str = CoordsToString(value, 1, spec->str, mask & ALLOW_ALL, suffix); break;
-                case 'M': unit_str = CoordsToString(value, 1, spec->str, mask & ALLOW_METRIC, suffix); break;
-                case 'L': unit_str = CoordsToString(value, 1, spec->str, mask & ALLOW_IMPERIAL, suffix); break;
-                case 'r': unit_str = CoordsToString(value, 1, spec->str, set_allow_readable(0), FILE_MODE); break;
+                case 's': CoordsToString(string, value, 1, spec, ALLOW_MM | ALLOW_MIL, suffix); break;
+                case 'S': CoordsToString(string, value, 1, spec, mask & ALLOW_ALL, suffix); break;
+                case 'M': CoordsToString(string, value, 1, spec, mask & ALLOW_METRIC, suffix); break;
+                case 'L': CoordsToString(string, value, 1, spec, mask & ALLOW_IMPERIAL, suffix); break;
+                case 'r': CoordsToString(string, value, 1, spec, set_allow_readable(0), FILE_MODE); break;
                 /* All these fallthroughs are deliberate */
                 case '9': value[count++] = va_arg(args, Coord);
                 case '8': value[count++] = va_arg(args, Coord);
@@ -604,53 +780,105 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
                 case '2':
                 case 'D':
                   value[count++] = va_arg(args, Coord);
-                  unit_str = CoordsToString(value, count, spec->str, mask & ALLOW_ALL, suffix);
+                  CoordsToString(string, value, count, spec, mask & ALLOW_ALL, suffix);
                   break;
                 case 'd':
                   value[1] = va_arg(args, Coord);
-                  unit_str = CoordsToString(value, 2, spec->str, ALLOW_MM | ALLOW_MIL, suffix);
+                  CoordsToString(string, value, 2, spec, ALLOW_MM | ALLOW_MIL, suffix);
                   break;
                 case '*':
+                  found = 0;
                   for (i = 0; i < N_UNITS; ++i)
                     if (strcmp (ext_unit, Units[i].suffix) == 0)
-                      unit_str = CoordsToString(value, 1, spec->str, Units[i].allow, suffix);
-                  if (unit_str == NULL)
-                    unit_str = CoordsToString(value, 1, spec->str, mask & ALLOW_ALL, suffix);
+                      {
+                        CoordsToString(string, value, 1, spec, Units[i].allow, suffix);
+                        found = 1;
+                        break;
+                      }
+                  if (!found)
+                    CoordsToString(string, value, 1, spec, mask & ALLOW_ALL, suffix);
                   break;
                 case 'a':
-                  g_string_append (spec, ".0f");
+                  g_strlcat (spec, ".0f", sizeof spec);
                   if (suffix == SUFFIX)
-                    g_string_append (spec, " deg");
-                  unit_str = g_strdup_printf (spec->str, (double) va_arg(args, Angle));
+                    g_strlcat (spec, " deg", sizeof spec);
+                  g_string_append_printf (string, spec, (double) va_arg(args, Angle));
                   break;
                 case '+':
                   mask = va_arg(args, enum e_allow);
                   break;
                 default:
+                  found = 0;
                   for (i = 0; i < N_UNITS; ++i)
                     if (*fmt == Units[i].printf_code)
-                      unit_str = CoordsToString(value, 1, spec->str, Units[i].allow, suffix);
-                  if (unit_str == NULL)
-                    unit_str = CoordsToString(value, 1, spec->str, ALLOW_ALL, suffix);
+                      {
+                        CoordsToString(string, value, 1, spec, Units[i].allow, suffix);
+                        found = 1;
+                        break;
+                      }
+                  if (!found)
+                    CoordsToString(string, value, 1, spec, ALLOW_ALL, suffix);
                   break;
                 }
               break;
             }
-          if (unit_str != NULL)
-            {
-              g_string_append (string, unit_str);
-              g_free (unit_str);
-            }
+          if (*fmt)
+            ++fmt;
+          continue;
         }
-      else
-        g_string_append_c (string, *fmt);
-      ++fmt;
+
+      /* Copy the run of plain text up to the next specifier at once */
+      literal = fmt;
+      while (*fmt && *fmt != '%')
+        ++fmt;
+      g_string_append_len (string, literal, fmt - literal);
     }
-  g_string_free (spec, TRUE);
+}
+
+#undef SPEC_APPEND
+
+/* \brief Main pcb-printf function
+ * \par Function Description
+ * This is a printf wrapper that accepts new format specifiers to
+ * output pcb coords as various units. See the comment at the top
+ * of pcb-printf.h for full details.
+ *
+ * \param [in] fmt    Format specifier
+ * \param [in] args   Arguments to specifier
+ *
+ * \return A formatted string. Must be freed with g_free.
+ */
+gchar *pcb_vprintf(const char *fmt, va_list args)
+{
+  GString *string = g_string_new ("");
+
+  if (string == NULL)
+    return NULL;
+
+  pcb_append_vprintf (string, fmt, args);
   /* Return just the gchar* part of our string */
   return g_string_free (string, FALSE);
 }
 
+/* \brief Returns the emptied buffer shared by the output wrappers
+ * \par Function Description
+ * The file and string wrappers format into this buffer rather than
+ * a fresh string, so that exporting many coords reuses one block of
+ * memory. It only grows, to the longest line written so far. Like
+ * the rest of the exporters, these wrappers must only be called
+ * from the main thread.
+ */
+static GString *
+output_buffer (void)
+{
+  static GString *buffer = NULL;
+
+  if (buffer == NULL)
+    buffer = g_string_sized_new (4096);
+  g_string_truncate (buffer, 0);
+  return buffer;
+}
+
 
 /*!
  * \brief Wrapper for pcb_vprintf that outputs to a string.
@@ -670,21 +898,18 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
  */
 int pcb_snprintf(char *string, size_t size, const char *fmt, ...)
 {
-  gchar *tmp;
-  gsize length;
+  GString *tmp = output_buffer ();
 
   va_list args;
   va_start(args, fmt);
 
-  tmp = pcb_vprintf (fmt, args);
-  length = strlen (tmp);
-  strncpy (string, tmp, size);
+  pcb_append_vprintf (tmp, fmt, args);
+  strncpy (string, tmp->str, size);
   string[size - 1] = '\0';
 
-  g_free (tmp);
   va_end(args);
 
-  return length;
+  return tmp->len;
 }
 
 /* \brief Wrapper for pcb_vprintf that outputs to a file
@@ -697,7 +922,7 @@ int pcb_snprintf(char *string, size_t size, const char *fmt, ...)
 int pcb_fprintf(FILE *fh, const char *fmt, ...)
 {
   int rv;
-  gchar *tmp;
+  GString *tmp;
 
   va_list args;
   va_start(args, fmt);
@@ -706,11 +931,11 @@ int pcb_fprintf(FILE *fh, const char *fmt, ...)
     rv = -1;
   else
     {
-      tmp = pcb_vprintf (fmt, args);
-      rv = fprintf (fh, "%s", tmp);
-      g_free (tmp);
+      tmp = output_buffer ();
+      pcb_append_vprintf (tmp, fmt, args);
+      rv = fwrite (tmp->str, 1, tmp->len, fh) == tmp->len ? (int) tmp->len : -1;
     }
-  
+
   va_end(args);
   return rv;
 }
@@ -724,15 +949,14 @@ int pcb_fprintf(FILE *fh, const char *fmt, ...)
 int pcb_printf(const char *fmt, ...)
 {
   int rv;
-  gchar *tmp;
+  GString *tmp = output_buffer ();
 
   va_list args;
   va_start(args, fmt);
 
-  tmp = pcb_vprintf (fmt, args);
-  rv = printf ("%s", tmp);
-  g_free (tmp);
-  
+  pcb_append_vprintf (tmp, fmt, args);
+  rv = fwrite (tmp->str, 1, tmp->len, stdout) == tmp->len ? (int) tmp->len : -1;
+
   va_end(args);
   return rv;
 }
@@ -829,6 +1053,15 @@ pcb_printf_test_printf ()
   g_assert_cmpstr (pcb_g_strdup_printf ("%mD", c, d), ==, "(314, 218)");
   g_assert_cmpstr (pcb_g_strdup_printf ("%$mD", c, d), ==, "(314, 218) nm");
 
+  /* Exported coords, on and off the output grid */
+  g_assert_cmpstr (pcb_g_strdup_printf ("%.0mu", e), ==, "101000");
+  g_assert_cmpstr (pcb_g_strdup_printf ("%.0mc", f), ==, "300");
+  g_assert_cmpstr (pcb_g_strdup_printf ("%.3`mm", -e), ==, "-101.000");
+  g_assert_cmpstr (pcb_g_strdup_printf ("%mr", f), ==, "3.00mil");
+  g_assert_cmpstr (pcb_g_strdup_printf ("%mr", -e), ==, "-101.0000mm");
+  g_assert_cmpstr (pcb_g_strdup_printf ("%.2`mi", c), ==, "0.00");
+  g_assert_cmpstr (pcb_g_strdup_printf ("X%.0muY%.0mu", c, f), ==, "X0Y76");
+
   g_assert_cmpstr (pcb_g_strdup_printf ("%`f", 7.2456), ==, "7.245600");
   g_assert_cmpstr (pcb_g_strdup_printf ("%`.2f", 7.2456), ==, "7.25");
 
@@ -134,6 +134,9 @@ struct POLYAREA
     POLYAREA *f, *b;
     PLINE *contours;
     rtree_t *contour_tree;
+    int tristrip_num_vertices;
+    float *tristrip_vertices;
+    unsigned long tristrip_key; /* Identifies the contours the tristrips were built from */
 };
 
 BOOLp poly_M_Copy0(POLYAREA ** dst, const POLYAREA * srcfst);
@@ -1182,6 +1182,8 @@ InsCntr (jmp_buf * e, PLINE * c, POLYAREA ** dst)
     }
   newp->contours = c;
   newp->contour_tree = r_create_tree (NULL, 0, 0);
+  newp->tristrip_num_vertices = 0;
+  newp->tristrip_vertices = NULL;
   r_insert_entry (newp->contour_tree, (BoxType *) c, 0);
   c->next = NULL;
 }				/* InsCntr */
@@ -3106,6 +3108,8 @@ poly_Init (POLYAREA * p)
   p->f = p->b = p;
   p->contours = NULL;
   p->contour_tree = r_create_tree (NULL, 0, 0);
+  p->tristrip_num_vertices = 0;
+  p->tristrip_vertices = NULL;
 }
 
 POLYAREA *
@@ -3141,12 +3145,14 @@ poly_Free (POLYAREA ** p)
     {
       poly_FreeContours (&cur->contours);
       r_destroy_tree (&cur->contour_tree);
+      free (cur->tristrip_vertices);
       cur->f->b = cur->b;
       cur->b->f = cur->f;
       free (cur);
     }
   poly_FreeContours (&cur->contours);
   r_destroy_tree (&cur->contour_tree);
+  free (cur->tristrip_vertices);
   free (*p), *p = NULL;
 }
 
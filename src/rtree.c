@@ -450,6 +450,12 @@ typedef struct
   void *closure;
 } r_arg;
 
+/* Number of nodes visited by r_search, for drawing statistics. This is
+ * updated without any locking, so is only approximate if searches are
+ * running on several threads at once.
+ */
+unsigned long r_search_nodes_visited = 0;
+
 /* most of the auto-routing time is spent in this routine
  * so some careful thought has been given to maximizing the speed
  *
@@ -457,6 +463,8 @@ typedef struct
 int
 __r_search (struct rtree_node *node, const BoxType * query, r_arg * arg)
 {
+  r_search_nodes_visited++;
+
   assert (node);
   /** assert that starting_region is well formed */
   assert (query->X1 < query->X2 && query->Y1 < query->Y2);
@@ -82,6 +82,8 @@ static inline int r_search_pt (rtree_t * rtree, const PointType * pt,
   return r_search(rtree, &box, region_in_search, rectangle_in_region, closure);
 }
 
+extern unsigned long r_search_nodes_visited;
+
 /* -- special-purpose searches build upon r_search -- */
 /* return 0 if there are any rectangles in the given region. */
 int r_region_is_empty (rtree_t * rtree, const BoxType * region);
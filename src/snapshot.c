@@ -0,0 +1,492 @@
+/*
+ *                            COPYRIGHT
+ *
+ *  PCB, interactive printed circuit board design
+ *  Copyright (C) 2026 PCB Contributors (See ChangeLog for details).
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/* Polygon clip snapshots.
+ *
+ * Clipping every polygon against the objects around it is the slowest
+ * part of loading a board, and it gives the same result every time
+ * the file is loaded.  With --snapshot-cache, the clipped contours of
+ * all polygons and their hole-free pieces are written to a binary
+ * file next to the board, and the next load of the same board reads
+ * them back instead of clipping again.
+ *
+ * The snapshot is keyed by a digest of the board file's bytes, the
+ * font (which comes from elsewhere when the board has none) and the
+ * pcb version, so an edited board, or one loaded by a different pcb,
+ * just doesn't match.  The file is in the machine's byte order; the
+ * header says which, and a snapshot from another machine doesn't
+ * match either.
+ *
+ *   header    "PCBsnap\n", version, byte order mark, sizeof (Coord),
+ *             key, size of the board file, number of polygons
+ *   polygon   number of points, flags,
+ *             [clipped: pieces, each a count and its contours],
+ *             [no holes: a count and the contours]
+ *   contour   number of vertices, is_round, cx, cy, radius, vertices
+ *
+ * Polygons are stored in ALLPOLYGON_LOOP order, which is the order the
+ * board file has them in.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "global.h"
+#include "data.h"
+#include "polygon.h"
+#include "rtree.h"
+#include "snapshot.h"
+#include "hid/common/digest.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+#define SNAPSHOT_MAGIC "PCBsnap\n"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+/* polygon flags */
+#define SNAPSHOT_CLIPPED 1
+#define SNAPSHOT_NOHOLES 2
+
+/* The clipping depends on the layer grouping as well as the source, and
+ * boards without a Groups line take it from Settings.Groups, so the key
+ * covers the grouping the board ended up with.
+ */
+static guint64
+snapshot_key (PCBType *pcb, const char *source, size_t size)
+{
+  guint64 d = export_digest_start ();
+  int group, i;
+
+  d = export_digest_string (d, VERSION);
+  d = export_digest_bytes (d, source, size);
+  d = export_digest_int (d, pcb->Data->LayerN);
+  for (group = 0; group < MAX_GROUP; group++)
+    {
+      d = export_digest_int (d, pcb->LayerGroups.Number[group]);
+      for (i = 0; i < pcb->LayerGroups.Number[group]; i++)
+        d = export_digest_int (d, pcb->LayerGroups.Entries[group][i]);
+    }
+  return export_digest_font (d, &pcb->Font);
+}
+
+static guint32
+count_polygons (DataType *data)
+{
+  guint32 n = 0;
+
+  ALLPOLYGON_LOOP (data);
+  {
+    n++;
+  }
+  ENDALL_LOOP;
+  return n;
+}
+
+/* ---------------------------------------------------------------------------
+ * reading
+ */
+
+#ifdef HAVE_SYS_MMAN_H
+
+typedef struct
+{
+  const char *p, *end;
+} Reader;
+
+static bool
+read_bytes (Reader *r, void *v, size_t n)
+{
+  if ((size_t) (r->end - r->p) < n)
+    return false;
+  memcpy (v, r->p, n);
+  r->p += n;
+  return true;
+}
+
+static bool
+read_u32 (Reader *r, guint32 *v)
+{
+  return read_bytes (r, v, sizeof (*v));
+}
+
+static bool
+read_coord (Reader *r, Coord *v)
+{
+  return read_bytes (r, v, sizeof (*v));
+}
+
+/* The vertices are linked in as they were saved; poly_InclVertex would
+ * drop collinear ones, and the clipped contours can have those.
+ */
+static bool
+read_contour (Reader *r, PLINE **contour)
+{
+  guint32 n, i, is_round;
+  Coord cx, cy, radius;
+  Vector v;
+  VNODE *node;
+  PLINE *c;
+
+  if (!read_u32 (r, &n) || n == 0 || !read_u32 (r, &is_round)
+      || !read_coord (r, &cx) || !read_coord (r, &cy)
+      || !read_coord (r, &radius)
+      || (size_t) (r->end - r->p) / (2 * sizeof (Coord)) < n)
+    return false;
+
+  v[0] = v[1] = 0;
+  read_coord (r, &v[0]);
+  read_coord (r, &v[1]);
+  if ((c = poly_NewContour (v)) == NULL)
+    return false;
+  for (i = 1; i < n; i++)
+    {
+      read_coord (r, &v[0]);
+      read_coord (r, &v[1]);
+      if ((node = poly_CreateNode (v)) == NULL)
+        {
+          poly_DelContour (&c);
+          return false;
+        }
+      node->prev = c->head.prev;
+      node->next = &c->head;
+      c->head.prev->next = node;
+      c->head.prev = node;
+    }
+  poly_PreContour (c, FALSE);
+  c->is_round = is_round;
+  c->cx = cx;
+  c->cy = cy;
+  c->radius = radius;
+  *contour = c;
+  return true;
+}
+
+/* a list of contours linked by next, as NoHoles is */
+static bool
+read_contours (Reader *r, PLINE **list)
+{
+  guint32 n;
+  PLINE **last = list;
+
+  *list = NULL;
+  if (!read_u32 (r, &n))
+    return false;
+  while (n--)
+    {
+      if (!read_contour (r, last))
+        {
+          poly_FreeContours (list);
+          return false;
+        }
+      last = &(*last)->next;
+    }
+  return true;
+}
+
+static bool
+read_polyarea (Reader *r, POLYAREA **list)
+{
+  guint32 pieces, n;
+  POLYAREA *pa;
+  PLINE **last;
+
+  *list = NULL;
+  if (!read_u32 (r, &pieces))
+    return false;
+  while (pieces--)
+    {
+      if (!read_u32 (r, &n) || n == 0 || (pa = poly_Create ()) == NULL)
+        goto fail;
+      poly_M_Incl (list, pa);
+      for (last = &pa->contours; n--; last = &(*last)->next)
+        {
+          if (!read_contour (r, last))
+            goto fail;
+          r_insert_entry (pa->contour_tree, (BoxType *) * last, 0);
+        }
+    }
+  return true;
+
+fail:
+  poly_Free (list);
+  return false;
+}
+
+static bool
+read_polygon (Reader *r, PolygonType *polygon)
+{
+  guint32 points, flags;
+
+  poly_Free (&polygon->Clipped);
+  poly_FreeContours (&polygon->NoHoles);
+  polygon->NoHolesValid = 0;
+  if (!read_u32 (r, &points) || points != polygon->PointN
+      || !read_u32 (r, &flags))
+    return false;
+  if ((flags & SNAPSHOT_CLIPPED) && !read_polyarea (r, &polygon->Clipped))
+    return false;
+  if (flags & SNAPSHOT_NOHOLES)
+    {
+      if (!read_contours (r, &polygon->NoHoles))
+        return false;
+      polygon->NoHolesValid = 1;
+    }
+  return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * Restores the clipped polygons of a board which was just parsed from
+ * source[0..size-1], read from filename.  PCB has to be the board.
+ * Returns false if there is no matching snapshot; the polygons have
+ * to be clipped with InitClip then.  Anything restored before the
+ * mismatch was found is freed again, and every polygon is left with
+ * NoHolesValid cleared.
+ */
+bool
+LoadClipSnapshot (PCBType *pcb, const char *filename, const char *source,
+                  size_t size)
+{
+  char magic[sizeof (SNAPSHOT_MAGIC) - 1];
+  guint32 version, byte_order, coord_size, polygons;
+  guint64 key, source_size;
+  struct stat st;
+  char *name;
+  void *map;
+  Reader r;
+  bool ok;
+  int fd;
+
+  name = g_strconcat (filename, SNAPSHOT_SUFFIX, NULL);
+  fd = open (name, O_RDONLY);
+  g_free (name);
+  if (fd < 0)
+    return false;
+  if (fstat (fd, &st) != 0 || st.st_size == 0
+      || (map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0))
+         == MAP_FAILED)
+    {
+      close (fd);
+      return false;
+    }
+  r.p = (const char *) map;
+  r.end = r.p + st.st_size;
+
+  ok = read_bytes (&r, magic, sizeof (magic))
+    && memcmp (magic, SNAPSHOT_MAGIC, sizeof (magic)) == 0
+    && read_u32 (&r, &version) && version == SNAPSHOT_VERSION
+    && read_u32 (&r, &byte_order) && byte_order == SNAPSHOT_BYTE_ORDER
+    && read_u32 (&r, &coord_size) && coord_size == sizeof (Coord)
+    && read_bytes (&r, &key, sizeof (key))
+    && read_bytes (&r, &source_size, sizeof (source_size))
+    && source_size == size
+    && key == snapshot_key (pcb, source, size)
+    && read_u32 (&r, &polygons) && polygons == count_polygons (pcb->Data);
+
+  ALLPOLYGON_LOOP (pcb->Data);
+  {
+    if (ok)
+      ok = read_polygon (&r, polygon);
+  }
+  ENDALL_LOOP;
+  ok = ok && r.p == r.end;
+
+  /* Don't leave polygons before a mismatch with restored data.  InitClip
+   * doesn't clear NoHolesValid for every polygon, such as those which
+   * clear but aren't on a copper layer.
+   */
+  if (!ok)
+    {
+      ALLPOLYGON_LOOP (pcb->Data);
+      {
+        poly_Free (&polygon->Clipped);
+        poly_FreeContours (&polygon->NoHoles);
+        polygon->NoHolesValid = 0;
+      }
+      ENDALL_LOOP;
+    }
+
+  munmap (map, st.st_size);
+  close (fd);
+  return ok;
+}
+
+#else /* !HAVE_SYS_MMAN_H */
+
+bool
+LoadClipSnapshot (PCBType *pcb, const char *filename, const char *source,
+                  size_t size)
+{
+  return false;
+}
+
+#endif
+
+/* ---------------------------------------------------------------------------
+ * writing
+ */
+
+static void
+write_u32 (FILE *fp, guint32 v)
+{
+  fwrite (&v, sizeof (v), 1, fp);
+}
+
+static void
+write_coord (FILE *fp, Coord v)
+{
+  fwrite (&v, sizeof (v), 1, fp);
+}
+
+static void
+write_contour (FILE *fp, PLINE *c)
+{
+  guint32 n = 0;
+  VNODE *v;
+
+  v = &c->head;
+  do
+    n++;
+  while ((v = v->next) != &c->head);
+
+  write_u32 (fp, n);
+  write_u32 (fp, c->is_round);
+  write_coord (fp, c->cx);
+  write_coord (fp, c->cy);
+  write_coord (fp, c->radius);
+  v = &c->head;
+  do
+    {
+      write_coord (fp, v->point[0]);
+      write_coord (fp, v->point[1]);
+    }
+  while ((v = v->next) != &c->head);
+}
+
+static void
+write_contours (FILE *fp, PLINE *list)
+{
+  guint32 n = 0;
+  PLINE *c;
+
+  for (c = list; c != NULL; c = c->next)
+    n++;
+  write_u32 (fp, n);
+  for (c = list; c != NULL; c = c->next)
+    write_contour (fp, c);
+}
+
+static void
+write_polygon (FILE *fp, PolygonType *polygon)
+{
+  guint32 flags = 0, pieces = 0;
+  POLYAREA *pa;
+
+  /* the pieces are worked out on the first draw anyway; do it now so
+   * that later loads needn't
+   */
+  if (polygon->Clipped && !polygon->NoHolesValid)
+    ComputeNoHoles (polygon);
+
+  if (polygon->Clipped)
+    flags |= SNAPSHOT_CLIPPED;
+  if (polygon->NoHolesValid)
+    flags |= SNAPSHOT_NOHOLES;
+  write_u32 (fp, polygon->PointN);
+  write_u32 (fp, flags);
+
+  if ((pa = polygon->Clipped) != NULL)
+    {
+      do
+        pieces++;
+      while ((pa = pa->f) != polygon->Clipped);
+      write_u32 (fp, pieces);
+      do
+        write_contours (fp, pa->contours);
+      while ((pa = pa->f) != polygon->Clipped);
+    }
+  if (polygon->NoHolesValid)
+    write_contours (fp, polygon->NoHoles);
+}
+
+/* ---------------------------------------------------------------------------
+ * Writes the snapshot for a board whose polygons were just clipped.
+ * The arguments are as for LoadClipSnapshot().  A board in a directory
+ * which can't be written to just doesn't get a snapshot.
+ */
+void
+SaveClipSnapshot (PCBType *pcb, const char *filename, const char *source,
+                  size_t size)
+{
+  guint64 key = snapshot_key (pcb, source, size), source_size = size;
+  char *name, *tmp;
+  FILE *fp;
+  bool ok;
+
+  name = g_strconcat (filename, SNAPSHOT_SUFFIX, NULL);
+  /* written aside and renamed, so a concurrent load never sees half */
+  tmp = g_strconcat (name, ".new", NULL);
+  if ((fp = fopen (tmp, "wb")) == NULL)
+    {
+      g_free (tmp);
+      g_free (name);
+      return;
+    }
+
+  fwrite (SNAPSHOT_MAGIC, sizeof (SNAPSHOT_MAGIC) - 1, 1, fp);
+  write_u32 (fp, SNAPSHOT_VERSION);
+  write_u32 (fp, SNAPSHOT_BYTE_ORDER);
+  write_u32 (fp, sizeof (Coord));
+  fwrite (&key, sizeof (key), 1, fp);
+  fwrite (&source_size, sizeof (source_size), 1, fp);
+  write_u32 (fp, count_polygons (pcb->Data));
+  ALLPOLYGON_LOOP (pcb->Data);
+  {
+    write_polygon (fp, polygon);
+  }
+  ENDALL_LOOP;
+
+  ok = !ferror (fp);
+  if (fclose (fp) != 0)
+    ok = false;
+  if (!ok || rename (tmp, name) != 0)
+    remove (tmp);
+  g_free (tmp);
+  g_free (name);
+}
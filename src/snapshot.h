@@ -0,0 +1,37 @@
+/*
+ *                            COPYRIGHT
+ *
+ *  PCB, interactive printed circuit board design
+ *  Copyright (C) 2026 PCB Contributors (See ChangeLog for details).
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/* prototypes for the polygon clip snapshots kept next to board files
+ */
+
+#ifndef	PCB_SNAPSHOT_H
+#define	PCB_SNAPSHOT_H
+
+#include "global.h"
+
+/* appended to the board's file name */
+#define SNAPSHOT_SUFFIX ".snapshot"
+
+bool LoadClipSnapshot (PCBType *, const char *, const char *, size_t);
+void SaveClipSnapshot (PCBType *, const char *, const char *, size_t);
+
+#endif
@@ -0,0 +1,134 @@
+#!/bin/sh
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of version 2 of the GNU General Public License as
+#  published by the Free Software Foundation
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA
+
+usage() {
+cat <<EOF
+
+$0 -- Run the pcb redraw benchmark
+
+$0 -h|--help
+$0 [-t | --max-p90 ms] [-- glbench options] [layout1 [layout2 [...]]]
+
+OVERVIEW
+
+Each layout is rendered through the GL drawing code into an offscreen
+buffer by the glbench export HID, replaying a scripted sequence of pans
+and zooms.  The frame time percentiles are reported for each layout.
+By default every layout in the inputs directory is benchmarked.
+
+pcb must have been configured with --enable-gl and with glbench in the
+list given to --with-exporters.  If it was not, the benchmark is skipped.
+
+OPTIONS
+
+-t | --max-p90 <ms>    :  Fail if the 90th percentile frame time of any
+                          layout exceeds <ms> milliseconds.
+
+Options after -- are passed on to the glbench HID, for example
+--width, --height, --repeat and --script.
+
+EOF
+}
+
+max_p90=
+bench_flags=
+
+while test -n "$1"
+  do
+  case "$1"
+      in
+
+      -h|--help)
+	  usage
+	  exit 0
+	  ;;
+
+      -t|--max-p90)
+	  max_p90="$2"
+	  shift 2
+	  ;;
+
+      --)
+	  shift
+	  while test -n "$1" ; do
+	      case "$1" in
+		  *.pcb)
+		      break
+		      ;;
+	      esac
+	      bench_flags="${bench_flags} $1"
+	      shift
+	  done
+	  ;;
+
+      -*)
+	  echo "unknown option: $1"
+	  exit 1
+	  ;;
+
+      *)
+	  break
+	  ;;
+
+  esac
+done
+
+# Source directory
+srcdir=${srcdir:-.}
+
+# The pcb wrapper script we want to benchmark
+PCB=${PCB:-../src/pcbtest.sh}
+
+INDIR=${INDIR:-${srcdir}/inputs}
+
+AWK=${AWK:-awk}
+
+layouts="$*"
+if test "X${layouts}" = "X" ; then
+    layouts=`ls ${INDIR}/*.pcb`
+fi
+
+fail=0
+for f in ${layouts} ; do
+    out=`${PCB} -x glbench ${bench_flags} ${f} 2>&1`
+    pcb_rc=$?
+
+    if echo "${out}" | grep "Invalid exporter glbench" > /dev/null ; then
+	echo "pcb was built without the glbench HID.  Skipping the benchmark."
+	exit 77
+    fi
+
+    echo "${out}"
+
+    if test $pcb_rc -ne 0 ; then
+	echo "${PCB} returned ${pcb_rc}.  This is a failure."
+	fail=`expr $fail + 1`
+	continue
+    fi
+
+    if test "X${max_p90}" != "X" ; then
+	p90=`echo "${out}" | $AWK '/frame ms/ {for (i = 1; i < NF; i++) if ($i == "p90") print $(i + 1)}'`
+	slow=`echo "${p90} ${max_p90}" | $AWK '{print ($1 > $2) ? "yes" : "no"}'`
+	if test "X${p90}" = "X" -o "X${slow}" = "Xyes" ; then
+	    echo "FAIL: ${f} p90 frame time ${p90} ms exceeds ${max_p90} ms"
+	    fail=`expr $fail + 1`
+	fi
+    fi
+done
+
+if test $fail -ne 0 ; then
+    exit 1
+fi
+exit 0
@@ -0,0 +1,109 @@
+#!/bin/sh
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of version 2 of the GNU General Public License as
+#  published by the Free Software Foundation
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA
+
+usage() {
+cat <<EOF
+
+$0 -- Compare the two .pcb parsers
+
+$0 -h|--help
+$0 [layout1 [layout2 [...]]]
+
+OVERVIEW
+
+Plain layout files are read by the hand-written parser in parse_fast.c,
+while layouts read through a --file-command go through the lex and yacc
+parser.  Each layout is loaded both ways and saved again, and the two
+saved files must be identical.  By default every layout in the inputs
+directory is compared.
+
+pcb is run under the bom exporter, which never starts a GUI, so the
+action script saving the layout quits before anything is exported.
+
+EOF
+}
+
+case "$1" in
+    -h|--help)
+	usage
+	exit 0
+	;;
+esac
+
+# Source directory
+srcdir=${srcdir:-.}
+
+# The pcb wrapper script we want to test
+#
+# we run it from outputs/parser_diff so we need to look 3 levels up
+# and then down to src
+PCB=${PCB:-../../../src/pcbtest.sh}
+
+INDIR=${INDIR:-${srcdir}/inputs}
+OUTDIR=outputs/parser_diff
+
+layouts="$*"
+if test "X${layouts}" = "X" ; then
+    layouts=`ls ${INDIR}/*.pcb`
+fi
+
+mkdir -p ${OUTDIR}
+if test $? -ne 0 ; then
+    echo "Failed to create output directory ${OUTDIR}"
+    exit 1
+fi
+
+# the bom exporter is only used to keep pcb from starting a GUI
+if (cd ${OUTDIR} && ${PCB} -x bom --help 2>&1) | grep "^	bom " > /dev/null ; then
+    :
+else
+    echo "pcb was built without the bom exporter.  Skipping the parser comparison."
+    exit 77
+fi
+
+printf "SaveTo(LayoutAs,fast.pcb)\nQuit()\n" > ${OUTDIR}/fast.script
+printf "SaveTo(LayoutAs,yacc.pcb)\nQuit()\n" > ${OUTDIR}/yacc.script
+
+pass=0
+fail=0
+for f in ${layouts} ; do
+    name=`basename ${f}`
+    rm -f ${OUTDIR}/fast.pcb ${OUTDIR}/yacc.pcb
+    cp ${f} ${OUTDIR}/${name}
+
+    # the file command is word split by pcbtest.sh, so it can't have spaces
+    (cd ${OUTDIR} && ${PCB} -x bom --action-script fast.script \
+	${name}) > /dev/null 2>&1
+    (cd ${OUTDIR} && ${PCB} -x bom --file-command 'cat<%f' \
+	--action-script yacc.script ${name}) > /dev/null 2>&1
+
+    if test ! -f ${OUTDIR}/fast.pcb -o ! -f ${OUTDIR}/yacc.pcb ; then
+	echo "FAILED:  ${name} could not be loaded and saved"
+	fail=`expr $fail + 1`
+    elif cmp -s ${OUTDIR}/fast.pcb ${OUTDIR}/yacc.pcb ; then
+	echo "${name}:  PASSED"
+	pass=`expr $pass + 1`
+    else
+	echo "FAILED:  ${name} loads differently with the two parsers"
+	diff ${OUTDIR}/yacc.pcb ${OUTDIR}/fast.pcb | head -20
+	fail=`expr $fail + 1`
+    fi
+done
+
+echo "Passed ${pass}, failed ${fail}"
+if test ${fail} -ne 0 ; then
+    exit 1
+fi
+exit 0
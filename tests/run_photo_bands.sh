@@ -0,0 +1,117 @@
+#!/bin/sh
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of version 2 of the GNU General Public License as
+#  published by the Free Software Foundation
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA
+
+usage() {
+cat <<EOF
+
+$0 -- Compare PNG photo mode exports drawn in bands with whole ones
+
+$0 -h|--help
+$0 [layout1 [layout2 [...]]]
+
+OVERVIEW
+
+With --photo-tile-rows the PNG exporter draws photo mode layers a band
+of rows at a time.  Each layout is exported with and without bands, both
+as seen from the top and as shown from the bottom side, and the images
+must be identical.  By default every layout in the inputs directory is
+compared.
+
+The gold plating is used since tinned plating adds random noise.
+
+EOF
+}
+
+case "$1" in
+    -h|--help)
+	usage
+	exit 0
+	;;
+esac
+
+# Source directory
+srcdir=${srcdir:-.}
+
+# The pcb wrapper script we want to test
+#
+# we run it from outputs/photo_bands so we need to look 3 levels up
+# and then down to src
+PCB=${PCB:-../../../src/pcbtest.sh}
+
+INDIR=${INDIR:-${srcdir}/inputs}
+OUTDIR=outputs/photo_bands
+
+# bands of this many rows, so that every layout is split into several
+TILE_ROWS=16
+
+layouts="$*"
+if test "X${layouts}" = "X" ; then
+    layouts=`ls ${INDIR}/*.pcb`
+fi
+
+mkdir -p ${OUTDIR}
+if test $? -ne 0 ; then
+    echo "Failed to create output directory ${OUTDIR}"
+    exit 1
+fi
+
+if (cd ${OUTDIR} && ${PCB} -x png --help 2>&1) | grep "^	png " > /dev/null ; then
+    :
+else
+    echo "pcb was built without the png exporter.  Skipping the photo mode comparison."
+    exit 77
+fi
+
+pass=0
+fail=0
+for f in ${layouts} ; do
+    name=`basename ${f}`
+    cp ${f} ${OUTDIR}/${name}
+
+    # pcbtest.sh word splits its arguments, so these can't have spaces
+    for view in top bottom ; do
+	if test ${view} = bottom ; then
+	    view_flags="--as-shown --layer-stack solderside"
+	else
+	    view_flags=""
+	fi
+	whole=whole-${view}.png
+	bands=bands-${view}.png
+	rm -f ${OUTDIR}/${whole} ${OUTDIR}/${bands}
+
+	(cd ${OUTDIR} && ${PCB} -x png --photo-mode --photo-plating gold \
+	    ${view_flags} --outfile ${whole} ${name}) > /dev/null 2>&1
+	(cd ${OUTDIR} && ${PCB} -x png --photo-mode --photo-plating gold \
+	    --photo-tile-rows ${TILE_ROWS} \
+	    ${view_flags} --outfile ${bands} ${name}) > /dev/null 2>&1
+
+	if test ! -f ${OUTDIR}/${whole} -o ! -f ${OUTDIR}/${bands} ; then
+	    echo "FAILED:  ${name} (${view}) could not be exported"
+	    fail=`expr $fail + 1`
+	elif cmp -s ${OUTDIR}/${whole} ${OUTDIR}/${bands} ; then
+	    echo "${name} (${view}):  PASSED"
+	    pass=`expr $pass + 1`
+	else
+	    echo "FAILED:  ${name} (${view}) differs when drawn in bands"
+	    fail=`expr $fail + 1`
+	fi
+    done
+done
+
+echo "Passed ${pass}, failed ${fail}"
+if test ${fail} -ne 0 ; then
+    exit 1
+fi
+exit 0
@@ -0,0 +1,115 @@
+#!/bin/sh
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of version 2 of the GNU General Public License as
+#  published by the Free Software Foundation
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA
+
+usage() {
+cat <<EOF
+
+$0 -- Check that clip snapshots are not reused across layer groupings
+
+$0 -h|--help
+$0
+
+OVERVIEW
+
+The polygon on the component layer of snapshot_groups.pcb is cleared by
+the line on the solder layer only when both layers share a group.  The
+board is loaded once with those layers grouped, which leaves a clip
+snapshot behind, and then exported with the layers apart, both with the
+snapshot cache and without it.  The two Gerber exports must be identical.
+
+EOF
+}
+
+case "$1" in
+    -h|--help)
+	usage
+	exit 0
+	;;
+esac
+
+# Source directory
+srcdir=${srcdir:-.}
+
+# The pcb wrapper script we want to test
+#
+# we run it from outputs/snapshot_groups so we need to look 3 levels up
+# and then down to src
+PCB=${PCB:-../../../src/pcbtest.sh}
+
+INDIR=${INDIR:-${srcdir}/inputs}
+OUTDIR=outputs/snapshot_groups
+
+name=snapshot_groups.pcb
+
+# pcbtest.sh word splits its arguments, so these can't have spaces
+JOINED=1,2,c:3,s:4:5:6:7:8
+APART=1,c:2,s:3:4:5:6:7:8
+
+mkdir -p ${OUTDIR}
+if test $? -ne 0 ; then
+    echo "Failed to create output directory ${OUTDIR}"
+    exit 1
+fi
+
+if (cd ${OUTDIR} && ${PCB} -x gerber --help 2>&1) | grep "^	gerber " > /dev/null ; then
+    :
+else
+    echo "pcb was built without the gerber exporter.  Skipping the snapshot comparison."
+    exit 77
+fi
+
+(cd ${OUTDIR} && rm -f ${name}.snapshot joined.* cached.* clipped.*)
+cp ${INDIR}/${name} ${OUTDIR}/${name}
+
+(cd ${OUTDIR} && ${PCB} -x gerber --snapshot-cache --groups ${JOINED} \
+    --gerberfile joined ${name}) > /dev/null 2>&1
+if test ! -f ${OUTDIR}/${name}.snapshot ; then
+    echo "FAILED:  no clip snapshot was written for ${name}"
+    exit 1
+fi
+
+(cd ${OUTDIR} && ${PCB} -x gerber --snapshot-cache --groups ${APART} \
+    --gerberfile cached ${name}) > /dev/null 2>&1
+(cd ${OUTDIR} && rm -f ${name}.snapshot)
+(cd ${OUTDIR} && ${PCB} -x gerber --groups ${APART} \
+    --gerberfile clipped ${name}) > /dev/null 2>&1
+
+pass=0
+fail=0
+for f in ${OUTDIR}/clipped.* ; do
+    layer=`basename ${f} | sed 's/^clipped\.//'`
+    cached=${OUTDIR}/cached.${layer}
+    if test ! -f ${f} -o ! -f ${cached} ; then
+	echo "FAILED:  ${layer} could not be exported"
+	fail=`expr $fail + 1`
+	continue
+    fi
+    # the G04 comments carry the date of the export
+    grep -v '^G04' ${f} > ${f}.strip
+    grep -v '^G04' ${cached} > ${cached}.strip
+    if cmp -s ${f}.strip ${cached}.strip ; then
+	echo "${layer}:  PASSED"
+	pass=`expr $pass + 1`
+    else
+	echo "FAILED:  ${layer} differs when read from the snapshot"
+	fail=`expr $fail + 1`
+    fi
+done
+
+echo "Passed ${pass}, failed ${fail}"
+if test ${pass} -eq 0 -o ${fail} -ne 0 ; then
+    exit 1
+fi
+exit 0